@@ -0,0 +1,568 @@
+#include "../src/aho_corasick.hpp"
+#include "../src/blake3.hpp"
+#include "../src/byte_histogram.hpp"
+#include "../src/crc32.hpp"
+#include "../src/digest_set.hpp"
+#include "../src/fastcdc.hpp"
+#include "../src/magic.hpp"
+#include "../src/mime.hpp"
+#include "../src/pdf_scan.hpp"
+#include "../src/perf_counters.hpp"
+#include "../src/sha256.hpp"
+#include "../src/simd_search.hpp"
+#include "../src/tlsh.hpp"
+#include "../src/utf8.hpp"
+#include "../src/xxh3.hpp"
+#include "../src/zip_verify.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Loads a binary file from a few candidate paths.
+ */
+vector<uint8_t> loadFile(const string& path) {
+    const vector<string> candidates = {
+        path,
+        string("../") + path,
+        string("ai-q-main/") + path,
+        string("../ai-q-main/") + path};
+    for (const auto& p : candidates) {
+        ifstream in(p.c_str(), ios::binary);
+        if (in) {
+            return vector<uint8_t>((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        }
+    }
+    throw runtime_error("failed to open " + path);
+}
+
+/**
+ * Synthetic input with a fixed pattern so runs are comparable across hosts.
+ */
+vector<uint8_t> patternBuffer(size_t size) {
+    vector<uint8_t> data(size);
+    uint32_t x = 0x12345678u;
+    for (auto& byte : data) {
+        x = x * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(x >> 24);
+    }
+    return data;
+}
+
+/**
+ * Result of timing a kernel: wall time per iteration plus counters, if any.
+ */
+struct Measurement {
+    double secondsPerIter;
+    PerfSample perIter;
+};
+
+/**
+ * Runs fn repeatedly for at least ~200 ms and reports per-iteration cost.
+ */
+template <typename Fn>
+Measurement measure(PerfCounterGroup& counters, Fn&& fn) {
+    fn(); // warm caches and page in the input
+    size_t iterations = 1;
+    while (true) {
+        counters.start();
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            fn();
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        PerfSample sample = counters.stop();
+        if (elapsed >= 0.2 || iterations >= (size_t(1) << 30)) {
+            Measurement m{elapsed / iterations, sample};
+            if (sample.valid) {
+                m.perIter.cycles /= iterations;
+                m.perIter.instructions /= iterations;
+                m.perIter.cacheMisses /= iterations;
+                m.perIter.branchMisses /= iterations;
+            }
+            return m;
+        }
+        iterations *= 4;
+    }
+}
+
+void printCounters(const PerfSample& s, double bytes) {
+    if (!s.valid) {
+        printf("  cycles/B      n/a   (perf counters unavailable)\n");
+        return;
+    }
+    printf("  cycles/B %8.2f   IPC %5.2f   cache-miss %8llu   branch-miss %8llu\n",
+           bytes > 0 ? s.cycles / bytes : 0.0,
+           s.cycles > 0 ? static_cast<double>(s.instructions) / s.cycles : 0.0,
+           static_cast<unsigned long long>(s.cacheMisses),
+           static_cast<unsigned long long>(s.branchMisses));
+}
+
+volatile size_t gSink; // defeats dead-code elimination of benchmark results
+
+void benchSha256(PerfCounterGroup& counters) {
+    printf("== sha256 (scalar)\n");
+    for (size_t size : {size_t(64), size_t(1024), size_t(64 * 1024), size_t(4 * 1024 * 1024)}) {
+        auto data = patternBuffer(size);
+        Measurement m = measure(counters, [&] { gSink = sha256Hex(data).size(); });
+        printf("%9zu B  %9.1f MB/s", size, size / m.secondsPerIter / 1e6);
+        printCounters(m.perIter, static_cast<double>(size));
+    }
+}
+
+void benchDetectMime(PerfCounterGroup& counters) {
+    printf("== detectMime\n");
+    for (const char* name : {"sample.pdf", "sample.docx", "sample.png"}) {
+        auto data = loadFile(string("test/resources/") + name);
+        Measurement m = measure(counters, [&] { gSink = detectMime(data).size(); });
+        printf("%-12s %9.1f ns/call", name, m.secondsPerIter * 1e9);
+        if (m.perIter.valid) {
+            printf("  cycles/call %llu\n", static_cast<unsigned long long>(m.perIter.cycles));
+        } else {
+            printf("\n");
+        }
+    }
+}
+
+/**
+ * A synthetic signature table: distinct first bytes, 6-byte patterns.
+ */
+template <size_t N>
+constexpr array<MagicSignature, N> syntheticSignatures() {
+    array<MagicSignature, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = 0; j < 6; ++j) {
+            table[i].bytes[j] = static_cast<uint8_t>((i * 37 + j * 101 + 11) & 0xFF);
+            table[i].mask[j] = 0xFF;
+        }
+        table[i].length = 6;
+        table[i].type = static_cast<MimeType>(i % static_cast<size_t>(MimeType::Count));
+    }
+    return table;
+}
+
+/**
+ * Baseline for comparison: test every signature in turn, as an if-chain would.
+ */
+template <size_t N>
+MimeType linearMatch(const array<MagicSignature, N>& table, const uint8_t* head, size_t len) {
+    for (const auto& sig : table) {
+        if (len < sig.length) continue;
+        bool match = true;
+        for (size_t j = 0; j < sig.length && match; ++j) {
+            match = (head[j] & sig.mask[j]) == sig.bytes[j];
+        }
+        if (match) return sig.type;
+    }
+    return MimeType::OctetStream;
+}
+
+/**
+ * Times dispatch and linear matching over a fixed mix of heads: half random,
+ * half copies of signatures from the table.
+ */
+template <size_t N>
+void benchMagicTable(PerfCounterGroup& counters) {
+    static constexpr array<MagicSignature, N> table = syntheticSignatures<N>();
+    static constexpr MagicIndex<N> index = buildMagicIndex(table);
+
+    constexpr size_t kHeads = 1024;
+    auto noise = patternBuffer(kHeads * kMaxMagicLength);
+    for (size_t h = 0; h < kHeads; h += 2) {
+        const auto& sig = table[(h * 7) % N];
+        copy(sig.bytes.begin(), sig.bytes.begin() + sig.length, noise.begin() + h * kMaxMagicLength);
+    }
+
+    Measurement dispatch = measure(counters, [&] {
+        size_t acc = 0;
+        for (size_t h = 0; h < kHeads; ++h) {
+            acc += static_cast<size_t>(matchMagic(index, noise.data() + h * kMaxMagicLength, kMaxMagicLength).type);
+        }
+        gSink = acc;
+    });
+    Measurement linear = measure(counters, [&] {
+        size_t acc = 0;
+        for (size_t h = 0; h < kHeads; ++h) {
+            acc += static_cast<size_t>(linearMatch(table, noise.data() + h * kMaxMagicLength, kMaxMagicLength));
+        }
+        gSink = acc;
+    });
+    printf("%4zu signatures  first-byte dispatch %6.2f ns/sniff   linear scan %7.2f ns/sniff\n",
+           N, dispatch.secondsPerIter * 1e9 / kHeads, linear.secondsPerIter * 1e9 / kHeads);
+}
+
+void benchMagicScaling(PerfCounterGroup& counters) {
+    printf("== magic signature matching\n");
+    benchMagicTable<3>(counters);
+    benchMagicTable<8>(counters);
+    benchMagicTable<16>(counters);
+    benchMagicTable<32>(counters);
+    benchMagicTable<64>(counters);
+    benchMagicTable<128>(counters);
+}
+
+/**
+ * ZIP marker search over a 4 KiB sniff window with no markers present (the
+ * worst case: the whole window is scanned): one string_view::find per marker
+ * versus one multi-needle pass per engine.
+ */
+void benchMarkerSearch(PerfCounterGroup& counters) {
+    printf("== zip marker search (4 KiB window, no match)\n");
+    const vector<string_view> markers = {"word/", "xl/", "ppt/", "[Content_Types].xml", "mimetype"};
+    auto window = patternBuffer(4096);
+    const string_view haystack(reinterpret_cast<const char*>(window.data()), window.size());
+
+    Measurement finds = measure(counters, [&] {
+        size_t acc = 0;
+        for (string_view marker : markers) {
+            acc += haystack.find(marker) != string_view::npos;
+        }
+        gSink = acc;
+    });
+    printf("%-22s %8.1f ns/window  %7.2f GB/s\n", "string_view::find x5", finds.secondsPerIter * 1e9,
+           window.size() / finds.secondsPerIter / 1e9);
+
+    MultiNeedleSearch search{"word/", "xl/", "ppt/", "[Content_Types].xml", "mimetype"};
+    for (auto engine : {MultiNeedleSearch::Engine::Scalar, MultiNeedleSearch::Engine::Sse2,
+                        MultiNeedleSearch::Engine::Avx2}) {
+        if (!MultiNeedleSearch::engineSupported(engine)) continue;
+        search.setEngine(engine);
+        Measurement m = measure(counters, [&] { gSink = search.findAll(window.data(), window.size()); });
+        printf("multi-needle %-9s %8.1f ns/window  %7.2f GB/s\n", MultiNeedleSearch::engineName(engine),
+               m.secondsPerIter * 1e9, window.size() / m.secondsPerIter / 1e9);
+    }
+}
+
+void benchCrc32(PerfCounterGroup& counters) {
+    printf("== crc32\n");
+    for (size_t size : {size_t(64), size_t(4096), size_t(64 * 1024), size_t(4 * 1024 * 1024)}) {
+        auto data = patternBuffer(size);
+        for (auto engine : {Crc32::Engine::SliceBy8, Crc32::Engine::Pclmul}) {
+            if (!Crc32::engineSupported(engine)) continue;
+            Crc32 crc;
+            crc.setEngine(engine);
+            Measurement m = measure(counters, [&] {
+                crc.reset();
+                crc.update(data.data(), data.size());
+                gSink = crc.value();
+            });
+            printf("%9zu B  %-10s %9.1f MB/s", size, Crc32::engineName(engine), size / m.secondsPerIter / 1e6);
+            printCounters(m.perIter, static_cast<double>(size));
+        }
+    }
+}
+
+void benchZipVerify(PerfCounterGroup& counters) {
+    printf("== zip integrity (sample.docx, inflate + crc32)\n");
+    auto data = loadFile("test/resources/sample.docx");
+    Measurement m = measure(counters, [&] {
+        ZipIntegrityVerifier verifier;
+        verifier.feed(data.data(), data.size());
+        verifier.finish();
+        gSink = verifier.entriesVerified();
+    });
+    printf("%9zu B  %9.1f MB/s", data.size(), data.size() / m.secondsPerIter / 1e6);
+    printCounters(m.perIter, static_cast<double>(data.size()));
+}
+
+void benchPdfScan(PerfCounterGroup& counters) {
+    printf("== pdf structure scan (sample.pdf, 64 KiB chunks)\n");
+    auto data = loadFile("test/resources/sample.pdf");
+    Measurement m = measure(counters, [&] {
+        PdfStructureScanner scanner;
+        for (size_t i = 0; i < data.size(); i += 64 * 1024) {
+            scanner.feed(data.data() + i, min<size_t>(64 * 1024, data.size() - i));
+        }
+        gSink = scanner.finish().eofMarkers;
+    });
+    printf("%9zu B  %9.1f MB/s", data.size(), data.size() / m.secondsPerIter / 1e6);
+    printCounters(m.perIter, static_cast<double>(data.size()));
+}
+
+/**
+ * Active-content marker scan over sample.pdf in 64 KiB chunks: a separate
+ * string_view::find pass per marker versus one automaton pass per engine.
+ */
+void benchContentPatterns(PerfCounterGroup& counters) {
+    printf("== content patterns (sample.pdf, 5 markers)\n");
+    const vector<string> markers = {"/JavaScript", "/Launch", "/OpenAction", "/EmbeddedFile", "vbaProject.bin"};
+    auto data = loadFile("test/resources/sample.pdf");
+    const string_view haystack(reinterpret_cast<const char*>(data.data()), data.size());
+
+    Measurement finds = measure(counters, [&] {
+        size_t acc = 0;
+        for (const string& marker : markers) {
+            acc += haystack.find(marker) != string_view::npos;
+        }
+        gSink = acc;
+    });
+    printf("%-22s %9.1f MB/s", "string_view::find x5", data.size() / finds.secondsPerIter / 1e6);
+    printCounters(finds.perIter, static_cast<double>(data.size()));
+
+    AhoCorasick matcher(markers);
+    for (auto engine : {AhoCorasick::Engine::Scalar, AhoCorasick::Engine::Ssse3, AhoCorasick::Engine::Avx2}) {
+        if (!AhoCorasick::engineSupported(engine)) continue;
+        matcher.setEngine(engine);
+        Measurement m = measure(counters, [&] {
+            PatternScanner scanner(matcher);
+            for (size_t i = 0; i < data.size(); i += 64 * 1024) {
+                scanner.feed(data.data() + i, min<size_t>(64 * 1024, data.size() - i));
+            }
+            gSink = scanner.hits();
+        });
+        printf("aho-corasick %-9s %9.1f MB/s", AhoCorasick::engineName(engine), data.size() / m.secondsPerIter / 1e6);
+        printCounters(m.perIter, static_cast<double>(data.size()));
+    }
+}
+
+/**
+ * Each selectable digest alone over 4 MiB, then all of them through one
+ * MultiDigest (slice-interleaved) versus one full pass per digest.
+ */
+void benchDigests(PerfCounterGroup& counters) {
+    printf("== digests (4 MiB)\n");
+    auto data = patternBuffer(4 * 1024 * 1024);
+    DigestSelection all;
+    for (size_t i = 0; i < static_cast<size_t>(DigestAlgorithm::Count); ++i) {
+        const auto algorithm = static_cast<DigestAlgorithm>(i);
+        DigestSelection one;
+        one.add(algorithm);
+        all.add(algorithm);
+        Measurement m = measure(counters, [&] {
+            MultiDigest digest(one);
+            digest.update(data.data(), data.size());
+            gSink = digest.finish()[algorithm].bytes[0];
+        });
+        printf("%-22s %9.1f MB/s", digestAlgorithmName(algorithm), data.size() / m.secondsPerIter / 1e6);
+        printCounters(m.perIter, static_cast<double>(data.size()));
+    }
+    for (auto engine : {Crc32c::Engine::SliceBy8, Crc32c::Engine::Sse42}) {
+        if (!Crc32c::engineSupported(engine)) continue;
+        Crc32c crc;
+        crc.setEngine(engine);
+        Measurement m = measure(counters, [&] {
+            crc.reset();
+            crc.update(data.data(), data.size());
+            gSink = crc.value();
+        });
+        printf("crc32c %-15s %9.1f MB/s\n", Crc32c::engineName(engine), data.size() / m.secondsPerIter / 1e6);
+    }
+    Measurement interleaved = measure(counters, [&] {
+        MultiDigest digest(all);
+        digest.update(data.data(), data.size());
+        gSink = digest.finish()[DigestAlgorithm::Md5].bytes[0];
+    });
+    printf("%-22s %9.1f MB/s", "all, interleaved", data.size() / interleaved.secondsPerIter / 1e6);
+    printCounters(interleaved.perIter, static_cast<double>(data.size()));
+    Measurement separate = measure(counters, [&] {
+        size_t acc = 0;
+        all.forEach([&](DigestAlgorithm algorithm) {
+            DigestSelection one;
+            one.add(algorithm);
+            MultiDigest digest(one);
+            digest.update(data.data(), data.size());
+            acc += digest.finish()[algorithm].bytes[0];
+        });
+        gSink = acc;
+    });
+    printf("%-22s %9.1f MB/s", "all, pass per digest", data.size() / separate.secondsPerIter / 1e6);
+    printCounters(separate.perIter, static_cast<double>(data.size()));
+}
+
+void benchBlake3(PerfCounterGroup& counters) {
+    printf("== blake3 (64 MiB; %u hardware threads)\n", max(1u, thread::hardware_concurrency()));
+    auto data = patternBuffer(64 * 1024 * 1024);
+    for (auto engine : {Blake3::Engine::Portable, Blake3::Engine::Avx2}) {
+        if (!Blake3::engineSupported(engine)) continue;
+        for (unsigned threads : {1u, 2u, 4u, 0u}) {
+            Measurement m = measure(counters, [&] { gSink = Blake3::hash(data.data(), data.size(), threads, engine)[0]; });
+            char label[32];
+            snprintf(label, sizeof(label), "%s, %u threads", Blake3::engineName(engine), threads);
+            printf("%-22s %9.1f MB/s\n", label, data.size() / m.secondsPerIter / 1e6);
+        }
+    }
+}
+
+void benchXxh3(PerfCounterGroup& counters) {
+    printf("== xxh3 (16 MiB, fed in 64 KiB reads)\n");
+    auto data = patternBuffer(16 * 1024 * 1024);
+    constexpr size_t kRead = 64 * 1024;
+    for (auto engine : {Xxh3::Engine::Scalar, Xxh3::Engine::Avx2}) {
+        if (!Xxh3::engineSupported(engine)) continue;
+        Measurement m = measure(counters, [&] {
+            Xxh3 hasher;
+            hasher.setEngine(engine);
+            for (size_t i = 0; i < data.size(); i += kRead) {
+                hasher.update(data.data() + i, min(kRead, data.size() - i));
+            }
+            gSink = static_cast<size_t>(hasher.digest64());
+        });
+        printf("%-22s %9.1f MB/s\n", Xxh3::engineName(engine), data.size() / m.secondsPerIter / 1e6);
+    }
+}
+
+vector<CdcChunk> cdcChunks(const vector<uint8_t>& data, uint32_t averageSize) {
+    FastCdcChunker chunker(averageSize);
+    vector<CdcChunk> chunks;
+    for (size_t i = 0; i < data.size(); i += 64 * 1024) {
+        chunker.update(data.data() + i, min<size_t>(64 * 1024, data.size() - i), chunks);
+    }
+    chunker.finish(chunks);
+    return chunks;
+}
+
+/**
+ * Fraction of the bytes of edited that lie in chunks the original already has.
+ */
+double sharedFraction(const vector<CdcChunk>& original, const vector<CdcChunk>& edited, uint64_t editedSize) {
+    set<array<uint8_t, 32>> known;
+    for (const auto& chunk : original) known.insert(chunk.digest.bytes);
+    uint64_t shared = 0;
+    for (const auto& chunk : edited) {
+        if (known.count(chunk.digest.bytes)) shared += chunk.length;
+    }
+    return editedSize == 0 ? 0 : static_cast<double>(shared) / editedSize;
+}
+
+/**
+ * FastCDC throughput (chunking plus per-chunk SHA-256), and the share of
+ * bytes deduplicated against the original when a sample file is edited in
+ * ten places; fixed-size chunks of the same average are shown for contrast.
+ */
+void benchFastCdc(PerfCounterGroup& counters) {
+    printf("== fastcdc (16 MiB)\n");
+    auto data = patternBuffer(16 * 1024 * 1024);
+    for (uint32_t average : {4096u, 16384u, 65536u}) {
+        Measurement m = measure(counters, [&] { gSink = cdcChunks(data, average).size(); });
+        printf("avg %6u B            %9.1f MB/s", average, data.size() / m.secondsPerIter / 1e6);
+        printCounters(m.perIter, static_cast<double>(data.size()));
+    }
+
+    constexpr uint32_t kAverage = 8192;
+    auto fixedChunks = [](const vector<uint8_t>& bytes) {
+        vector<CdcChunk> chunks;
+        for (size_t offset = 0; offset < bytes.size(); offset += kAverage) {
+            CdcChunk chunk;
+            chunk.length = static_cast<uint32_t>(min<size_t>(kAverage, bytes.size() - offset));
+            Sha256 hasher;
+            hasher.update(bytes.data() + offset, chunk.length);
+            chunk.digest = hasher.finish();
+            chunks.push_back(chunk);
+        }
+        return chunks;
+    };
+    printf("dedup vs original, 10 edits of 16 B (avg %u B): fastcdc / fixed-size\n", kAverage);
+    for (const char* name : {"sample.pdf", "sample.png"}) {
+        auto original = loadFile(string("test/resources/") + name);
+        const auto originalCdc = cdcChunks(original, kAverage);
+        const auto originalFixed = fixedChunks(original);
+        for (const char* edit : {"insert", "delete", "overwrite"}) {
+            vector<uint8_t> edited = original;
+            mt19937 rng(7);
+            for (int i = 0; i < 10; ++i) {
+                const size_t at = rng() % (edited.size() - 16);
+                if (edit[0] == 'i') {
+                    edited.insert(edited.begin() + at, 16, 0x5a);
+                } else if (edit[0] == 'd') {
+                    edited.erase(edited.begin() + at, edited.begin() + at + 16);
+                } else {
+                    fill(edited.begin() + at, edited.begin() + at + 16, 0x5a);
+                }
+            }
+            printf("%-11s %-10s %6.1f%% / %6.1f%%\n", name, edit,
+                   100 * sharedFraction(originalCdc, cdcChunks(edited, kAverage), edited.size()),
+                   100 * sharedFraction(originalFixed, fixedChunks(edited), edited.size()));
+        }
+    }
+}
+
+void benchTlsh(PerfCounterGroup& counters) {
+    printf("== tlsh (16 MiB)\n");
+    auto data = patternBuffer(16 * 1024 * 1024);
+    Measurement m = measure(counters, [&] {
+        Tlsh hasher;
+        hasher.update(data.data(), data.size());
+        gSink = hasher.finish().checksum;
+    });
+    printf("%-22s %9.1f MB/s", "tlsh", data.size() / m.secondsPerIter / 1e6);
+    printCounters(m.perIter, static_cast<double>(data.size()));
+}
+
+void benchByteHistogram(PerfCounterGroup& counters) {
+    printf("== byte histogram (16 MiB)\n");
+    auto random = patternBuffer(16 * 1024 * 1024);
+    vector<uint8_t> runs(random.size(), 0);
+    for (auto input : {make_pair("random", &random), make_pair("zeros", &runs)}) {
+        const vector<uint8_t>& data = *input.second;
+        Measurement m = measure(counters, [&] {
+            ByteHistogram histogram;
+            histogram.update(data.data(), data.size());
+            gSink = static_cast<size_t>(histogram.entropy());
+        });
+        printf("%-22s %9.1f MB/s", input.first, data.size() / m.secondsPerIter / 1e6);
+        printCounters(m.perIter, static_cast<double>(data.size()));
+    }
+}
+
+void benchUtf8(PerfCounterGroup& counters) {
+    printf("== utf8 validation (16 MiB, fed in 64 KiB reads)\n");
+    const string ascii = "Invoice 2024-117, net 30 days; see attached statement.\n";
+    const string mixed = "Zo\xC3\xAB K\xC3\xB8" "benhavn \xE2\x82\xAC" "12 \xE6\x9D\xB1\xE4\xBA\xAC \xF0\x9F\x93\x84\n";
+    constexpr size_t kRead = 64 * 1024;
+    for (const auto& text : {make_pair("ascii", &ascii), make_pair("mixed", &mixed)}) {
+        vector<uint8_t> data;
+        while (data.size() < 16 * 1024 * 1024) data.insert(data.end(), text.second->begin(), text.second->end());
+        for (auto engine : {Utf8Validator::Engine::Scalar, Utf8Validator::Engine::Avx2}) {
+            if (!Utf8Validator::engineSupported(engine)) continue;
+            Measurement m = measure(counters, [&] {
+                Utf8Validator validator;
+                validator.setEngine(engine);
+                for (size_t i = 0; i < data.size(); i += kRead) {
+                    validator.update(data.data() + i, min(kRead, data.size() - i));
+                }
+                gSink = validator.valid();
+            });
+            printf("%-6s %-15s %9.1f MB/s", text.first, Utf8Validator::engineName(engine),
+                   data.size() / m.secondsPerIter / 1e6);
+            printCounters(m.perIter, static_cast<double>(data.size()));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    PerfCounterGroup counters;
+    printf("perf counters: %s\n", counters.available() ? "available" : "unavailable");
+    benchSha256(counters);
+    benchDetectMime(counters);
+    benchMagicScaling(counters);
+    benchMarkerSearch(counters);
+    benchCrc32(counters);
+    benchDigests(counters);
+    benchBlake3(counters);
+    benchXxh3(counters);
+    benchFastCdc(counters);
+    benchTlsh(counters);
+    benchByteHistogram(counters);
+    benchUtf8(counters);
+    benchZipVerify(counters);
+    benchPdfScan(counters);
+    benchContentPatterns(counters);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "active_content.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+enum Marker : unsigned { VbaProject };
+
+/**
+ * Internal: markers searched for in relationship and content types parts.
+ * "vbaProject" appears in both the VBA relationship type and content type.
+ */
+const AhoCorasick& packageMarkers() {
+    static const AhoCorasick matcher({"vbaProject"});
+    return matcher;
+}
+
+// Names and values are only compared against short constants; longer ones are cut here.
+constexpr size_t kMaxToken = 64;
+
+/**
+ * Internal: relationship types (the last segment of the Type URI) that load
+ * an external target when the document opens, as template injection and
+ * remote OLE objects do.
+ */
+constexpr string_view kLoadingTypes[] = {"attachedTemplate", "oleObject", "frame", "subDocument"};
+
+inline bool isXmlSpace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline void appendToken(string& token, char c) {
+    if (token.size() < kMaxToken) {
+        token += c;
+    }
+}
+
+/**
+ * Internal: the local part of a qualified XML name.
+ */
+string_view localName(string_view name) {
+    const size_t colon = name.rfind(':');
+    return colon == string_view::npos ? name : name.substr(colon + 1);
+}
+
+/**
+ * Internal: case-insensitive suffix test; OPC part names ignore ASCII case.
+ */
+bool endsWithIgnoreCase(string_view name, string_view suffix) {
+    if (name.size() < suffix.size()) {
+        return false;
+    }
+    name.remove_prefix(name.size() - suffix.size());
+    for (size_t i = 0; i < suffix.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(name[i])) != tolower(static_cast<unsigned char>(suffix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace (internal)
+
+bool OoxmlActiveContentScanner::onEntryStart(const ZipEntry& entry) {
+    state_ = AhoCorasick::kStart;
+    xml_ = Xml::Text;
+    if (endsWithIgnoreCase(entry.name, "vbaProject.bin")) {
+        active_.macros = true;
+    }
+    // Truncated names cannot be classified; their content is not needed.
+    relationshipPart_ = !entry.nameTruncated && endsWithIgnoreCase(entry.name, ".rels");
+    return relationshipPart_ || (!entry.nameTruncated && endsWithIgnoreCase(entry.name, "[Content_Types].xml"));
+}
+
+void OoxmlActiveContentScanner::onEntryContent(const uint8_t* data, size_t len) {
+    state_ = packageMarkers().scan(state_, data, len, hits_);
+    active_.macros = active_.macros || (hits_ & (1u << VbaProject)) != 0;
+    if (relationshipPart_) {
+        parseRelationships(data, len);
+    }
+}
+
+void OoxmlActiveContentScanner::parseRelationships(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        const char c = static_cast<char>(data[i]);
+        const bool space = isXmlSpace(data[i]);
+        switch (xml_) {
+        case Xml::Text:
+            if (c == '<') {
+                xml_ = Xml::TagName;
+                tagName_.clear();
+                externalMode_ = false;
+                loadingType_ = false;
+            }
+            break;
+        case Xml::TagName:
+            if (c == '>') {
+                endTag();
+            } else if (space || c == '/') {
+                xml_ = Xml::Attributes;
+            } else {
+                appendToken(tagName_, c);
+                if (tagName_ == "!--") {
+                    xml_ = Xml::Comment;
+                    commentDashes_ = 0;
+                }
+            }
+            break;
+        case Xml::Comment:
+            if (c == '>' && commentDashes_ >= 2) {
+                xml_ = Xml::Text;
+            }
+            commentDashes_ = c == '-' ? commentDashes_ + 1 : 0;
+            break;
+        case Xml::Attributes:
+            if (c == '>') {
+                endTag();
+            } else if (!space && c != '/') {
+                attributeName_.assign(1, c);
+                xml_ = Xml::AttributeName;
+            }
+            break;
+        case Xml::AttributeName:
+        case Xml::BeforeEquals:
+            if (c == '=') {
+                xml_ = Xml::BeforeValue;
+            } else if (c == '>') {
+                endTag();
+            } else if (space) {
+                xml_ = Xml::BeforeEquals;
+            } else if (xml_ == Xml::AttributeName) {
+                appendToken(attributeName_, c);
+            } else {
+                attributeName_.assign(1, c); // the previous attribute had no value
+                xml_ = Xml::AttributeName;
+            }
+            break;
+        case Xml::BeforeValue:
+            if (c == '"' || c == '\'') {
+                quote_ = c;
+                value_.clear();
+                xml_ = Xml::Value;
+            } else if (c == '>') {
+                endTag();
+            }
+            break;
+        case Xml::Value:
+            if (c == quote_) {
+                endAttribute();
+                xml_ = Xml::Attributes;
+            } else if (c == '/') {
+                value_.clear(); // keep the last segment of a URI
+            } else if (!(space && value_.empty())) {
+                appendToken(value_, c);
+            }
+            break;
+        }
+    }
+}
+
+void OoxmlActiveContentScanner::endAttribute() {
+    string_view value = value_;
+    while (!value.empty() && isXmlSpace(static_cast<uint8_t>(value.back()))) {
+        value.remove_suffix(1);
+    }
+    const string_view name = localName(attributeName_);
+    if (name == "TargetMode") {
+        externalMode_ = value == "External";
+    } else if (name == "Type") {
+        loadingType_ = false;
+        for (string_view type : kLoadingTypes) {
+            loadingType_ = loadingType_ || value == type;
+        }
+    }
+}
+
+void OoxmlActiveContentScanner::endTag() {
+    xml_ = Xml::Text;
+    if (externalMode_ && loadingType_ && localName(tagName_) == "Relationship") {
+        active_.externalRelationships = true;
+    }
+}
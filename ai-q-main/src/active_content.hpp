@@ -0,0 +1,69 @@
+#pragma once
+
+#include "aho_corasick.hpp"
+#include "zip_verify.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Active or externally linked content found in a document. Reported on the
+ * ingest result for security review; none of it fails validation.
+ */
+struct ActiveContent {
+    // PDF (PDF 32000 7.6, 12.6.4.16, 12.6.3, 7.11.4).
+    bool encrypted = false;     // an /Encrypt dictionary
+    bool javaScript = false;    // /JavaScript actions or name tree
+    bool openAction = false;    // an /OpenAction run when the file opens
+    bool embeddedFiles = false; // /EmbeddedFile streams
+    // OOXML ([MS-OFFMACRO], ECMA-376 Part 2 9.3).
+    bool macros = false; // a VBA project part
+    // An external relationship (TargetMode="External") of a type that loads
+    // content when the document opens: an attached template, OLE object,
+    // frame or subdocument. External hyperlinks are not flagged.
+    bool externalRelationships = false;
+
+    bool any() const {
+        return encrypted || javaScript || openAction || embeddedFiles || macros || externalRelationships;
+    }
+};
+
+/**
+ * Finds macros and external relationships in an OOXML package (DOCX, XLSX,
+ * PPTX) as a ZipIntegrityVerifier walks it. A VBA project is recognised by a
+ * part named vbaProject.bin; relationship parts (*.rels) and the content
+ * types part are read as the verifier inflates them and searched for VBA
+ * project references, which also catches a renamed VBA part. Relationship
+ * parts are also tokenized element by element, so the Type and TargetMode
+ * attributes are read however they are quoted, spaced or ordered.
+ */
+class OoxmlActiveContentScanner final : public ZipContentVisitor {
+public:
+    bool onEntryStart(const ZipEntry& entry) override;
+    void onEntryContent(const std::uint8_t* data, std::size_t len) override;
+
+    const ActiveContent& activeContent() const { return active_; }
+
+private:
+    enum class Xml : std::uint8_t { Text, TagName, Attributes, AttributeName, BeforeEquals, BeforeValue, Value, Comment };
+
+    void parseRelationships(const std::uint8_t* data, std::size_t len);
+    void endAttribute();
+    void endTag();
+
+    ActiveContent active_;
+    AhoCorasick::State state_ = AhoCorasick::kStart;
+    std::uint64_t hits_ = 0;
+
+    // Tokenizer state for the current relationship part.
+    bool relationshipPart_ = false;
+    Xml xml_ = Xml::Text;
+    std::string tagName_;
+    std::string attributeName_;
+    std::string value_;
+    char quote_ = 0;
+    unsigned commentDashes_ = 0;
+    bool externalMode_ = false;
+    bool loadingType_ = false;
+};
@@ -0,0 +1,235 @@
+#include "aho_corasick.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_AC_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_AC_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr AhoCorasick::State kNoTransition = UINT32_MAX;
+
+#if INGEST_AC_X86
+
+/**
+ * Internal: SSSE3 prefilter. Returns the first position at or after pos whose
+ * byte passes the nibble-table test, or the start of the unscanned tail.
+ */
+__attribute__((target("ssse3"))) size_t skipSsse3(const uint8_t* lowTable, const uint8_t* highTable,
+                                                  const uint8_t* data, size_t pos, size_t len) {
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lowTable));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(highTable));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    for (; pos + 16 <= len; pos += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const __m128i lo = _mm_shuffle_epi8(low, _mm_and_si128(v, nibble));
+        const __m128i hi = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        const uint32_t miss = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)));
+        if (miss != 0xFFFFu) {
+            return pos + static_cast<size_t>(__builtin_ctz(~miss));
+        }
+    }
+    return pos;
+}
+
+/**
+ * Internal: AVX2 variant of skipSsse3, 32 bytes per step. The tables are
+ * repeated in both 128-bit lanes since vpshufb looks up within each lane.
+ */
+__attribute__((target("avx2"))) size_t skipAvx2(const uint8_t* lowTable, const uint8_t* highTable,
+                                                const uint8_t* data, size_t pos, size_t len) {
+    const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lowTable)));
+    const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(highTable)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; pos + 32 <= len; pos += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        const __m256i lo = _mm256_shuffle_epi8(low, _mm256_and_si256(v, nibble));
+        const __m256i hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const uint32_t miss =
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero)));
+        if (miss != 0xFFFFFFFFu) {
+            return pos + static_cast<size_t>(__builtin_ctz(~miss));
+        }
+    }
+    return pos;
+}
+
+#endif
+
+AhoCorasick::Engine detectBestEngine() {
+#if INGEST_AC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AhoCorasick::Engine::Avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return AhoCorasick::Engine::Ssse3;
+    }
+#endif
+    return AhoCorasick::Engine::Scalar;
+}
+
+} // namespace (internal)
+
+AhoCorasick::AhoCorasick(const vector<string>& patterns) : patterns_(patterns) {
+    if (patterns_.size() > kMaxPatterns) {
+        throw runtime_error("pattern matcher supports at most " + to_string(kMaxPatterns) + " patterns");
+    }
+    size_t totalLength = 0;
+    for (const string& pattern : patterns_) {
+        if (pattern.empty()) {
+            throw runtime_error("pattern matcher patterns must not be empty");
+        }
+        totalLength += pattern.size();
+    }
+    if (totalLength > kMaxTotalLength) {
+        throw runtime_error("pattern matcher patterns exceed " + to_string(kMaxTotalLength) + " bytes in total");
+    }
+
+    // Byte classes: 0 for bytes no pattern uses, then one per distinct byte.
+    for (const string& pattern : patterns_) {
+        for (char c : pattern) {
+            const uint8_t byte = static_cast<uint8_t>(c);
+            if (classOf_[byte] == 0) {
+                classOf_[byte] = static_cast<uint16_t>(classCount_++);
+            }
+        }
+    }
+
+    // Trie.
+    transitions_.assign(classCount_, kNoTransition);
+    output_.assign(1, 0);
+    for (size_t p = 0; p < patterns_.size(); ++p) {
+        State state = kStart;
+        for (char c : patterns_[p]) {
+            const size_t slot = state * classCount_ + classOf_[static_cast<uint8_t>(c)];
+            if (transitions_[slot] == kNoTransition) {
+                transitions_[slot] = static_cast<State>(output_.size());
+                transitions_.resize(transitions_.size() + classCount_, kNoTransition);
+                output_.push_back(0);
+            }
+            state = transitions_[slot];
+        }
+        output_[state] |= uint64_t(1) << p;
+    }
+
+    // Failure links in breadth-first order, folded into the table so every
+    // state has a transition on every class.
+    vector<State> failure(output_.size(), kStart);
+    vector<State> order;
+    order.reserve(output_.size());
+    for (size_t c = 0; c < classCount_; ++c) {
+        State& next = transitions_[c];
+        if (next == kNoTransition) {
+            next = kStart;
+        } else {
+            order.push_back(next);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        const State state = order[i];
+        output_[state] |= output_[failure[state]];
+        for (size_t c = 0; c < classCount_; ++c) {
+            State& next = transitions_[state * classCount_ + c];
+            const State fallback = transitions_[failure[state] * classCount_ + c];
+            if (next == kNoTransition) {
+                next = fallback;
+            } else {
+                failure[next] = fallback;
+                order.push_back(next);
+            }
+        }
+    }
+
+    // Prefilter tables: high nibbles are spread over eight buckets.
+    size_t highNibbles = 0;
+    array<int, 16> bucketOf;
+    bucketOf.fill(-1);
+    for (const string& pattern : patterns_) {
+        const uint8_t first = static_cast<uint8_t>(pattern[0]);
+        isStartByte_[first] = 1;
+        int& bucket = bucketOf[first >> 4];
+        if (bucket < 0) {
+            bucket = static_cast<int>(highNibbles++ % 8);
+        }
+        highNibble_[first >> 4] |= static_cast<uint8_t>(1u << bucket);
+        lowNibble_[first & 0x0F] |= static_cast<uint8_t>(1u << bucket);
+    }
+    engine_ = bestEngine();
+}
+
+uint64_t AhoCorasick::allPatterns() const {
+    return patterns_.size() == 64 ? ~uint64_t(0) : (uint64_t(1) << patterns_.size()) - 1;
+}
+
+size_t AhoCorasick::skipToCandidate(const uint8_t* data, size_t pos, size_t len) const {
+#if INGEST_AC_X86
+    if (engine_ == Engine::Avx2) {
+        pos = skipAvx2(lowNibble_.data(), highNibble_.data(), data, pos, len);
+    } else if (engine_ == Engine::Ssse3) {
+        pos = skipSsse3(lowNibble_.data(), highNibble_.data(), data, pos, len);
+    }
+#endif
+    while (pos < len && !isStartByte_[data[pos]]) {
+        ++pos;
+    }
+    return pos;
+}
+
+AhoCorasick::State AhoCorasick::scan(State state, const uint8_t* data, size_t len, uint64_t& hits) const {
+    if (patterns_.empty()) {
+        return state;
+    }
+    size_t pos = 0;
+    while (pos < len) {
+        if (state == kStart) {
+            pos = skipToCandidate(data, pos, len);
+            if (pos == len) {
+                break;
+            }
+        }
+        state = transitions_[state * classCount_ + classOf_[data[pos]]];
+        hits |= output_[state];
+        ++pos;
+    }
+    return state;
+}
+
+AhoCorasick::Engine AhoCorasick::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool AhoCorasick::engineSupported(Engine engine) {
+    return static_cast<int>(engine) <= static_cast<int>(bestEngine());
+}
+
+const char* AhoCorasick::engineName(Engine engine) {
+    switch (engine) {
+    case Engine::Avx2:
+        return "avx2";
+    case Engine::Ssse3:
+        return "ssse3";
+    case Engine::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+void AhoCorasick::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("pattern matcher engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
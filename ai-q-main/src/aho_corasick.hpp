@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Streaming multi-pattern matcher: an Aho-Corasick automaton compiled into a
+ * dense transition table over byte classes (bytes no pattern uses share one
+ * class), so each input byte costs one table lookup. The automaton state is
+ * the only thing carried between chunks, which makes matches straddling chunk
+ * boundaries fall out naturally.
+ *
+ * While the automaton sits in its start state, a prefilter skips ahead to the
+ * next byte that can begin a pattern: a nibble-table byte-set test over 32
+ * bytes per step with AVX2, 16 with SSSE3, or a table walk in the portable
+ * fallback. The widest engine the CPU supports is picked at runtime.
+ *
+ * Immutable after construction and safe to share between threads.
+ */
+class AhoCorasick {
+public:
+    static constexpr std::size_t kMaxPatterns = 64;
+    static constexpr std::size_t kMaxTotalLength = 4096;
+
+    enum class Engine {
+        Scalar,
+        Ssse3,
+        Avx2,
+    };
+
+    using State = std::uint32_t;
+    static constexpr State kStart = 0;
+
+    /**
+     * An empty set is allowed and matches nothing. Throws std::runtime_error on
+     * an empty pattern, more than kMaxPatterns, or more than kMaxTotalLength
+     * pattern bytes in total.
+     */
+    explicit AhoCorasick(const std::vector<std::string>& patterns);
+
+    std::size_t size() const { return patterns_.size(); }
+    const std::string& pattern(std::size_t index) const { return patterns_[index]; }
+
+    /**
+     * Bitmask with one bit per pattern; hits equal to it means every pattern was seen.
+     */
+    std::uint64_t allPatterns() const;
+
+    /**
+     * Runs the automaton over the buffer starting from state, setting bit i of
+     * hits for every pattern i that ends inside it, and returns the state to
+     * resume from with the next chunk.
+     */
+    State scan(State state, const std::uint8_t* data, std::size_t len, std::uint64_t& hits) const;
+
+    /**
+     * The widest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    Engine engine() const { return engine_; }
+
+    /**
+     * Pins the prefilter to a specific engine, e.g. to cross-check engines in
+     * tests and benchmarks. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+private:
+    std::size_t skipToCandidate(const std::uint8_t* data, std::size_t pos, std::size_t len) const;
+
+    std::vector<std::string> patterns_;
+    Engine engine_ = Engine::Scalar;
+    std::size_t classCount_ = 1;
+    std::array<std::uint16_t, 256> classOf_{};
+    // classCount_ entries per state.
+    std::vector<State> transitions_;
+    // Patterns ending at each state, including those reached through failure links.
+    std::vector<std::uint64_t> output_;
+    // Non-zero for bytes that start some pattern; drives the scalar prefilter.
+    std::array<std::uint8_t, 256> isStartByte_{};
+    // Byte-set test for the SIMD prefilter: a byte b may start a pattern when
+    // lowNibble_[b & 15] & highNibble_[b >> 4] is non-zero. Exact for up to
+    // eight distinct high nibbles, a superset beyond that.
+    std::array<std::uint8_t, 16> lowNibble_{};
+    std::array<std::uint8_t, 16> highNibble_{};
+};
+
+/**
+ * Per-upload matching state over a shared AhoCorasick.
+ */
+class PatternScanner {
+public:
+    explicit PatternScanner(const AhoCorasick& matcher) : matcher_(matcher), all_(matcher.allPatterns()) {}
+
+    void feed(const std::uint8_t* data, std::size_t len) {
+        state_ = matcher_.scan(state_, data, len, hits_);
+    }
+
+    /**
+     * False once every pattern has been seen (or there are none): further input cannot change hits().
+     */
+    bool active() const { return hits_ != all_; }
+
+    /**
+     * Bit i is set when pattern i occurred in the bytes fed so far.
+     */
+    std::uint64_t hits() const { return hits_; }
+
+private:
+    const AhoCorasick& matcher_;
+    std::uint64_t all_;
+    AhoCorasick::State state_ = AhoCorasick::kStart;
+    std::uint64_t hits_ = 0;
+};
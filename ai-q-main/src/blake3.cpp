@@ -0,0 +1,491 @@
+#include "blake3.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_BLAKE3_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_BLAKE3_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+using ChainingValue = Blake3::ChainingValue;
+
+constexpr ChainingValue kIv = {0x6A09E667u, 0xBB67AE85u, 0x3C6EF372u, 0xA54FF53Au,
+                               0x510E527Fu, 0x9B05688Cu, 0x1F83D9ABu, 0x5BE0CD19u};
+
+enum Flag : uint32_t {
+    ChunkStart = 1,
+    ChunkEnd = 2,
+    Parent = 4,
+    Root = 8,
+};
+
+constexpr size_t kRounds = 7;
+constexpr size_t kBatch = 8; // chunks per hashChunks() call
+
+using Schedule = array<array<uint8_t, 16>, kRounds>;
+
+/**
+ * Internal: the message word order of each round; round r + 1 applies the
+ * BLAKE3 permutation to the order of round r.
+ */
+constexpr Schedule makeSchedule() {
+    constexpr uint8_t permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+    Schedule schedule{};
+    for (uint8_t i = 0; i < 16; ++i) {
+        schedule[0][i] = i;
+    }
+    for (size_t r = 1; r < kRounds; ++r) {
+        for (size_t i = 0; i < 16; ++i) {
+            schedule[r][i] = schedule[r - 1][permutation[i]];
+        }
+    }
+    return schedule;
+}
+
+constexpr Schedule kSchedule = makeSchedule();
+
+inline uint32_t rotr(uint32_t x, unsigned n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void g(uint32_t* v, size_t a, size_t b, size_t c, size_t d, uint32_t x, uint32_t y) {
+    v[a] = v[a] + v[b] + x;
+    v[d] = rotr(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = rotr(v[b] ^ v[c], 12);
+    v[a] = v[a] + v[b] + y;
+    v[d] = rotr(v[d] ^ v[a], 8);
+    v[c] = v[c] + v[d];
+    v[b] = rotr(v[b] ^ v[c], 7);
+}
+
+/**
+ * Internal: the compression function truncated to the 8-word chaining value,
+ * which is all a 32-byte digest needs.
+ */
+void compress(ChainingValue& cv, const uint8_t block[64], uint32_t blockLen, uint64_t counter, uint32_t flags) {
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; ++i) {
+        m[i] = loadLe32(block + 4 * i);
+    }
+    uint32_t v[16] = {cv[0],  cv[1],  cv[2],  cv[3],  cv[4],  cv[5],
+                      cv[6],  cv[7],  kIv[0], kIv[1], kIv[2], kIv[3],
+                      static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), blockLen, flags};
+    for (const auto& s : kSchedule) {
+        g(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        g(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        g(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        cv[i] = v[i] ^ v[i + 8];
+    }
+}
+
+/**
+ * Internal: chaining values of whole chunks, one at a time.
+ */
+void hashChunksPortable(const uint8_t* data, size_t count, uint64_t counter, ChainingValue* out) {
+    for (size_t c = 0; c < count; ++c, data += Blake3::kChunkSize) {
+        ChainingValue cv = kIv;
+        for (size_t b = 0; b < 16; ++b) {
+            const uint32_t flags = (b == 0 ? uint32_t(ChunkStart) : 0) | (b == 15 ? uint32_t(ChunkEnd) : 0);
+            compress(cv, data + 64 * b, 64, counter + c, flags);
+        }
+        out[c] = cv;
+    }
+}
+
+#if INGEST_BLAKE3_X86
+
+#define INGEST_AVX2 __attribute__((target("avx2")))
+
+INGEST_AVX2 inline __m256i rot16(__m256i x) {
+    return _mm256_shuffle_epi8(x, _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2, 13, 12, 15,
+                                                  14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+INGEST_AVX2 inline __m256i rot12(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, 12), _mm256_slli_epi32(x, 20));
+}
+
+INGEST_AVX2 inline __m256i rot8(__m256i x) {
+    return _mm256_shuffle_epi8(x, _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1, 12, 15, 14,
+                                                  13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+INGEST_AVX2 inline __m256i rot7(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 25));
+}
+
+INGEST_AVX2 inline void g8(__m256i* v, size_t a, size_t b, size_t c, size_t d, __m256i x, __m256i y) {
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+    v[d] = rot16(_mm256_xor_si256(v[d], v[a]));
+    v[c] = _mm256_add_epi32(v[c], v[d]);
+    v[b] = rot12(_mm256_xor_si256(v[b], v[c]));
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+    v[d] = rot8(_mm256_xor_si256(v[d], v[a]));
+    v[c] = _mm256_add_epi32(v[c], v[d]);
+    v[b] = rot7(_mm256_xor_si256(v[b], v[c]));
+}
+
+/**
+ * Internal: transposes an 8x8 matrix of 32-bit words held in eight vectors.
+ */
+INGEST_AVX2 inline void transpose8(__m256i* v) {
+    const __m256i ab0145 = _mm256_unpacklo_epi32(v[0], v[1]);
+    const __m256i ab2367 = _mm256_unpackhi_epi32(v[0], v[1]);
+    const __m256i cd0145 = _mm256_unpacklo_epi32(v[2], v[3]);
+    const __m256i cd2367 = _mm256_unpackhi_epi32(v[2], v[3]);
+    const __m256i ef0145 = _mm256_unpacklo_epi32(v[4], v[5]);
+    const __m256i ef2367 = _mm256_unpackhi_epi32(v[4], v[5]);
+    const __m256i gh0145 = _mm256_unpacklo_epi32(v[6], v[7]);
+    const __m256i gh2367 = _mm256_unpackhi_epi32(v[6], v[7]);
+    const __m256i abcd04 = _mm256_unpacklo_epi64(ab0145, cd0145);
+    const __m256i abcd15 = _mm256_unpackhi_epi64(ab0145, cd0145);
+    const __m256i abcd26 = _mm256_unpacklo_epi64(ab2367, cd2367);
+    const __m256i abcd37 = _mm256_unpackhi_epi64(ab2367, cd2367);
+    const __m256i efgh04 = _mm256_unpacklo_epi64(ef0145, gh0145);
+    const __m256i efgh15 = _mm256_unpackhi_epi64(ef0145, gh0145);
+    const __m256i efgh26 = _mm256_unpacklo_epi64(ef2367, gh2367);
+    const __m256i efgh37 = _mm256_unpackhi_epi64(ef2367, gh2367);
+    v[0] = _mm256_permute2x128_si256(abcd04, efgh04, 0x20);
+    v[1] = _mm256_permute2x128_si256(abcd15, efgh15, 0x20);
+    v[2] = _mm256_permute2x128_si256(abcd26, efgh26, 0x20);
+    v[3] = _mm256_permute2x128_si256(abcd37, efgh37, 0x20);
+    v[4] = _mm256_permute2x128_si256(abcd04, efgh04, 0x31);
+    v[5] = _mm256_permute2x128_si256(abcd15, efgh15, 0x31);
+    v[6] = _mm256_permute2x128_si256(abcd26, efgh26, 0x31);
+    v[7] = _mm256_permute2x128_si256(abcd37, efgh37, 0x31);
+}
+
+/**
+ * Internal: up to eight consecutive chunks at once, chunk i in 32-bit lane i.
+ * Each block's message words are gathered by loading the block from every
+ * chunk and transposing. Lanes past count rehash the first chunk and are
+ * discarded, which still beats the portable loop from three chunks up.
+ */
+INGEST_AVX2 void hashChunksAvx2(const uint8_t* data, size_t count, uint64_t counter, ChainingValue* out) {
+    const uint8_t* chunks[8];
+    for (size_t lane = 0; lane < 8; ++lane) {
+        chunks[lane] = data + (lane < count ? lane : 0) * Blake3::kChunkSize;
+    }
+    uint32_t counterLow[8];
+    uint32_t counterHigh[8];
+    for (size_t i = 0; i < 8; ++i) {
+        counterLow[i] = static_cast<uint32_t>(counter + i);
+        counterHigh[i] = static_cast<uint32_t>((counter + i) >> 32);
+    }
+    const __m256i ctrLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counterLow));
+    const __m256i ctrHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counterHigh));
+
+    __m256i h[8];
+    for (size_t i = 0; i < 8; ++i) {
+        h[i] = _mm256_set1_epi32(static_cast<int>(kIv[i]));
+    }
+    for (size_t b = 0; b < 16; ++b) {
+        __m256i m[16];
+        for (size_t half = 0; half < 2; ++half) {
+            for (size_t lane = 0; lane < 8; ++lane) {
+                m[8 * half + lane] =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunks[lane] + 64 * b + 32 * half));
+            }
+            transpose8(m + 8 * half);
+        }
+        const uint32_t flags = (b == 0 ? uint32_t(ChunkStart) : 0) | (b == 15 ? uint32_t(ChunkEnd) : 0);
+        __m256i v[16] = {h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                         _mm256_set1_epi32(static_cast<int>(kIv[0])),
+                         _mm256_set1_epi32(static_cast<int>(kIv[1])),
+                         _mm256_set1_epi32(static_cast<int>(kIv[2])),
+                         _mm256_set1_epi32(static_cast<int>(kIv[3])),
+                         ctrLow,
+                         ctrHigh,
+                         _mm256_set1_epi32(64),
+                         _mm256_set1_epi32(static_cast<int>(flags))};
+        for (const auto& s : kSchedule) {
+            g8(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            g8(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            g8(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            g8(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            g8(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            g8(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            g8(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            g8(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+        }
+    }
+    transpose8(h);
+    for (size_t lane = 0; lane < count; ++lane) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out[lane].data()), h[lane]);
+    }
+}
+
+#undef INGEST_AVX2
+
+#endif
+
+void hashChunks(Blake3::Engine engine, const uint8_t* data, size_t count, uint64_t counter, ChainingValue* out) {
+#if INGEST_BLAKE3_X86
+    if (engine == Blake3::Engine::Avx2 && count >= 3) {
+        hashChunksAvx2(data, count, counter, out);
+        return;
+    }
+#else
+    (void)engine;
+#endif
+    hashChunksPortable(data, count, counter, out);
+}
+
+void parentBlock(const ChainingValue& left, const ChainingValue& right, uint8_t block[64]) {
+    for (size_t i = 0; i < 8; ++i) {
+        for (size_t k = 0; k < 4; ++k) {
+            block[4 * i + k] = static_cast<uint8_t>(left[i] >> (8 * k));
+            block[32 + 4 * i + k] = static_cast<uint8_t>(right[i] >> (8 * k));
+        }
+    }
+}
+
+ChainingValue parentCv(const ChainingValue& left, const ChainingValue& right, uint32_t flags = 0) {
+    uint8_t block[64];
+    parentBlock(left, right, block);
+    ChainingValue cv = kIv;
+    compress(cv, block, 64, 0, Parent | flags);
+    return cv;
+}
+
+array<uint8_t, 32> digestBytes(const ChainingValue& cv) {
+    array<uint8_t, 32> out;
+    for (size_t i = 0; i < 8; ++i) {
+        for (size_t k = 0; k < 4; ++k) {
+            out[4 * i + k] = static_cast<uint8_t>(cv[i] >> (8 * k));
+        }
+    }
+    return out;
+}
+
+/**
+ * Internal: bytes in the left subtree of a node covering len > kChunkSize
+ * bytes: the largest power-of-two number of chunks that leaves the right
+ * subtree non-empty.
+ */
+size_t leftLength(size_t len) {
+    size_t chunks = (len - 1) / Blake3::kChunkSize;
+    size_t power = 1;
+    while (chunks >>= 1) {
+        power <<= 1;
+    }
+    return power * Blake3::kChunkSize;
+}
+
+Blake3::Engine detectBestEngine() {
+#if INGEST_BLAKE3_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Blake3::Engine::Avx2;
+    }
+#endif
+    return Blake3::Engine::Portable;
+}
+
+} // namespace (internal)
+
+/**
+ * The node that becomes the root: the last chunk, or the parent of the last
+ * two subtrees. Kept uncompressed until it is known whether the root flag applies.
+ */
+struct Blake3::Output {
+    ChainingValue cv;
+    uint8_t block[64];
+    uint32_t blockLen;
+    uint64_t counter;
+    uint32_t flags;
+
+    ChainingValue chainingValue(uint32_t extraFlags = 0) const {
+        ChainingValue out = cv;
+        compress(out, block, blockLen, counter, flags | extraFlags);
+        return out;
+    }
+};
+
+Blake3::Engine Blake3::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool Blake3::engineSupported(Engine engine) {
+    return engine == Engine::Portable || bestEngine() == Engine::Avx2;
+}
+
+const char* Blake3::engineName(Engine engine) {
+    return engine == Engine::Avx2 ? "avx2" : "portable";
+}
+
+void Blake3::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("blake3 engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+Blake3::Blake3() : Blake3(bestEngine(), 0) {}
+
+Blake3::Blake3(Engine engine, uint64_t firstChunk) : engine_(engine), cv_(kIv), chunkCounter_(firstChunk) {}
+
+void Blake3::updateChunk(const uint8_t* data, size_t len) {
+    // The last block of a chunk is compressed with ChunkEnd, so a block is
+    // only compressed once input beyond it has arrived.
+    if (blockLen_ > 0) {
+        const size_t take = min(64 - blockLen_, len);
+        memcpy(block_ + blockLen_, data, take);
+        blockLen_ += take;
+        data += take;
+        len -= take;
+        if (len == 0) {
+            return;
+        }
+        compress(cv_, block_, 64, chunkCounter_, blocksCompressed_ == 0 ? uint32_t(ChunkStart) : 0);
+        ++blocksCompressed_;
+        blockLen_ = 0;
+    }
+    while (len > 64) {
+        compress(cv_, data, 64, chunkCounter_, blocksCompressed_ == 0 ? uint32_t(ChunkStart) : 0);
+        ++blocksCompressed_;
+        data += 64;
+        len -= 64;
+    }
+    memset(block_, 0, sizeof(block_));
+    memcpy(block_, data, len);
+    blockLen_ = len;
+}
+
+void Blake3::pushChunk(ChainingValue cv) {
+    // Each trailing zero bit of the chunk count completes one more subtree.
+    for (uint64_t total = chunkCounter_ + 1; (total & 1) == 0; total >>= 1) {
+        cv = parentCv(stack_[--stackLen_], cv);
+    }
+    stack_[stackLen_++] = cv;
+}
+
+void Blake3::update(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (chunkLength() == kChunkSize) {
+            pushChunk(chunkOutput().chainingValue());
+            ++chunkCounter_;
+            cv_ = kIv;
+            blockLen_ = 0;
+            blocksCompressed_ = 0;
+        }
+        // Whole chunks that are not the last go through hashChunks() in
+        // batches; at least one byte stays behind for the final chunk.
+        if (chunkLength() == 0 && len > kChunkSize) {
+            const size_t count = min(kBatch, (len - 1) / kChunkSize);
+            ChainingValue cvs[kBatch];
+            hashChunks(engine_, data, count, chunkCounter_, cvs);
+            for (size_t i = 0; i < count; ++i) {
+                pushChunk(cvs[i]);
+                ++chunkCounter_;
+            }
+            data += count * kChunkSize;
+            len -= count * kChunkSize;
+            continue;
+        }
+        const size_t take = min(kChunkSize - chunkLength(), len);
+        updateChunk(data, take);
+        data += take;
+        len -= take;
+    }
+}
+
+Blake3::Output Blake3::chunkOutput() const {
+    Output out;
+    out.cv = cv_;
+    memcpy(out.block, block_, sizeof(block_));
+    out.blockLen = static_cast<uint32_t>(blockLen_);
+    out.counter = chunkCounter_;
+    out.flags = ChunkEnd | (blocksCompressed_ == 0 ? uint32_t(ChunkStart) : 0);
+    return out;
+}
+
+Blake3::Output Blake3::output() const {
+    Output out = chunkOutput();
+    for (size_t i = stackLen_; i > 0; --i) {
+        const ChainingValue right = out.chainingValue();
+        out.cv = kIv;
+        parentBlock(stack_[i - 1], right, out.block);
+        out.blockLen = 64;
+        out.counter = 0;
+        out.flags = Parent;
+    }
+    return out;
+}
+
+array<uint8_t, 32> Blake3::finish() const {
+    return digestBytes(output().chainingValue(Root));
+}
+
+Blake3::ChainingValue Blake3::subtree(const uint8_t* data, size_t len, uint64_t firstChunk, unsigned threads,
+                                      Engine engine) {
+    if (threads <= 1 || len <= kMinParallelBytes) {
+        // Subtrees start at a multiple of their own size in chunks, so the
+        // incremental hasher's merge order is the same as from chunk 0.
+        Blake3 hasher(engine, firstChunk);
+        hasher.update(data, len);
+        return hasher.output().chainingValue();
+    }
+    ChainingValue left;
+    ChainingValue right;
+    children(data, len, firstChunk, threads, engine, left, right);
+    return parentCv(left, right);
+}
+
+void Blake3::children(const uint8_t* data, size_t len, uint64_t firstChunk, unsigned threads, Engine engine,
+                      ChainingValue& left, ChainingValue& right) {
+    const size_t leftLen = leftLength(len);
+    // The left subtree is the larger one and keeps the extra thread.
+    thread worker([&] {
+        right = subtree(data + leftLen, len - leftLen, firstChunk + leftLen / kChunkSize, threads / 2, engine);
+    });
+    left = subtree(data, leftLen, firstChunk, threads - threads / 2, engine);
+    worker.join();
+}
+
+array<uint8_t, 32> Blake3::hash(const uint8_t* data, size_t len, unsigned threads, Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("blake3 engine not supported: ") + engineName(engine));
+    }
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    if (threads == 1 || len <= kMinParallelBytes) {
+        Blake3 hasher(engine, 0);
+        hasher.update(data, len);
+        return hasher.finish();
+    }
+    ChainingValue left;
+    ChainingValue right;
+    children(data, len, 0, threads, engine, left, right);
+    return digestBytes(parentCv(left, right, Root));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * BLAKE3 with the default 32-byte output. Input is split into 1 KiB chunks
+ * that hash independently and are joined by a binary tree of parent nodes,
+ * which allows two kinds of parallelism SHA-256 cannot use: the AVX2 engine
+ * compresses eight chunks at once, one per vector lane, and hash() hands
+ * whole subtrees of an in-memory buffer to separate threads.
+ *
+ * The incremental form (update() then finish()) keeps a chunk and a stack of
+ * at most 54 subtree chaining values, so its memory use is fixed.
+ */
+class Blake3 {
+public:
+    enum class Engine {
+        Portable,
+        Avx2,
+    };
+
+    static constexpr std::size_t kChunkSize = 1024;
+
+    /**
+     * hash() does not split subtrees smaller than this across threads.
+     */
+    static constexpr std::size_t kMinParallelBytes = std::size_t(1) << 20;
+
+    Blake3();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * The digest of the bytes fed so far; does not modify the hasher.
+     */
+    std::array<std::uint8_t, 32> finish() const;
+
+    /**
+     * Hashes a whole buffer using up to threads threads (0 means one per
+     * hardware thread); the result equals that of the incremental form.
+     * Throws std::runtime_error if the CPU lacks the engine.
+     */
+    static std::array<std::uint8_t, 32> hash(const std::uint8_t* data, std::size_t len, unsigned threads = 1,
+                                             Engine engine = bestEngine());
+
+    /**
+     * The widest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    Engine engine() const { return engine_; }
+
+    /**
+     * Pins this hasher to a specific engine, e.g. to cross-check engines in
+     * tests and benchmarks. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+    using ChainingValue = std::array<std::uint32_t, 8>;
+
+private:
+    struct Output;
+
+    static constexpr std::size_t kMaxDepth = 54; // 2^54 chunks = 2^64 bytes
+
+    Blake3(Engine engine, std::uint64_t firstChunk);
+
+    void updateChunk(const std::uint8_t* data, std::size_t len);
+    std::size_t chunkLength() const { return blocksCompressed_ * 64 + blockLen_; }
+    void pushChunk(ChainingValue cv);
+    Output chunkOutput() const;
+    Output output() const; // the chunk folded with the stack
+
+    static ChainingValue subtree(const std::uint8_t* data, std::size_t len, std::uint64_t firstChunk,
+                                 unsigned threads, Engine engine);
+    static void children(const std::uint8_t* data, std::size_t len, std::uint64_t firstChunk, unsigned threads,
+                         Engine engine, ChainingValue& left, ChainingValue& right);
+
+    Engine engine_;
+    // The chunk being filled.
+    ChainingValue cv_;
+    std::uint64_t chunkCounter_ = 0;
+    std::uint8_t block_[64] = {};
+    std::size_t blockLen_ = 0;
+    std::size_t blocksCompressed_ = 0;
+    // Chaining values of completed subtrees, largest first.
+    std::array<ChainingValue, kMaxDepth> stack_;
+    std::size_t stackLen_ = 0;
+};
@@ -0,0 +1,94 @@
+#include "byte_histogram.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kLanes = 4;
+
+// A lane receives about a quarter of the bytes between folds, well within uint32_t.
+constexpr uint64_t kFoldInterval = uint64_t(1) << 31;
+
+} // namespace (internal)
+
+void ByteHistogram::update(const uint8_t* data, size_t len) {
+    total_ += len;
+    while (len > 0) {
+        if (inLanes_ >= kFoldInterval) {
+            fold();
+        }
+        const size_t block = static_cast<size_t>(min<uint64_t>(len, kFoldInterval - inLanes_));
+        uint32_t* l0 = lanes_.data();
+        uint32_t* l1 = l0 + 256;
+        uint32_t* l2 = l1 + 256;
+        uint32_t* l3 = l2 + 256;
+        size_t i = 0;
+        for (; i + 8 <= block; i += 8) {
+            uint64_t v;
+            memcpy(&v, data + i, sizeof(v));
+            ++l0[v & 0xFF];
+            ++l1[(v >> 8) & 0xFF];
+            ++l2[(v >> 16) & 0xFF];
+            ++l3[(v >> 24) & 0xFF];
+            ++l0[(v >> 32) & 0xFF];
+            ++l1[(v >> 40) & 0xFF];
+            ++l2[(v >> 48) & 0xFF];
+            ++l3[v >> 56];
+        }
+        for (; i < block; ++i) {
+            ++l0[data[i]];
+        }
+        inLanes_ += block;
+        data += block;
+        len -= block;
+    }
+}
+
+void ByteHistogram::fold() {
+    for (size_t b = 0; b < 256; ++b) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            counts_[b] += lanes_[256 * lane + b];
+        }
+    }
+    lanes_.fill(0);
+    inLanes_ = 0;
+}
+
+array<uint64_t, 256> ByteHistogram::counts() const {
+    array<uint64_t, 256> out = counts_;
+    for (size_t b = 0; b < 256; ++b) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            out[b] += lanes_[256 * lane + b];
+        }
+    }
+    return out;
+}
+
+double ByteHistogram::entropy() const {
+    return entropy(counts());
+}
+
+double ByteHistogram::entropy(const array<uint64_t, 256>& counts) {
+    uint64_t total = 0;
+    for (uint64_t c : counts) {
+        total += c;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    // H = log2(N) - sum(c * log2(c)) / N
+    double weighted = 0;
+    for (uint64_t c : counts) {
+        if (c != 0) {
+            weighted += static_cast<double>(c) * log2(static_cast<double>(c));
+        }
+    }
+    const double n = static_cast<double>(total);
+    return max(0.0, log2(n) - weighted / n);
+}
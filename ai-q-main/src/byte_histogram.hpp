@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Shannon entropy of an upload in bits per byte (0 for a single repeated
+ * byte, 8 for uniformly random bytes), over the whole upload and over its
+ * first and last windows. Encrypted or packed payloads sit near 8 throughout;
+ * documents mostly lower, though embedded compressed streams raise them.
+ */
+struct ByteEntropy {
+    bool computed = false; // set when IngestConfig::entropy is
+    double overall = 0;
+    double head = 0; // first IngestConfig::entropyWindow bytes
+    double tail = 0; // last IngestConfig::entropyWindow bytes
+};
+
+/**
+ * Byte-frequency histogram. Counting one byte at a time stalls on the
+ * store-to-load dependency whenever neighbouring bytes are equal (runs are
+ * common in real files), so the kernel reads eight bytes per load and spreads
+ * them over four interleaved sub-histograms, summed on demand.
+ */
+class ByteHistogram {
+public:
+    void update(const std::uint8_t* data, std::size_t len);
+
+    std::array<std::uint64_t, 256> counts() const;
+
+    std::uint64_t total() const { return total_; }
+
+    /**
+     * Shannon entropy of the bytes counted so far, in bits per byte; 0 when empty.
+     */
+    double entropy() const;
+
+    static double entropy(const std::array<std::uint64_t, 256>& counts);
+
+private:
+    void fold();
+
+    std::array<std::uint64_t, 256> counts_{};
+    std::array<std::uint32_t, 4 * 256> lanes_{};
+    std::uint64_t inLanes_ = 0; // bytes in lanes_, folded into counts_ before a lane can overflow
+    std::uint64_t total_ = 0;
+};
@@ -0,0 +1,178 @@
+#include "chunk_manifest.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'H', 'M', 'F'};
+constexpr uint8_t kVersion = 1;
+constexpr size_t kHeaderSize = sizeof(kMagic) + 1 + 8 + 8;
+
+Sha256Digest sha256Of(const uint8_t* data, size_t len) {
+    Sha256 hasher;
+    hasher.update(data, len);
+    return hasher.finish();
+}
+
+Sha256Digest leafHash(const Sha256Digest& chunk) {
+    const uint8_t prefix = 0x00;
+    Sha256 hasher;
+    hasher.update(&prefix, 1);
+    hasher.update(chunk.bytes.data(), chunk.bytes.size());
+    return hasher.finish();
+}
+
+Sha256Digest nodeHash(const Sha256Digest& left, const Sha256Digest& right) {
+    const uint8_t prefix = 0x01;
+    Sha256 hasher;
+    hasher.update(&prefix, 1);
+    hasher.update(left.bytes.data(), left.bytes.size());
+    hasher.update(right.bytes.data(), right.bytes.size());
+    return hasher.finish();
+}
+
+Sha256Digest subtreeRoot(const Sha256Digest* leaves, size_t count) {
+    if (count == 1) {
+        return leafHash(leaves[0]);
+    }
+    size_t split = 1;
+    while (split * 2 < count) {
+        split *= 2;
+    }
+    return nodeHash(subtreeRoot(leaves, split), subtreeRoot(leaves + split, count - split));
+}
+
+void putLe64(uint8_t* p, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getLe64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * Internal: digests of chunks [first, last) of the buffer.
+ */
+void hashChunks(const uint8_t* data, size_t len, uint64_t chunkSize, size_t first, size_t last,
+                Sha256Digest* out) {
+    for (size_t i = first; i < last; ++i) {
+        const uint64_t offset = i * chunkSize;
+        out[i] = sha256Of(data + offset, static_cast<size_t>(min<uint64_t>(chunkSize, len - offset)));
+    }
+}
+
+} // namespace (internal)
+
+Sha256Digest merkleRoot(const Sha256Digest* leaves, size_t count) {
+    return count == 0 ? sha256Of(nullptr, 0) : subtreeRoot(leaves, count);
+}
+
+uint64_t ChunkManifest::chunkCount() const {
+    return chunkSize == 0 ? 0 : totalSize / chunkSize + (totalSize % chunkSize != 0 ? 1 : 0);
+}
+
+void ChunkManifest::chunksCovering(uint64_t offset, uint64_t len, uint64_t& first, uint64_t& last) const {
+    if (chunkSize == 0 || len == 0 || offset >= totalSize || len > totalSize - offset) {
+        throw runtime_error("byte range outside manifest");
+    }
+    first = offset / chunkSize;
+    last = (offset + len - 1) / chunkSize;
+}
+
+bool ChunkManifest::verifyChunk(uint64_t index, const uint8_t* data, size_t len) const {
+    if (index >= chunks.size()) {
+        return false;
+    }
+    const uint64_t expectedLen = min(chunkSize, totalSize - index * chunkSize);
+    return len == expectedLen && sha256Of(data, len) == chunks[index];
+}
+
+bool ChunkManifest::verifyRoot() const {
+    return chunks.size() == chunkCount() && merkleRoot(chunks.data(), chunks.size()) == root;
+}
+
+vector<uint8_t> ChunkManifest::encode() const {
+    vector<uint8_t> out(kHeaderSize + 32 * (chunks.size() + 1));
+    memcpy(out.data(), kMagic, sizeof(kMagic));
+    out[sizeof(kMagic)] = kVersion;
+    putLe64(out.data() + sizeof(kMagic) + 1, chunkSize);
+    putLe64(out.data() + sizeof(kMagic) + 9, totalSize);
+    memcpy(out.data() + kHeaderSize, root.bytes.data(), 32);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        memcpy(out.data() + kHeaderSize + 32 * (i + 1), chunks[i].bytes.data(), 32);
+    }
+    return out;
+}
+
+ChunkManifest ChunkManifest::decode(const uint8_t* data, size_t len) {
+    if (len < kHeaderSize + 32 || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        throw runtime_error("not a chunk manifest");
+    }
+    if (data[sizeof(kMagic)] != kVersion) {
+        throw runtime_error("unsupported chunk manifest version");
+    }
+    ChunkManifest manifest;
+    manifest.chunkSize = getLe64(data + sizeof(kMagic) + 1);
+    manifest.totalSize = getLe64(data + sizeof(kMagic) + 9);
+    if (manifest.chunkSize == 0) {
+        throw runtime_error("chunk manifest has zero chunk size");
+    }
+    const uint64_t count = manifest.chunkCount();
+    if ((len - kHeaderSize - 32) / 32 != count || (len - kHeaderSize) % 32 != 0) {
+        throw runtime_error("chunk manifest length does not match its sizes");
+    }
+    memcpy(manifest.root.bytes.data(), data + kHeaderSize, 32);
+    manifest.chunks.resize(static_cast<size_t>(count));
+    for (size_t i = 0; i < manifest.chunks.size(); ++i) {
+        memcpy(manifest.chunks[i].bytes.data(), data + kHeaderSize + 32 * (i + 1), 32);
+    }
+    if (!manifest.verifyRoot()) {
+        throw runtime_error("chunk manifest root does not match its chunks");
+    }
+    return manifest;
+}
+
+ChunkManifest buildChunkManifest(const uint8_t* data, size_t len, uint64_t chunkSize, unsigned threads) {
+    if (chunkSize == 0) {
+        throw runtime_error("chunk manifest needs a non-zero chunk size");
+    }
+    ChunkManifest manifest;
+    manifest.chunkSize = chunkSize;
+    manifest.totalSize = len;
+    manifest.chunks.resize(static_cast<size_t>(manifest.chunkCount()));
+    const size_t count = manifest.chunks.size();
+
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    if (len <= kMinParallelManifestBytes) {
+        threads = 1;
+    }
+    threads = static_cast<unsigned>(min<size_t>(threads, count));
+    // Each thread takes a contiguous run of chunks; this one takes the first.
+    vector<thread> workers;
+    const size_t perThread = threads > 0 ? (count + threads - 1) / threads : 0;
+    for (size_t first = perThread; first < count; first += perThread) {
+        const size_t last = min(count, first + perThread);
+        workers.emplace_back(hashChunks, data, len, chunkSize, first, last, manifest.chunks.data());
+    }
+    hashChunks(data, len, chunkSize, 0, min(count, perThread), manifest.chunks.data());
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    manifest.root = merkleRoot(manifest.chunks.data(), count);
+    return manifest;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "sha256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Per-chunk SHA-256 digests of an upload split into fixed-size chunks (the
+ * last may be shorter), plus a Merkle root over them. A byte range can be
+ * checked by hashing only the chunks it touches, and chunks can be hashed
+ * independently, on different threads or machines.
+ *
+ * The root follows RFC 6962 (2.1), with chunk digests as the leaf data:
+ * leaf = SHA-256(0x00 || chunk digest), node = SHA-256(0x01 || left || right),
+ * the left subtree holding the largest power of two of leaves smaller than the
+ * total. With no chunks the root is SHA-256 of the empty string.
+ */
+struct ChunkManifest {
+    std::uint64_t chunkSize = 0; // 0 when no manifest was built
+    std::uint64_t totalSize = 0;
+    std::vector<Sha256Digest> chunks;
+    Sha256Digest root;
+
+    bool empty() const { return chunkSize == 0; }
+
+    /**
+     * The number of chunks a file of totalSize bytes splits into.
+     */
+    std::uint64_t chunkCount() const;
+
+    /**
+     * Chunk indexes [first, last] holding bytes [offset, offset + len);
+     * len must be at least 1 and the range must lie within the file.
+     */
+    void chunksCovering(std::uint64_t offset, std::uint64_t len, std::uint64_t& first, std::uint64_t& last) const;
+
+    /**
+     * True when data is exactly chunk index's bytes.
+     */
+    bool verifyChunk(std::uint64_t index, const std::uint8_t* data, std::size_t len) const;
+
+    /**
+     * Recomputes the root from the chunk digests; false when they disagree.
+     */
+    bool verifyRoot() const;
+
+    /**
+     * Compact binary form: "SHMF", a version byte (1), chunk size and total
+     * size as little-endian uint64, the root, then the chunk digests in order.
+     */
+    std::vector<std::uint8_t> encode() const;
+
+    /**
+     * Parses encode()'s output. Throws std::runtime_error if it is malformed
+     * or the root does not match the chunk digests.
+     */
+    static ChunkManifest decode(const std::uint8_t* data, std::size_t len);
+};
+
+/**
+ * RFC 6962 Merkle tree hash over a list of chunk digests.
+ */
+Sha256Digest merkleRoot(const Sha256Digest* leaves, std::size_t count);
+
+constexpr std::size_t kMinParallelManifestBytes = std::size_t(1) << 20;
+
+/**
+ * Builds the manifest of an in-memory buffer. Buffers over
+ * kMinParallelManifestBytes are split into runs of whole chunks hashed on up
+ * to threads threads (0 means one per hardware thread). Throws
+ * std::runtime_error if chunkSize is 0.
+ */
+ChunkManifest buildChunkManifest(const std::uint8_t* data, std::size_t len, std::uint64_t chunkSize,
+                                 unsigned threads = 1);
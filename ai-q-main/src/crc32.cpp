@@ -0,0 +1,266 @@
+#include "crc32.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_CRC32_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_CRC32_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t kCrc32Polynomial = 0xEDB88320u;
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78u;
+
+using SliceTables = array<array<uint32_t, 256>, 8>;
+
+/**
+ * Internal: slice-by-8 tables for a reflected polynomial. Table k maps a byte
+ * to its CRC contribution when followed by k zero bytes, so eight input bytes
+ * fold in one step.
+ */
+constexpr SliceTables makeSliceTables(uint32_t polynomial) {
+    SliceTables tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1u)));
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            const uint32_t previous = tables[k - 1][i];
+            tables[k][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr SliceTables kSliceTables = makeSliceTables(kCrc32Polynomial);
+constexpr SliceTables kCastagnoliSliceTables = makeSliceTables(kCrc32cPolynomial);
+
+/**
+ * Internal: advances the raw (pre-inverted) CRC register over a buffer.
+ */
+uint32_t crcSliceBy8(const SliceTables& t, uint32_t crc, const uint8_t* data, size_t len) {
+    while (len >= 8) {
+        const uint32_t lo = crc ^ (static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                                   (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24));
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+    while (len-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#if INGEST_CRC32_X86
+
+/**
+ * Internal: folds a 128-bit lane forward by 128 bits onto the next one.
+ */
+__attribute__((target("pclmul,sse4.1"))) inline __m128i foldLane(__m128i acc, __m128i next, __m128i k) {
+    const __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+    const __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+}
+
+/**
+ * Internal: CRC folding with carry-less multiplication (Gopal et al., "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction").
+ * Four 128-bit lanes fold 64 bytes per step, then collapse to one lane, fold
+ * the remaining 16-byte blocks, and Barrett-reduce to 32 bits. Requires
+ * len >= 64 and len a multiple of 16; works on the raw register.
+ */
+__attribute__((target("pclmul,sse4.1"))) uint32_t crc32Pclmul(uint32_t crc, const uint8_t* data, size_t len) {
+    // Bit-reflected folding constants x^(k) mod P for the CRC-32 polynomial.
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    data += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+        data += 64;
+        len -= 64;
+    }
+
+    x1 = foldLane(x1, x2, k3k4);
+    x1 = foldLane(x1, x3, k3k4);
+    x1 = foldLane(x1, x4, k3k4);
+    while (len >= 16) {
+        x1 = foldLane(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), k3k4);
+        data += 16;
+        len -= 16;
+    }
+
+    // 128 -> 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, low32);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+    // Barrett reduction to 32 bits.
+    x2 = _mm_and_si128(x1, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+/**
+ * Internal: CRC-32C with the SSE4.2 instruction, which implements exactly
+ * this polynomial; works on the raw register.
+ */
+__attribute__((target("sse4.2"))) uint32_t crc32cSse42(uint32_t crc, const uint8_t* data, size_t len) {
+#if defined(__x86_64__)
+    uint64_t wide = crc;
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<uint32_t>(wide);
+#endif
+    for (; len >= 4; data += 4, len -= 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; len > 0; ++data, --len) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+#endif
+
+Crc32::Engine detectBestEngine() {
+#if INGEST_CRC32_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+        return Crc32::Engine::Pclmul;
+    }
+#endif
+    return Crc32::Engine::SliceBy8;
+}
+
+Crc32c::Engine detectBestCastagnoliEngine() {
+#if INGEST_CRC32_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Crc32c::Engine::Sse42;
+    }
+#endif
+    return Crc32c::Engine::SliceBy8;
+}
+
+} // namespace (internal)
+
+Crc32::Engine Crc32::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool Crc32::engineSupported(Engine engine) {
+    return engine == Engine::SliceBy8 || bestEngine() == Engine::Pclmul;
+}
+
+const char* Crc32::engineName(Engine engine) {
+    return engine == Engine::Pclmul ? "pclmul" : "slice-by-8";
+}
+
+void Crc32::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("crc32 engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+void Crc32::update(const uint8_t* data, size_t len) {
+#if INGEST_CRC32_X86
+    if (engine_ == Engine::Pclmul && len >= 64) {
+        const size_t folded = len & ~static_cast<size_t>(15);
+        state_ = crc32Pclmul(state_, data, folded);
+        data += folded;
+        len -= folded;
+    }
+#endif
+    state_ = crcSliceBy8(kSliceTables, state_, data, len);
+}
+
+uint32_t crc32(const uint8_t* data, size_t len) {
+    Crc32 crc;
+    crc.update(data, len);
+    return crc.value();
+}
+
+Crc32c::Engine Crc32c::bestEngine() {
+    static const Engine best = detectBestCastagnoliEngine();
+    return best;
+}
+
+bool Crc32c::engineSupported(Engine engine) {
+    return engine == Engine::SliceBy8 || bestEngine() == Engine::Sse42;
+}
+
+const char* Crc32c::engineName(Engine engine) {
+    return engine == Engine::Sse42 ? "sse4.2" : "slice-by-8";
+}
+
+void Crc32c::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("crc32c engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+void Crc32c::update(const uint8_t* data, size_t len) {
+#if INGEST_CRC32_X86
+    if (engine_ == Engine::Sse42) {
+        state_ = crc32cSse42(state_, data, len);
+        return;
+    }
+#endif
+    state_ = crcSliceBy8(kCastagnoliSliceTables, state_, data, len);
+}
+
+uint32_t crc32c(const uint8_t* data, size_t len) {
+    Crc32c crc;
+    crc.update(data, len);
+    return crc.value();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Incremental CRC-32 (the ZIP/zlib/PNG polynomial, reflected 0xEDB88320).
+ * Long inputs are folded 64 bytes at a time with carry-less multiplication
+ * (PCLMULQDQ) when the CPU has it; the rest goes through slice-by-8 tables.
+ */
+class Crc32 {
+public:
+    enum class Engine {
+        SliceBy8,
+        Pclmul,
+    };
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    std::uint32_t value() const { return ~state_; }
+
+    void reset() { state_ = 0xFFFFFFFFu; }
+
+    /**
+     * The fastest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    /**
+     * Pins this instance to a specific engine, e.g. to cross-check engines in
+     * tests and benchmarks. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+private:
+    std::uint32_t state_ = 0xFFFFFFFFu;
+    Engine engine_ = bestEngine();
+};
+
+/**
+ * CRC-32 of a buffer in one call.
+ */
+std::uint32_t crc32(const std::uint8_t* data, std::size_t len);
+
+/**
+ * Incremental CRC-32C (Castagnoli, reflected 0x82F63B78), the checksum of
+ * iSCSI, ext4 and S3-compatible object stores. Uses the SSE4.2 CRC32
+ * instruction, eight bytes per step, when the CPU has it; slice-by-8 tables
+ * otherwise.
+ */
+class Crc32c {
+public:
+    enum class Engine {
+        SliceBy8,
+        Sse42,
+    };
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    std::uint32_t value() const { return ~state_; }
+
+    void reset() { state_ = 0xFFFFFFFFu; }
+
+    /**
+     * The fastest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    /**
+     * Pins this instance to a specific engine. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+private:
+    std::uint32_t state_ = 0xFFFFFFFFu;
+    Engine engine_ = bestEngine();
+};
+
+/**
+ * CRC-32C of a buffer in one call.
+ */
+std::uint32_t crc32c(const std::uint8_t* data, std::size_t len);
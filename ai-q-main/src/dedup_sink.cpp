@@ -0,0 +1,301 @@
+#include "dedup_sink.hpp"
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kCopyBufferSize = 64 * 1024;
+
+bool isSha256Hex(string_view hex) {
+    if (hex.size() != 64) {
+        return false;
+    }
+    for (char c : hex) {
+        if (!isdigit(static_cast<unsigned char>(c)) && (c < 'a' || c > 'f')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void createDirectories(const fs::path& dir) {
+    error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        throw runtime_error("cannot create directory " + dir.string() + ": " + ec.message());
+    }
+}
+
+/**
+ * Internal: dir/ab/cd/abcd...ef for a digest, validated first so the name
+ * cannot escape dir.
+ */
+fs::path shardedPath(const fs::path& dir, string_view sha256Hex) {
+    if (!isSha256Hex(sha256Hex)) {
+        throw runtime_error("not a lowercase hex sha256: " + string(sha256Hex));
+    }
+    return dir / string(sha256Hex.substr(0, 2)) / string(sha256Hex.substr(2, 2)) / string(sha256Hex);
+}
+
+/**
+ * Internal: true when path is a stored object of the given size. Any other
+ * size means it was damaged or cut short, and it is rewritten.
+ */
+bool storedWithSize(const fs::path& path, uint64_t size) {
+    error_code ec;
+    const uintmax_t existing = fs::file_size(path, ec);
+    return !ec && existing == size;
+}
+
+string makeTempTag() {
+    random_device seed;
+    return to_string(seed()) + "-" + to_string(seed());
+}
+
+/**
+ * Internal: writes an object to temp via write(ofstream&), then renames it to
+ * target, so target is never seen partially written. temp is removed on failure.
+ */
+template <typename WriteFn>
+void writeObject(const fs::path& temp, const fs::path& target, WriteFn&& write) {
+    error_code ec;
+    try {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out) {
+            throw runtime_error("cannot create " + temp.string());
+        }
+        write(out);
+        out.close();
+        if (!out) {
+            throw runtime_error("write failed: " + temp.string());
+        }
+        createDirectories(target.parent_path());
+        fs::rename(temp, target, ec);
+        if (ec) {
+            throw runtime_error("cannot store " + target.string() + ": " + ec.message());
+        }
+    } catch (...) {
+        fs::remove(temp, ec);
+        throw;
+    }
+}
+
+/**
+ * Internal: fills len bytes from the source; throws if it ends first.
+ */
+void readExactly(ByteSource& data, uint8_t* out, size_t len) {
+    while (len > 0) {
+        const size_t n = data.read(out, len);
+        if (n == 0) {
+            throw runtime_error("upload stream does not match its result size");
+        }
+        out += n;
+        len -= n;
+    }
+}
+
+/**
+ * Internal: a reference value on one line, with '%', control bytes and DEL as %XX.
+ */
+string escapeReferenceValue(string_view value) {
+    static const char kDigits[] = "0123456789ABCDEF";
+    string out;
+    for (char ch : value) {
+        const auto byte = static_cast<unsigned char>(ch);
+        if (byte < 0x20 || byte == 0x7F || byte == '%') {
+            out += '%';
+            out += kDigits[byte >> 4];
+            out += kDigits[byte & 0xF];
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+vector<uint8_t> readFile(const fs::path& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("cannot open " + path.string());
+    }
+    return vector<uint8_t>(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+} // namespace (internal)
+
+ContentAddressedSink::ContentAddressedSink(string root) : root_(move(root)), tempTag_(makeTempTag()) {
+    for (const char* dir : {"tmp", "refs"}) {
+        createDirectories(fs::path(root_) / dir);
+    }
+}
+
+string ContentAddressedSink::objectPath(string_view sha256Hex) const {
+    return shardedPath(root_, sha256Hex).string();
+}
+
+bool ContentAddressedSink::contains(string_view sha256Hex) const {
+    error_code ec;
+    return fs::is_regular_file(objectPath(sha256Hex), ec);
+}
+
+string ContentAddressedSink::referenceDirectory() const {
+    return (fs::path(root_) / "refs").string();
+}
+
+void ContentAddressedSink::persist(const UploadMeta& meta, const IngestResult& result, ByteSource& data) {
+    store(result.sha256, result.size, data);
+    writeReference(meta, result.sha256, result.size);
+}
+
+void ContentAddressedSink::persist(const UploadMeta& meta, const CompactIngestResult& result, ByteSource& data) {
+    const string sha256Hex = result.sha256.hex();
+    store(sha256Hex, result.size, data);
+    writeReference(meta, sha256Hex, result.size);
+}
+
+string ContentAddressedSink::tempName(string_view name) {
+    return string(name) + "." + tempTag_ + "." + to_string(tempCounter_.fetch_add(1, memory_order_relaxed));
+}
+
+void ContentAddressedSink::writeReference(const UploadMeta& meta, string_view sha256Hex, int64_t size) {
+    ostringstream text;
+    text << "sha256 " << sha256Hex << '\n'
+         << "size " << size << '\n'
+         << "filename " << escapeReferenceValue(meta.filename) << '\n'
+         << "claimedMime " << escapeReferenceValue(meta.claimedMime) << '\n'
+         << "contentLength ";
+    if (meta.hasContentLength) {
+        text << meta.contentLength;
+    }
+    text << '\n';
+    const string body = text.str();
+    // Named uniquely rather than after the client's filename, which may repeat or be hostile.
+    const string name = tempName("ref");
+    writeObject(fs::path(root_) / "tmp" / name, fs::path(root_) / "refs" / name,
+                [&](ofstream& out) { out.write(body.data(), static_cast<streamsize>(body.size())); });
+    referencesWritten_.fetch_add(1, memory_order_relaxed);
+}
+
+void ContentAddressedSink::store(string_view sha256Hex, int64_t size, ByteSource& data) {
+    const fs::path target = objectPath(sha256Hex);
+    if (storedWithSize(target, static_cast<uint64_t>(size))) {
+        duplicatesSkipped_.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    writeObject(fs::path(root_) / "tmp" / tempName(sha256Hex), target, [&](ofstream& out) {
+        array<uint8_t, kCopyBufferSize> buffer;
+        int64_t written = 0;
+        while (size_t n = data.read(buffer.data(), buffer.size())) {
+            out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<streamsize>(n));
+            written += static_cast<int64_t>(n);
+        }
+        if (written != size) {
+            throw runtime_error("upload stream does not match its result size");
+        }
+    });
+    objectsWritten_.fetch_add(1, memory_order_relaxed);
+}
+
+ChunkStoreSink::ChunkStoreSink(string root) : root_(move(root)), tempTag_(makeTempTag()) {
+    for (const char* dir : {"tmp", "chunks", "files"}) {
+        createDirectories(fs::path(root_) / dir);
+    }
+}
+
+string ChunkStoreSink::chunkPath(string_view sha256Hex) const {
+    return shardedPath(fs::path(root_) / "chunks", sha256Hex).string();
+}
+
+string ChunkStoreSink::recipePath(string_view sha256Hex) const {
+    return shardedPath(fs::path(root_) / "files", sha256Hex).string();
+}
+
+void ChunkStoreSink::persist(const UploadMeta&, const IngestResult& result, ByteSource& data) {
+    store(result.sha256, result.size, result.cdcChunks, data);
+}
+
+void ChunkStoreSink::persist(const UploadMeta&, const CompactIngestResult& result, ByteSource& data) {
+    store(result.sha256.hex(), result.size, result.cdcChunks, data);
+}
+
+void ChunkStoreSink::store(string_view sha256Hex, int64_t size, const vector<CdcChunk>& chunks, ByteSource& data) {
+    const fs::path recipe = recipePath(sha256Hex);
+    error_code ec;
+    if (fs::is_regular_file(recipe, ec)) {
+        chunksSkipped_.fetch_add(chunks.size(), memory_order_relaxed);
+        bytesSkipped_.fetch_add(static_cast<uint64_t>(size), memory_order_relaxed);
+        return;
+    }
+    if (size > 0 && chunks.empty()) {
+        throw runtime_error("chunk store needs IngestConfig::cdcAverageChunkSize");
+    }
+
+    auto tempPath = [&](string_view name) {
+        return fs::path(root_) / "tmp" /
+               (string(name) + "." + tempTag_ + "." + to_string(tempCounter_.fetch_add(1, memory_order_relaxed)));
+    };
+    // The stream is read through even for stored chunks, to reach the ones after them.
+    vector<uint8_t> buffer;
+    ostringstream lines;
+    for (const CdcChunk& chunk : chunks) {
+        buffer.resize(chunk.length);
+        readExactly(data, buffer.data(), buffer.size());
+        const string hex = chunk.digest.hex();
+        const fs::path target = chunkPath(hex);
+        if (storedWithSize(target, chunk.length)) {
+            chunksSkipped_.fetch_add(1, memory_order_relaxed);
+            bytesSkipped_.fetch_add(chunk.length, memory_order_relaxed);
+        } else {
+            writeObject(tempPath(hex), target, [&](ofstream& out) {
+                out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<streamsize>(buffer.size()));
+            });
+            chunksWritten_.fetch_add(1, memory_order_relaxed);
+            bytesWritten_.fetch_add(chunk.length, memory_order_relaxed);
+        }
+        lines << hex << ' ' << chunk.length << '\n';
+    }
+    uint8_t extra;
+    if (data.read(&extra, 1) != 0) {
+        throw runtime_error("upload stream does not match its result size");
+    }
+    const string text = lines.str();
+    writeObject(tempPath(sha256Hex), recipe, [&](ofstream& out) { out.write(text.data(), text.size()); });
+}
+
+vector<uint8_t> ChunkStoreSink::restore(string_view sha256Hex) const {
+    ifstream recipe(recipePath(sha256Hex));
+    if (!recipe) {
+        throw runtime_error("no stored file " + string(sha256Hex));
+    }
+    vector<uint8_t> out;
+    string hex;
+    uint64_t length;
+    while (recipe >> hex >> length) {
+        const vector<uint8_t> chunk = readFile(chunkPath(hex));
+        Sha256 hasher;
+        hasher.update(chunk.data(), chunk.size());
+        if (chunk.size() != length || hasher.finish().hex() != hex) {
+            throw runtime_error("stored chunk is damaged: " + hex);
+        }
+        out.insert(out.end(), chunk.begin(), chunk.end());
+    }
+    if (!recipe.eof()) {
+        throw runtime_error("malformed recipe for " + string(sha256Hex));
+    }
+    return out;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "byte_source.hpp"
+#include "ingest.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Local filesystem sink storing each upload once, under its SHA-256:
+ * root/ab/cd/abcd...ef for digest "abcd...ef". The digest is part of the
+ * result persist() receives, so a resubmitted file is recognized before any
+ * byte is written; its stream is left unread. Every upload, duplicate or not,
+ * also gets a reference in root/refs: a small text file naming the upload
+ * (see writeReference) and the digest of its object. Objects and references
+ * are written to root/tmp and renamed into place, so no path ever holds a
+ * partial file, and concurrent persists of the same bytes are harmless.
+ *
+ * Rejected uploads are stored like any other; wrap the sink if that is not
+ * wanted. Both sink interfaces are implemented.
+ */
+class ContentAddressedSink final : public IngestSink, public CompactIngestSink {
+public:
+    /**
+     * Creates root, root/tmp and root/refs if missing. Throws
+     * std::runtime_error when they cannot be created.
+     */
+    explicit ContentAddressedSink(std::string root);
+
+    void persist(const UploadMeta& meta, const IngestResult& result, ByteSource& data) override;
+    void persist(const UploadMeta& meta, const CompactIngestResult& result, ByteSource& data) override;
+
+    /**
+     * Where the object with this lowercase hex SHA-256 is (or would be) stored.
+     */
+    std::string objectPath(std::string_view sha256Hex) const;
+
+    bool contains(std::string_view sha256Hex) const;
+
+    /**
+     * The directory holding one reference file per persisted upload.
+     */
+    std::string referenceDirectory() const;
+
+    /**
+     * Uploads written as new objects, and those found already stored.
+     */
+    std::uint64_t objectsWritten() const { return objectsWritten_.load(std::memory_order_relaxed); }
+    std::uint64_t duplicatesSkipped() const { return duplicatesSkipped_.load(std::memory_order_relaxed); }
+    std::uint64_t referencesWritten() const { return referencesWritten_.load(std::memory_order_relaxed); }
+
+private:
+    void store(std::string_view sha256Hex, std::int64_t size, ByteSource& data);
+    /**
+     * Writes the reference for one upload, after its object is in place:
+     * "sha256", "size", "filename", "claimedMime" and "contentLength" lines
+     * (the last empty when absent), with '%', control bytes and DEL
+     * percent-encoded in the values.
+     */
+    void writeReference(const UploadMeta& meta, std::string_view sha256Hex, std::int64_t size);
+    std::string tempName(std::string_view name);
+
+    std::string root_;
+    std::string tempTag_; // distinguishes this sink's temp files from other processes'
+    std::atomic<std::uint64_t> objectsWritten_{0};
+    std::atomic<std::uint64_t> duplicatesSkipped_{0};
+    std::atomic<std::uint64_t> referencesWritten_{0};
+    std::atomic<std::uint64_t> tempCounter_{0};
+};
+
+/**
+ * Filesystem sink deduplicating below file level: each FastCDC chunk (see
+ * IngestConfig::cdcAverageChunkSize) is stored once, under
+ * root/chunks/ab/cd/<chunk sha256>, so revisions of a document share the
+ * chunks their edits did not touch. The upload itself becomes a recipe at
+ * root/files/ab/cd/<file sha256>: one "<chunk sha256> <length>" line per
+ * chunk, in order. Chunks and recipes are written through root/tmp as in
+ * ContentAddressedSink; a file whose recipe exists is skipped unread.
+ */
+class ChunkStoreSink final : public IngestSink, public CompactIngestSink {
+public:
+    /**
+     * Creates root and its subdirectories if missing. Throws std::runtime_error
+     * when they cannot be created.
+     */
+    explicit ChunkStoreSink(std::string root);
+
+    /**
+     * Throws std::runtime_error for a non-empty upload without CDC chunks, or
+     * when the stream does not match them.
+     */
+    void persist(const UploadMeta& meta, const IngestResult& result, ByteSource& data) override;
+    void persist(const UploadMeta& meta, const CompactIngestResult& result, ByteSource& data) override;
+
+    std::string chunkPath(std::string_view sha256Hex) const;
+    std::string recipePath(std::string_view sha256Hex) const;
+
+    /**
+     * Reassembles a stored file from its recipe. Throws std::runtime_error if
+     * the recipe or one of its chunks is missing or malformed.
+     */
+    std::vector<std::uint8_t> restore(std::string_view sha256Hex) const;
+
+    /**
+     * Chunks (and their bytes) written, and those already stored.
+     */
+    std::uint64_t chunksWritten() const { return chunksWritten_.load(std::memory_order_relaxed); }
+    std::uint64_t chunksSkipped() const { return chunksSkipped_.load(std::memory_order_relaxed); }
+    std::uint64_t bytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+    std::uint64_t bytesSkipped() const { return bytesSkipped_.load(std::memory_order_relaxed); }
+
+private:
+    void store(std::string_view sha256Hex, std::int64_t size, const std::vector<CdcChunk>& chunks,
+               ByteSource& data);
+
+    std::string root_;
+    std::string tempTag_;
+    std::atomic<std::uint64_t> chunksWritten_{0};
+    std::atomic<std::uint64_t> chunksSkipped_{0};
+    std::atomic<std::uint64_t> bytesWritten_{0};
+    std::atomic<std::uint64_t> bytesSkipped_{0};
+    std::atomic<std::uint64_t> tempCounter_{0};
+};
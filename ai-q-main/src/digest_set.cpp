@@ -0,0 +1,97 @@
+#include "digest_set.hpp"
+
+#include "hex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+constexpr array<const char*, static_cast<size_t>(DigestAlgorithm::Count)> kAlgorithmNames = {
+    "md5", "sha1", "sha512", "crc32", "crc32c", "blake3"};
+
+template <size_t N>
+void store(DigestValue& value, const array<uint8_t, N>& bytes) {
+    static_assert(N <= sizeof(value.bytes), "digest too large");
+    value.assign(bytes.data(), N);
+}
+
+void storeCrc(DigestValue& value, uint32_t crc) {
+    store(value, array<uint8_t, 4>{static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                                   static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)});
+}
+
+} // namespace (internal)
+
+const char* digestAlgorithmName(DigestAlgorithm algorithm) {
+    size_t index = static_cast<size_t>(algorithm);
+    return index < kAlgorithmNames.size() ? kAlgorithmNames[index] : "unknown";
+}
+
+bool digestNameMatches(string_view name, string_view canonical) {
+    size_t j = 0;
+    for (char c : name) {
+        if (c == '-') {
+            continue;
+        }
+        if (j == canonical.size() || tolower(static_cast<unsigned char>(c)) != canonical[j]) {
+            return false;
+        }
+        ++j;
+    }
+    return j == canonical.size();
+}
+
+bool lookupDigestAlgorithm(string_view name, DigestAlgorithm& out) {
+    for (size_t i = 0; i < kAlgorithmNames.size(); ++i) {
+        if (digestNameMatches(name, kAlgorithmNames[i])) {
+            out = static_cast<DigestAlgorithm>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void DigestValue::assign(const uint8_t* data, size_t len) {
+    size = static_cast<uint8_t>(min(len, bytes.size()));
+    memcpy(bytes.data(), data, size);
+}
+
+string DigestValue::hex() const {
+    return hexString(bytes.data(), size);
+}
+
+void MultiDigest::update(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        const size_t slice = min(len, kSliceSize);
+        if (selection_.has(DigestAlgorithm::Md5)) md5_.update(data, slice);
+        if (selection_.has(DigestAlgorithm::Sha1)) sha1_.update(data, slice);
+        if (selection_.has(DigestAlgorithm::Sha512)) sha512_.update(data, slice);
+        if (selection_.has(DigestAlgorithm::Crc32)) crc32_.update(data, slice);
+        if (selection_.has(DigestAlgorithm::Crc32c)) crc32c_.update(data, slice);
+        if (selection_.has(DigestAlgorithm::Blake3)) blake3_.update(data, slice);
+        data += slice;
+        len -= slice;
+    }
+}
+
+DigestValues MultiDigest::finish() {
+    DigestValues result;
+    auto slot = [&](DigestAlgorithm algorithm) -> DigestValue& {
+        return result.values[static_cast<size_t>(algorithm)];
+    };
+    if (selection_.has(DigestAlgorithm::Md5)) store(slot(DigestAlgorithm::Md5), md5_.finish());
+    if (selection_.has(DigestAlgorithm::Sha1)) store(slot(DigestAlgorithm::Sha1), sha1_.finish());
+    if (selection_.has(DigestAlgorithm::Sha512)) store(slot(DigestAlgorithm::Sha512), sha512_.finish());
+    if (selection_.has(DigestAlgorithm::Crc32)) storeCrc(slot(DigestAlgorithm::Crc32), crc32_.value());
+    if (selection_.has(DigestAlgorithm::Crc32c)) storeCrc(slot(DigestAlgorithm::Crc32c), crc32c_.value());
+    if (selection_.has(DigestAlgorithm::Blake3)) store(slot(DigestAlgorithm::Blake3), blake3_.finish());
+    return result;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "blake3.hpp"
+#include "crc32.hpp"
+#include "md5.hpp"
+#include "sha1.hpp"
+#include "sha512.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Digests that can be computed during ingest in addition to SHA-256, which
+ * is always computed.
+ */
+enum class DigestAlgorithm : std::uint8_t {
+    Md5,
+    Sha1,
+    Sha512,
+    Crc32,
+    Crc32c,
+    Blake3,
+    Count
+};
+
+/**
+ * The canonical lowercase name ("md5", "sha1", "sha512", "crc32", "crc32c",
+ * "blake3").
+ */
+const char* digestAlgorithmName(DigestAlgorithm algorithm);
+
+/**
+ * Whether name spells the lowercase canonical algorithm name, ignoring ASCII
+ * case and hyphens ("SHA-256" matches "sha256"). The grammar every digest
+ * name lookup shares.
+ */
+bool digestNameMatches(std::string_view name, std::string_view canonical);
+
+/**
+ * Resolves a name case-insensitively; the hyphenated forms used by HTTP
+ * ("sha-1", "sha-512") are accepted too. Returns false for unknown names.
+ */
+bool lookupDigestAlgorithm(std::string_view name, DigestAlgorithm& out);
+
+/**
+ * A fixed-size set of DigestAlgorithm values, iterated in enum order.
+ */
+class DigestSelection {
+public:
+    void add(DigestAlgorithm algorithm) { bits_ |= bit(algorithm); }
+    void remove(DigestAlgorithm algorithm) { bits_ &= ~bit(algorithm); }
+    bool has(DigestAlgorithm algorithm) const { return (bits_ & bit(algorithm)) != 0; }
+    bool empty() const { return bits_ == 0; }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(DigestAlgorithm::Count); ++i) {
+            if (bits_ & (1u << i)) {
+                fn(static_cast<DigestAlgorithm>(i));
+            }
+        }
+    }
+
+private:
+    static std::uint32_t bit(DigestAlgorithm algorithm) { return 1u << static_cast<unsigned>(algorithm); }
+
+    std::uint32_t bits_ = 0;
+};
+
+/**
+ * A raw digest of up to 64 bytes; CRCs are stored big-endian, the byte order
+ * of their usual hex and base64 forms.
+ */
+struct DigestValue {
+    std::uint8_t size = 0; // 0 when the digest was not computed
+    std::array<std::uint8_t, 64> bytes{};
+
+    void assign(const std::uint8_t* data, std::size_t len);
+
+    std::string hex() const;
+};
+
+/**
+ * One slot per algorithm; only the selected ones have a non-zero size.
+ */
+struct DigestValues {
+    std::array<DigestValue, static_cast<std::size_t>(DigestAlgorithm::Count)> values;
+
+    const DigestValue& operator[](DigestAlgorithm algorithm) const {
+        return values[static_cast<std::size_t>(algorithm)];
+    }
+
+    DigestValue& operator[](DigestAlgorithm algorithm) { return values[static_cast<std::size_t>(algorithm)]; }
+};
+
+/**
+ * Computes a selection of digests in one pass. Input is fed to every selected
+ * algorithm a kSliceSize slice at a time, so each slice is still in L1 cache
+ * when the next algorithm reads it.
+ */
+class MultiDigest {
+public:
+    static constexpr std::size_t kSliceSize = 8 * 1024;
+
+    explicit MultiDigest(DigestSelection selection) : selection_(selection) {}
+
+    DigestSelection selection() const { return selection_; }
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Completes the selected digests; call once, after the last update().
+     */
+    DigestValues finish();
+
+private:
+    DigestSelection selection_;
+    Md5 md5_;
+    Sha1 sha1_;
+    Sha512 sha512_;
+    Crc32 crc32_;
+    Crc32c crc32c_;
+    Blake3 blake3_;
+};
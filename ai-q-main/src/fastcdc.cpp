@@ -0,0 +1,110 @@
+#include "fastcdc.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Internal: 256 pseudo-random gear values, from splitmix64 so the table is
+ * reproducible; chunk boundaries (and so stored chunks) depend on it.
+ */
+constexpr array<uint64_t, 256> makeGearTable() {
+    array<uint64_t, 256> table{};
+    uint64_t state = 0x6a09e667f3bcc908ull;
+    for (size_t i = 0; i < table.size(); ++i) {
+        state += 0x9e3779b97f4a7c15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        table[i] = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr array<uint64_t, 256> kGear = makeGearTable();
+
+unsigned log2Exact(uint32_t value) {
+    unsigned bits = 0;
+    while ((uint32_t(1) << bits) < value) {
+        ++bits;
+    }
+    return bits;
+}
+
+uint64_t topBitsMask(unsigned bits) {
+    return ~uint64_t(0) << (64 - bits);
+}
+
+} // namespace (internal)
+
+FastCdcChunker::FastCdcChunker(uint32_t averageSize) {
+    if (averageSize < kMinAverageSize || averageSize > kMaxAverageSize || (averageSize & (averageSize - 1)) != 0) {
+        throw runtime_error("FastCDC average chunk size must be a power of two in [256, 16 MiB]");
+    }
+    const unsigned bits = log2Exact(averageSize);
+    minSize_ = averageSize / 4;
+    averageSize_ = averageSize;
+    maxSize_ = averageSize * 8;
+    strictMask_ = topBitsMask(bits + 2);
+    looseMask_ = topBitsMask(bits - 2);
+}
+
+void FastCdcChunker::update(const uint8_t* data, size_t len, vector<CdcChunk>& out) {
+    while (len > 0) {
+        size_t used = 0;
+        bool cut = false;
+        if (chunkLength_ < minSize_) {
+            // Cut-point skipping: no boundary can fall here, so these bytes are only hashed.
+            used = min<size_t>(len, minSize_ - chunkLength_);
+        } else {
+            uint64_t fp = fingerprint_;
+            const size_t strictEnd = chunkLength_ < averageSize_ ? min<size_t>(len, averageSize_ - chunkLength_) : 0;
+            while (used < strictEnd) {
+                fp = (fp << 1) + kGear[data[used++]];
+                if ((fp & strictMask_) == 0) {
+                    cut = true;
+                    break;
+                }
+            }
+            const size_t looseEnd = min<size_t>(len, maxSize_ - chunkLength_);
+            while (!cut && used < looseEnd) {
+                fp = (fp << 1) + kGear[data[used++]];
+                if ((fp & looseMask_) == 0) {
+                    cut = true;
+                }
+            }
+            fingerprint_ = fp;
+        }
+        hasher_.update(data, used);
+        chunkLength_ += static_cast<uint32_t>(used);
+        data += used;
+        len -= used;
+        if (cut || chunkLength_ == maxSize_) {
+            emit(out);
+        }
+    }
+}
+
+void FastCdcChunker::finish(vector<CdcChunk>& out) {
+    if (chunkLength_ > 0) {
+        emit(out);
+    }
+}
+
+void FastCdcChunker::emit(vector<CdcChunk>& out) {
+    CdcChunk chunk;
+    chunk.offset = chunkStart_;
+    chunk.length = chunkLength_;
+    chunk.digest = hasher_.finish();
+    out.push_back(chunk);
+    chunkStart_ += chunkLength_;
+    chunkLength_ = 0;
+    fingerprint_ = 0;
+    hasher_ = Sha256();
+}
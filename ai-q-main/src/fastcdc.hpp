@@ -0,0 +1,69 @@
+#pragma once
+
+#include "sha256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * One content-defined chunk of an upload.
+ */
+struct CdcChunk {
+    std::uint64_t offset = 0;
+    std::uint32_t length = 0;
+    Sha256Digest digest;
+};
+
+/**
+ * Streaming FastCDC (Xia et al., USENIX ATC 2016) content-defined chunker.
+ * Boundaries depend only on the nearby bytes, so an insertion or deletion
+ * moves the boundaries around it and leaves the rest of the file's chunks
+ * unchanged, which is what lets edited revisions share chunks.
+ *
+ * A gear hash rolls over the last 64 bytes; a boundary falls where its top
+ * bits are zero. Following the paper, the first minSize bytes of a chunk are
+ * not scanned, and the cut condition is stricter before averageSize and looser
+ * after it (normalized chunking, level 2), which keeps sizes near the average.
+ * Chunks never exceed maxSize. Each chunk's SHA-256 is computed as its bytes
+ * stream past.
+ */
+class FastCdcChunker {
+public:
+    /**
+     * averageSize must be a power of two in [kMinAverageSize, kMaxAverageSize];
+     * chunks then range over [averageSize / 4, averageSize * 8]. Throws
+     * std::runtime_error otherwise.
+     */
+    explicit FastCdcChunker(std::uint32_t averageSize);
+
+    /**
+     * Chunks data, appending each chunk completed within it to out.
+     */
+    void update(const std::uint8_t* data, std::size_t len, std::vector<CdcChunk>& out);
+
+    /**
+     * Appends the final, possibly short, chunk; call once after the last update().
+     */
+    void finish(std::vector<CdcChunk>& out);
+
+    std::uint32_t minSize() const { return minSize_; }
+    std::uint32_t averageSize() const { return averageSize_; }
+    std::uint32_t maxSize() const { return maxSize_; }
+
+    static constexpr std::uint32_t kMinAverageSize = 256;
+    static constexpr std::uint32_t kMaxAverageSize = std::uint32_t(1) << 24;
+
+private:
+    void emit(std::vector<CdcChunk>& out);
+
+    std::uint32_t minSize_;
+    std::uint32_t averageSize_;
+    std::uint32_t maxSize_;
+    std::uint64_t strictMask_;
+    std::uint64_t looseMask_;
+    std::uint64_t fingerprint_ = 0;
+    std::uint64_t chunkStart_ = 0;
+    std::uint32_t chunkLength_ = 0;
+    Sha256 hasher_;
+};
@@ -0,0 +1,100 @@
+#include "hex.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Two output characters per byte value, so encoding is one table load per byte.
+ */
+constexpr array<char, 512> makeHexPairs() {
+    constexpr char digits[] = "0123456789abcdef";
+    array<char, 512> table{};
+    for (size_t i = 0; i < 256; ++i) {
+        table[i * 2] = digits[i >> 4];
+        table[i * 2 + 1] = digits[i & 0x0F];
+    }
+    return table;
+}
+
+constexpr array<char, 512> kHexPairs = makeHexPairs();
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+} // namespace (internal)
+
+void hexEncode(const uint8_t* data, size_t len, char* out) {
+    for (size_t i = 0; i < len; ++i) {
+        const char* pair = &kHexPairs[static_cast<size_t>(data[i]) * 2];
+        out[i * 2] = pair[0];
+        out[i * 2 + 1] = pair[1];
+    }
+}
+
+string hexString(const uint8_t* data, size_t len) {
+    string out(len * 2, '\0');
+    hexEncode(data, len, &out[0]);
+    return out;
+}
+
+bool hexDecode(string_view text, uint8_t* out, size_t len) {
+    if (text.size() != len * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        const int hi = hexValue(text[i * 2]);
+        const int lo = hexValue(text[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+bool base64Decode(string_view text, uint8_t* out, size_t len) {
+    while (!text.empty() && text.back() == '=') {
+        text.remove_suffix(1);
+    }
+    // Unpadded length of len bytes: four characters per three bytes, plus
+    // two or three for a trailing one or two.
+    if (text.size() != len / 3 * 4 + (len % 3 == 0 ? 0 : len % 3 + 1)) {
+        return false;
+    }
+    uint32_t bits = 0;
+    unsigned held = 0;
+    size_t written = 0;
+    for (char c : text) {
+        const int value = base64Value(c);
+        if (value < 0) {
+            return false;
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        held += 6;
+        if (held >= 8) {
+            held -= 8;
+            out[written++] = static_cast<uint8_t>(bits >> held);
+        }
+    }
+    // Leftover bits must be zero in canonical encodings.
+    return (bits & ((1u << held) - 1)) == 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Writes the lowercase hex encoding of len bytes to out, which must hold 2 * len chars.
+ * No terminator is written.
+ */
+void hexEncode(const std::uint8_t* data, std::size_t len, char* out);
+
+/**
+ * Convenience wrapper returning the lowercase hex encoding as a string.
+ */
+std::string hexString(const std::uint8_t* data, std::size_t len);
+
+/**
+ * Decodes hex (either case) of exactly 2 * len characters into out. Returns
+ * false on any other length or a non-hex character.
+ */
+bool hexDecode(std::string_view text, std::uint8_t* out, std::size_t len);
+
+/**
+ * Decodes standard base64 (RFC 4648 section 4, padding optional) that holds
+ * exactly len bytes into out. Returns false otherwise.
+ */
+bool base64Decode(std::string_view text, std::uint8_t* out, std::size_t len);
@@ -0,0 +1,469 @@
+#include "inflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr array<uint16_t, 29> kLengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr array<uint8_t, 29> kLengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr array<uint16_t, 30> kDistanceBase = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                               33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                               1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr array<uint8_t, 30> kDistanceExtra = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order in which code-length code lengths are transmitted (RFC 1951 3.2.7).
+constexpr array<uint8_t, 19> kCodeLengthOrder = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/**
+ * Internal: builds a canonical Huffman code from per-symbol code lengths.
+ * Returns false for over-subscribed lengths; incomplete codes are accepted
+ * and their unused bit patterns fail at decode time.
+ */
+bool buildHuffman(RawInflater::Huffman& code, const uint8_t* lengths, size_t count) {
+    code = RawInflater::Huffman{};
+    for (size_t sym = 0; sym < count; ++sym) {
+        ++code.count[lengths[sym]];
+    }
+    code.count[0] = 0;
+    int left = 1;
+    for (size_t len = 1; len < 16; ++len) {
+        left = (left << 1) - code.count[len];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    array<uint16_t, 16> offsets{};
+    array<uint16_t, 16> next{};
+    uint32_t canonical = 0;
+    for (size_t len = 1; len < 16; ++len) {
+        offsets[len] = static_cast<uint16_t>(len == 1 ? 0 : offsets[len - 1] + code.count[len - 1]);
+        canonical = (canonical + (len == 1 ? 0 : code.count[len - 1])) << 1;
+        next[len] = static_cast<uint16_t>(canonical);
+    }
+    for (size_t sym = 0; sym < count; ++sym) {
+        const unsigned len = lengths[sym];
+        if (len == 0) {
+            continue;
+        }
+        code.symbol[offsets[len]++] = static_cast<uint16_t>(sym);
+        const uint32_t assigned = next[len]++;
+        if (len <= RawInflater::kFastBits) {
+            // Codes are sent most significant bit first into an LSB-first stream.
+            uint32_t reversed = 0;
+            for (unsigned bit = 0; bit < len; ++bit) {
+                reversed |= ((assigned >> bit) & 1u) << (len - 1 - bit);
+            }
+            for (uint32_t index = reversed; index < code.fast.size(); index += 1u << len) {
+                code.fast[index] = static_cast<uint16_t>((sym << 4) | len);
+            }
+        }
+    }
+    return true;
+}
+
+struct FixedCodes {
+    RawInflater::Huffman literal;
+    RawInflater::Huffman distance;
+
+    FixedCodes() {
+        array<uint8_t, 288> lengths{};
+        fill(lengths.begin(), lengths.begin() + 144, 8);
+        fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+        fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+        fill(lengths.begin() + 280, lengths.end(), 8);
+        buildHuffman(literal, lengths.data(), lengths.size());
+        fill(lengths.begin(), lengths.begin() + 30, 5);
+        buildHuffman(distance, lengths.data(), 30);
+    }
+};
+
+const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+} // namespace (internal)
+
+RawInflater::RawInflater(uint64_t maxOutput) : maxOutput_(maxOutput) {}
+
+void RawInflater::reset() {
+    status_ = Status::NeedInput;
+    state_ = State::BlockHeader;
+    error_ = "";
+    totalOut_ = 0;
+    flushed_ = 0;
+    bits_ = 0;
+    bitCount_ = 0;
+    finalBlock_ = false;
+}
+
+void RawInflater::refill() {
+    while (bitCount_ <= 56 && in_ < inEnd_) {
+        bits_ |= static_cast<uint64_t>(*in_++) << bitCount_;
+        bitCount_ += 8;
+    }
+}
+
+bool RawInflater::need(unsigned bits) {
+    if (bitCount_ < bits) {
+        refill();
+    }
+    return bitCount_ >= bits;
+}
+
+uint32_t RawInflater::take(unsigned bits) {
+    const uint32_t value = static_cast<uint32_t>(bits_ & ((uint64_t(1) << bits) - 1));
+    bits_ >>= bits;
+    bitCount_ -= bits;
+    return value;
+}
+
+RawInflater::Decode RawInflater::decode(const Huffman& code, unsigned& symbol) {
+    refill();
+    const uint16_t entry = code.fast[bits_ & (code.fast.size() - 1)];
+    if (entry != 0) {
+        const unsigned len = entry & 15u;
+        if (len > bitCount_) {
+            return Decode::NeedInput;
+        }
+        take(len);
+        symbol = entry >> 4;
+        return Decode::Ok;
+    }
+    // Longer codes (or too few bits to trust the table): walk the canonical code.
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    for (unsigned len = 1; len < 16; ++len) {
+        if (len > bitCount_) {
+            return Decode::NeedInput;
+        }
+        value |= static_cast<int>((bits_ >> (len - 1)) & 1u);
+        const int count = code.count[len];
+        if (value - first < count) {
+            symbol = code.symbol[static_cast<size_t>(index + value - first)];
+            take(len);
+            return Decode::Ok;
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return Decode::Invalid;
+}
+
+bool RawInflater::fail(const char* message) {
+    status_ = Status::Error;
+    error_ = message;
+    state_ = State::Finished;
+    return false;
+}
+
+void RawInflater::flush(InflateOutput& out) {
+    const uint64_t pending = totalOut_ - flushed_;
+    if (pending == 0) {
+        return;
+    }
+    const size_t start = static_cast<size_t>(flushed_ & (kWindowSize - 1));
+    const size_t first = static_cast<size_t>(min<uint64_t>(pending, kWindowSize - start));
+    out.write(window_.data() + start, first);
+    if (pending > first) {
+        out.write(window_.data(), static_cast<size_t>(pending - first));
+    }
+    flushed_ = totalOut_;
+}
+
+bool RawInflater::emitByte(uint8_t byte, InflateOutput& out) {
+    if (totalOut_ >= maxOutput_) {
+        return fail("inflated size exceeds limit");
+    }
+    if (totalOut_ - flushed_ == kWindowSize) {
+        flush(out);
+    }
+    window_[totalOut_ & (kWindowSize - 1)] = byte;
+    ++totalOut_;
+    return true;
+}
+
+bool RawInflater::emitBytes(const uint8_t* data, size_t len, InflateOutput& out) {
+    if (len > maxOutput_ - totalOut_) {
+        return fail("inflated size exceeds limit");
+    }
+    while (len > 0) {
+        if (totalOut_ - flushed_ == kWindowSize) {
+            flush(out);
+        }
+        const size_t pos = static_cast<size_t>(totalOut_ & (kWindowSize - 1));
+        const size_t room = kWindowSize - static_cast<size_t>(totalOut_ - flushed_);
+        const size_t n = min({len, room, kWindowSize - pos});
+        memcpy(window_.data() + pos, data, n);
+        totalOut_ += n;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool RawInflater::copyMatch(unsigned distance, unsigned length, InflateOutput& out) {
+    if (distance > totalOut_) {
+        return fail("distance too far back");
+    }
+    if (length > maxOutput_ - totalOut_) {
+        return fail("inflated size exceeds limit");
+    }
+    while (length > 0) {
+        if (totalOut_ - flushed_ == kWindowSize) {
+            flush(out);
+        }
+        const size_t pos = static_cast<size_t>(totalOut_ & (kWindowSize - 1));
+        const size_t from = static_cast<size_t>((totalOut_ - distance) & (kWindowSize - 1));
+        const size_t room = kWindowSize - static_cast<size_t>(totalOut_ - flushed_);
+        // A piece no longer than the distance only reads bytes that existed
+        // before it; memmove because the ring may wrap the source onto it.
+        const size_t n = min({static_cast<size_t>(length), static_cast<size_t>(distance), room, kWindowSize - pos,
+                              kWindowSize - from});
+        memmove(window_.data() + pos, window_.data() + from, n);
+        totalOut_ += n;
+        length -= static_cast<unsigned>(n);
+    }
+    return true;
+}
+
+bool RawInflater::step(InflateOutput& out) {
+    switch (state_) {
+    case State::BlockHeader: {
+        if (!need(3)) {
+            return false;
+        }
+        finalBlock_ = take(1) != 0;
+        switch (take(2)) {
+        case 0:
+            take(bitCount_ % 8); // stored blocks start on a byte boundary
+            state_ = State::StoredLength;
+            return true;
+        case 1:
+            activeLiteral_ = &fixedCodes().literal;
+            activeDistance_ = &fixedCodes().distance;
+            state_ = State::Literal;
+            return true;
+        case 2:
+            state_ = State::TableCounts;
+            return true;
+        default:
+            return fail("invalid block type");
+        }
+    }
+    case State::StoredLength: {
+        if (!need(32)) {
+            return false;
+        }
+        const uint32_t length = take(16);
+        const uint32_t complement = take(16);
+        if (length != (~complement & 0xFFFFu)) {
+            return fail("stored block length mismatch");
+        }
+        storedRemaining_ = length;
+        state_ = State::StoredCopy;
+        return true;
+    }
+    case State::StoredCopy: {
+        // Whole bytes already in the bit accumulator go first, then input is copied directly.
+        while (storedRemaining_ > 0 && bitCount_ >= 8) {
+            if (!emitByte(static_cast<uint8_t>(take(8)), out)) {
+                return false;
+            }
+            --storedRemaining_;
+        }
+        if (storedRemaining_ > 0) {
+            const size_t n = min<size_t>(storedRemaining_, static_cast<size_t>(inEnd_ - in_));
+            if (n == 0) {
+                return false;
+            }
+            if (!emitBytes(in_, n, out)) {
+                return false;
+            }
+            in_ += n;
+            storedRemaining_ -= static_cast<uint32_t>(n);
+            return true;
+        }
+        state_ = finalBlock_ ? State::Finished : State::BlockHeader;
+        return true;
+    }
+    case State::TableCounts: {
+        if (!need(14)) {
+            return false;
+        }
+        literalCount_ = take(5) + 257;
+        distanceCount_ = take(5) + 1;
+        codeLengthCount_ = take(4) + 4;
+        if (literalCount_ > 286 || distanceCount_ > 30) {
+            return fail("too many length or distance codes");
+        }
+        fill(lengths_.begin(), lengths_.begin() + kCodeLengthOrder.size(), 0);
+        lengthIndex_ = 0;
+        state_ = State::CodeLengthLengths;
+        return true;
+    }
+    case State::CodeLengthLengths: {
+        while (lengthIndex_ < codeLengthCount_) {
+            if (!need(3)) {
+                return false;
+            }
+            lengths_[kCodeLengthOrder[lengthIndex_++]] = static_cast<uint8_t>(take(3));
+        }
+        if (!buildHuffman(codeLengthCode_, lengths_.data(), kCodeLengthOrder.size())) {
+            return fail("invalid code length code");
+        }
+        lengthIndex_ = 0;
+        state_ = State::CodeLengths;
+        return true;
+    }
+    case State::CodeLengths: {
+        const unsigned total = literalCount_ + distanceCount_;
+        while (lengthIndex_ < total) {
+            unsigned symbol = 0;
+            const Decode result = decode(codeLengthCode_, symbol);
+            if (result == Decode::NeedInput) {
+                return false;
+            }
+            if (result == Decode::Invalid) {
+                return fail("invalid code length");
+            }
+            if (symbol < 16) {
+                lengths_[lengthIndex_++] = static_cast<uint8_t>(symbol);
+            } else {
+                pendingSymbol_ = symbol;
+                state_ = State::CodeLengthRepeat;
+                return true;
+            }
+        }
+        if (lengths_[256] == 0) {
+            return fail("missing end-of-block code");
+        }
+        if (!buildHuffman(literalCode_, lengths_.data(), literalCount_) ||
+            !buildHuffman(distanceCode_, lengths_.data() + literalCount_, distanceCount_)) {
+            return fail("invalid literal/length or distance code");
+        }
+        activeLiteral_ = &literalCode_;
+        activeDistance_ = &distanceCode_;
+        state_ = State::Literal;
+        return true;
+    }
+    case State::CodeLengthRepeat: {
+        const unsigned extra = pendingSymbol_ == 16 ? 2 : pendingSymbol_ == 17 ? 3 : 7;
+        if (!need(extra)) {
+            return false;
+        }
+        const unsigned base = pendingSymbol_ == 16 ? 3 : pendingSymbol_ == 17 ? 3 : 11;
+        const unsigned repeat = base + take(extra);
+        if (pendingSymbol_ == 16 && lengthIndex_ == 0) {
+            return fail("repeat with no previous length");
+        }
+        if (lengthIndex_ + repeat > literalCount_ + distanceCount_) {
+            return fail("code lengths overflow");
+        }
+        const uint8_t value = pendingSymbol_ == 16 ? lengths_[lengthIndex_ - 1] : 0;
+        fill(lengths_.begin() + lengthIndex_, lengths_.begin() + lengthIndex_ + repeat, value);
+        lengthIndex_ += repeat;
+        state_ = State::CodeLengths;
+        return true;
+    }
+    case State::Literal: {
+        while (true) {
+            unsigned symbol = 0;
+            const Decode result = decode(*activeLiteral_, symbol);
+            if (result == Decode::NeedInput) {
+                return false;
+            }
+            if (result == Decode::Invalid) {
+                return fail("invalid literal/length code");
+            }
+            if (symbol < 256) {
+                if (!emitByte(static_cast<uint8_t>(symbol), out)) {
+                    return false;
+                }
+                continue;
+            }
+            if (symbol == 256) {
+                state_ = finalBlock_ ? State::Finished : State::BlockHeader;
+                return true;
+            }
+            if (symbol - 257 >= kLengthBase.size()) {
+                return fail("invalid length symbol");
+            }
+            pendingSymbol_ = symbol - 257;
+            state_ = State::LengthExtra;
+            return true;
+        }
+    }
+    case State::LengthExtra: {
+        const unsigned extra = kLengthExtra[pendingSymbol_];
+        if (!need(extra)) {
+            return false;
+        }
+        matchLength_ = kLengthBase[pendingSymbol_] + take(extra);
+        state_ = State::Distance;
+        return true;
+    }
+    case State::Distance: {
+        unsigned symbol = 0;
+        const Decode result = decode(*activeDistance_, symbol);
+        if (result == Decode::NeedInput) {
+            return false;
+        }
+        if (result == Decode::Invalid || symbol >= kDistanceBase.size()) {
+            return fail("invalid distance code");
+        }
+        pendingSymbol_ = symbol;
+        state_ = State::DistanceExtra;
+        return true;
+    }
+    case State::DistanceExtra: {
+        const unsigned extra = kDistanceExtra[pendingSymbol_];
+        if (!need(extra)) {
+            return false;
+        }
+        const unsigned distance = kDistanceBase[pendingSymbol_] + take(extra);
+        if (!copyMatch(distance, matchLength_, out)) {
+            return false;
+        }
+        state_ = State::Literal;
+        return true;
+    }
+    case State::Finished:
+        return false;
+    }
+    return false;
+}
+
+RawInflater::Status RawInflater::feed(const uint8_t* data, size_t len, size_t& consumed, InflateOutput& out) {
+    consumed = 0;
+    if (status_ != Status::NeedInput) {
+        return status_;
+    }
+    in_ = data;
+    inEnd_ = data + len;
+    while (step(out)) {
+    }
+    size_t used = static_cast<size_t>(in_ - data);
+    if (state_ == State::Finished && status_ != Status::Error) {
+        status_ = Status::Done;
+        // Whole bytes read ahead into the accumulator lie past the stream.
+        used -= min<size_t>(bitCount_ / 8, used);
+        bits_ = 0;
+        bitCount_ = 0;
+    }
+    flush(out);
+    consumed = used;
+    in_ = nullptr;
+    inEnd_ = nullptr;
+    return status_;
+}
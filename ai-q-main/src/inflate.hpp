@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Receives decompressed bytes from a RawInflater.
+ */
+class InflateOutput {
+public:
+    virtual ~InflateOutput() = default;
+    virtual void write(const std::uint8_t* data, std::size_t len) = 0;
+};
+
+/**
+ * Streaming decoder for raw DEFLATE (RFC 1951), the ZIP method 8 payload.
+ * Input may be split anywhere, down to single bytes: every decoding step
+ * either completes or leaves the state untouched until more input arrives,
+ * so nothing but the 32 KiB history window and a few pending bits is held
+ * between calls. Output is delivered in slices to an InflateOutput and can be
+ * capped, which bounds the work done on hostile streams.
+ */
+class RawInflater {
+public:
+    enum class Status {
+        NeedInput, // all input consumed, stream not finished
+        Done,      // final block decoded
+        Error,     // malformed stream or output cap exceeded; see error()
+    };
+
+    explicit RawInflater(std::uint64_t maxOutput = UINT64_MAX);
+
+    /**
+     * Prepares for a new stream, keeping the output cap.
+     */
+    void reset();
+
+    void setMaxOutput(std::uint64_t maxOutput) { maxOutput_ = maxOutput; }
+
+    /**
+     * Decodes as much of the input as possible. consumed is set to the number
+     * of input bytes that belong to the stream: all of them unless the stream
+     * ended (Done) part way through. Once Done or Error, further calls consume
+     * nothing and return the same status.
+     */
+    Status feed(const std::uint8_t* data, std::size_t len, std::size_t& consumed, InflateOutput& out);
+
+    Status status() const { return status_; }
+
+    std::uint64_t totalOut() const { return totalOut_; }
+
+    /**
+     * Static description of the failure; empty unless status() is Error.
+     */
+    const char* error() const { return error_; }
+
+    static constexpr unsigned kFastBits = 9;
+
+    /**
+     * A canonical Huffman code: a lookup table for codes up to kFastBits long
+     * and per-length counts plus symbols in canonical order for the rest.
+     */
+    struct Huffman {
+        std::array<std::uint16_t, 1u << kFastBits> fast{}; // (symbol << 4) | length; 0 = not in table
+        std::array<std::uint16_t, 16> count{};
+        std::array<std::uint16_t, 288> symbol{};
+    };
+
+private:
+    enum class State {
+        BlockHeader,
+        StoredLength,
+        StoredCopy,
+        TableCounts,
+        CodeLengthLengths,
+        CodeLengths,
+        CodeLengthRepeat,
+        Literal,
+        LengthExtra,
+        Distance,
+        DistanceExtra,
+        Finished,
+    };
+
+    enum class Decode { Ok, NeedInput, Invalid };
+
+    void refill();
+    bool need(unsigned bits);
+    std::uint32_t take(unsigned bits);
+    Decode decode(const Huffman& code, unsigned& symbol);
+    bool step(InflateOutput& out);
+    bool fail(const char* message);
+    bool emitByte(std::uint8_t byte, InflateOutput& out);
+    bool emitBytes(const std::uint8_t* data, std::size_t len, InflateOutput& out);
+    bool copyMatch(unsigned distance, unsigned length, InflateOutput& out);
+    void flush(InflateOutput& out);
+
+    static constexpr std::size_t kWindowSize = 32768;
+
+    Status status_ = Status::NeedInput;
+    State state_ = State::BlockHeader;
+    const char* error_ = "";
+    std::uint64_t maxOutput_;
+    std::uint64_t totalOut_ = 0;
+    std::uint64_t flushed_ = 0;
+
+    // Bit reader: LSB-first accumulator over the current feed() input.
+    std::uint64_t bits_ = 0;
+    unsigned bitCount_ = 0;
+    const std::uint8_t* in_ = nullptr;
+    const std::uint8_t* inEnd_ = nullptr;
+
+    bool finalBlock_ = false;
+    std::uint32_t storedRemaining_ = 0;
+    unsigned literalCount_ = 0;
+    unsigned distanceCount_ = 0;
+    unsigned codeLengthCount_ = 0;
+    unsigned lengthIndex_ = 0;
+    unsigned pendingSymbol_ = 0;
+    unsigned matchLength_ = 0;
+    std::array<std::uint8_t, 320> lengths_{};
+    Huffman codeLengthCode_;
+    Huffman literalCode_;
+    Huffman distanceCode_;
+    const Huffman* activeLiteral_ = nullptr;
+    const Huffman* activeDistance_ = nullptr;
+
+    std::array<std::uint8_t, kWindowSize> window_{};
+};
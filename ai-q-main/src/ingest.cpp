@@ -1,18 +1,33 @@
 #include "ingest.hpp"
 
+#include "active_content.hpp"
+#include "byte_histogram.hpp"
 #include "byte_source.hpp"
+#include "digest_set.hpp"
+#include "fastcdc.hpp"
+#include "hex.hpp"
+#include "metrics.hpp"
+#include "mime.hpp"
+#include "perf_counters.hpp"
+#include "png_verify.hpp"
+#include "sha256.hpp"
+#include "tlsh.hpp"
+#include "trace.hpp"
+#include "utf8.hpp"
+#include "xxh3.hpp"
+#include "zip_verify.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
-#include <iomanip>
 #include <limits>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -41,232 +56,616 @@ private:
     size_t offset_;
 };
 
-// ---------- SHA-256 utilities ----------
-constexpr array<uint32_t, 64> kSha256K = {
-    0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
-    0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
-    0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
-    0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
-    0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
-    0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
-    0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
-    0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL};
-
-inline uint32_t rotr(uint32_t value, uint32_t bits) {
-    return (value >> bits) | (value << (32 - bits));
-}
+constexpr size_t kReadChunkSize = 64 * 1024;
 
-array<uint32_t, 8> sha256StateInit() {
-    return {0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
-            0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL};
+// ---------- Hardware counters ----------
+/**
+ * The calling thread's counter group, opened on first use so threads that never
+ * sample pay nothing. Returns nullptr when counters are unavailable.
+ */
+PerfCounterGroup* threadPerfCounters() {
+    thread_local PerfCounterGroup group;
+    return group.available() ? &group : nullptr;
 }
 
 /**
- * Internal: Updates SHA-256 state with a message block.
+ * Adds one region's counters into a running total.
  */
-void sha256ProcessBlock(array<uint32_t, 8>& state, const uint8_t* block) {
-    uint32_t w[64];
-    for (int i = 0; i < 16; ++i) {
-        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
-               (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
-               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
-               (static_cast<uint32_t>(block[i * 4 + 3]));
-    }
-    for (int i = 16; i < 64; ++i) {
-        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
-        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
-        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
-    }
-
-    uint32_t a = state[0];
-    uint32_t b = state[1];
-    uint32_t c = state[2];
-    uint32_t d = state[3];
-    uint32_t e = state[4];
-    uint32_t f = state[5];
-    uint32_t g = state[6];
-    uint32_t h = state[7];
-
-    for (int i = 0; i < 64; ++i) {
-        uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
-        uint32_t ch = (e & f) ^ ((~e) & g);
-        uint32_t temp1 = h + S1 + ch + kSha256K[i] + w[i];
-        uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
-        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
-        uint32_t temp2 = S0 + maj;
-
-        h = g;
-        g = f;
-        f = e;
-        e = d + temp1;
-        d = c;
-        c = b;
-        b = a;
-        a = temp1 + temp2;
-    }
-
-    state[0] += a;
-    state[1] += b;
-    state[2] += c;
-    state[3] += d;
-    state[4] += e;
-    state[5] += f;
-    state[6] += g;
-    state[7] += h;
+void accumulate(PerfSample& total, const PerfSample& sample) {
+    if (!sample.valid) {
+        return;
+    }
+    total.valid = true;
+    total.cycles += sample.cycles;
+    total.instructions += sample.instructions;
+    total.cacheMisses += sample.cacheMisses;
+    total.branchMisses += sample.branchMisses;
 }
 
+// ------------ Validation ----------
 /**
- * Computes the SHA-256 hex digest of the given buffer.
+ * Gathers validation errors for contentLength and maxContentLength.
  */
-string sha256Hex(const vector<uint8_t>& data) {
-    auto state = sha256StateInit();
-    uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
-
-    size_t processed = 0;
-    size_t blockSize = 64;
-
-    while (processed + blockSize <= data.size()) {
-        sha256ProcessBlock(state, data.data() + processed);
-        processed += blockSize;
+void validateLengths(const UploadMeta& meta, int64_t size, int64_t maxContentLength, IngestErrorSet& errors) {
+    if (meta.hasContentLength) {
+        if (meta.contentLength < 0) {
+            errors.add(IngestError::ContentLengthNegative);
+        } else if (size != meta.contentLength) {
+            errors.add(IngestError::ContentLengthMismatch);
+        }
     }
-
-    uint8_t finalBlock[128] = {0};
-    size_t remaining = data.size() - processed;
-    memcpy(finalBlock, data.data() + processed, remaining);
-    finalBlock[remaining] = 0x80;
-
-    size_t paddingIndex = ((remaining + 9) <= blockSize) ? blockSize - 8 : (2 * blockSize) - 8;
-    for (size_t i = 0; i < 8; ++i) {
-        finalBlock[paddingIndex + i] = static_cast<uint8_t>((bitLength >> (56 - i * 8)) & 0xFF);
+    if (maxContentLength >= 0 && size > maxContentLength) {
+        errors.add(IngestError::ExceedsMaxContentLength);
     }
+}
 
-    sha256ProcessBlock(state, finalBlock);
-    if (paddingIndex != blockSize - 8) {
-        sha256ProcessBlock(state, finalBlock + blockSize);
+/**
+ * Gathers validation errors about allowed MIME and claimed-vs-detected.
+ * The claimed type is compared by essence (parameters and case ignored) without allocating.
+ */
+void validateMime(const UploadMeta& meta, MimeType detected, const IngestPolicy& policy, IngestErrorSet& errors) {
+    MimeType claimed;
+    if (!meta.claimedMime.empty() && !(lookupMimeType(meta.claimedMime, claimed) && mimeCovers(claimed, detected))) {
+        errors.add(IngestError::ClaimedMimeMismatch);
     }
-
-    ostringstream oss;
-    oss << hex << setfill('0');
-    for (uint32_t word : state) {
-        oss << setw(8) << word;
+    if (!policy.accepts(detected)) {
+        errors.add(IngestError::MimeNotAccepted);
     }
-    return oss.str();
 }
 
-// ------------ MIME detection ----------
+// How each ZipIntegrityVerifier finding is reported.
+constexpr pair<ZipIntegrityVerifier::Issue, IngestError> kZipIssueErrors[] = {
+    {ZipIntegrityVerifier::Issue::CrcMismatch, IngestError::ZipCrcMismatch},
+    {ZipIntegrityVerifier::Issue::SizeMismatch, IngestError::ZipSizeMismatch},
+    {ZipIntegrityVerifier::Issue::CentralDirectoryMismatch, IngestError::ZipCentralDirectoryMismatch},
+    {ZipIntegrityVerifier::Issue::CorruptData, IngestError::ZipCorrupt},
+    {ZipIntegrityVerifier::Issue::Truncated, IngestError::ZipTruncated},
+    {ZipIntegrityVerifier::Issue::TooManyEntries, IngestError::ZipTooManyEntries},
+    {ZipIntegrityVerifier::Issue::UncompressedSizeExceeded, IngestError::ZipUncompressedSizeExceeded},
+    {ZipIntegrityVerifier::Issue::CompressionRatioExceeded, IngestError::ZipCompressionRatioExceeded},
+};
+
 /**
- * Detects the MIME type of a file's bytes by sniffing content.
+ * Reports the ZIP verifier's integrity and size-limit findings. Only ZIP
+ * containers are checked: other formats lose the walk at their first bytes.
  */
-string detectMime(const vector<uint8_t>& bytes) {
-    if (bytes.size() >= 4) {
-        if (bytes[0] == '%' && bytes[1] == 'P' && bytes[2] == 'D' && bytes[3] == 'F') {
-            return "application/pdf";
-        }
+void validateZip(MimeType detected, const ZipIntegrityVerifier& verifier, IngestErrorSet& errors) {
+    if (!isZipContainer(detected)) {
+        return;
     }
-    if (bytes.size() >= 8) {
-        array<uint8_t, 8> pngMagic = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
-        if (equal(pngMagic.begin(), pngMagic.end(), bytes.begin())) {
-            return "image/png";
+    for (const auto& [issue, error] : kZipIssueErrors) {
+        if (verifier.has(issue)) {
+            errors.add(error);
         }
     }
-    if (bytes.size() >= 4) {
-        if (bytes[0] == 'P' && bytes[1] == 'K' && bytes[2] == 0x03 && bytes[3] == 0x04) {
-            string signature(reinterpret_cast<const char*>(bytes.data()),
-                                        min<size_t>(bytes.size(), static_cast<size_t>(4096)));
-            if (signature.find("word/") != string::npos ||
-                signature.find("[Content_Types].xml") != string::npos) {
-                return "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
-            }
+}
+
+// How each PngVerifier finding is reported.
+constexpr pair<PngVerifier::Issue, IngestError> kPngIssueErrors[] = {
+    {PngVerifier::Issue::CrcMismatch, IngestError::PngCrcMismatch},
+    {PngVerifier::Issue::InvalidHeader, IngestError::PngInvalidHeader},
+    {PngVerifier::Issue::PixelLimitExceeded, IngestError::PngPixelLimitExceeded},
+    {PngVerifier::Issue::MissingEnd, IngestError::PngMissingEnd},
+    {PngVerifier::Issue::Corrupt, IngestError::PngCorrupt},
+};
+
+/**
+ * Reports the PNG verifier's findings for uploads detected as PNG.
+ */
+void validatePng(MimeType detected, const PngVerifier& verifier, IngestErrorSet& errors) {
+    if (detected != MimeType::Png) {
+        return;
+    }
+    for (const auto& [issue, error] : kPngIssueErrors) {
+        if (verifier.has(issue)) {
+            errors.add(error);
         }
     }
-    return "application/octet-stream";
 }
 
 /**
- * Removes parameters and trims the MIME-type string for easier comparison.
+ * Reports structural problems found in uploads detected as PDF.
  */
-string stripMime(string_view mime) {
-    size_t semi = mime.find(';');
-    string base(mime.substr(0, semi));
-    auto notSpace = [](unsigned char ch) { return !isspace(ch); };
-    base.erase(base.begin(), find_if(base.begin(), base.end(), notSpace));
-    base.erase(find_if(base.rbegin(), base.rend(), notSpace).base(), base.end());
-    transform(base.begin(), base.end(), base.begin(), [](unsigned char ch) { return tolower(ch); });
-    return base;
+void validatePdf(MimeType detected, const PdfInfo& pdf, IngestErrorSet& errors) {
+    if (detected != MimeType::Pdf || !pdf.scanned) {
+        return;
+    }
+    if (pdf.truncated) {
+        errors.add(IngestError::PdfTruncated);
+    }
+    if (pdf.invalidStartxref) {
+        errors.add(IngestError::PdfInvalidStartxref);
+    }
 }
 
+// What lookupExpectedAlgorithm reports for SHA-256, which every upload
+// computes outside the DigestAlgorithm set.
+constexpr DigestAlgorithm kExpectedSha256 = DigestAlgorithm::Count;
+
 /**
- * MIME comparison, ignoring parameters.
+ * Resolves the algorithm of an expected digest, SHA-256 as kExpectedSha256.
+ * RFC 3230 names SHA-1 "SHA".
  */
-bool equalsIgnoreParams(string_view lhs, string_view rhs) {
-    return stripMime(lhs) == stripMime(rhs);
+bool lookupExpectedAlgorithm(string_view name, DigestAlgorithm& out) {
+    if (digestNameMatches(name, "sha256")) {
+        out = kExpectedSha256;
+        return true;
+    }
+    if (digestNameMatches(name, "sha")) {
+        out = DigestAlgorithm::Sha1;
+        return true;
+    }
+    return lookupDigestAlgorithm(name, out);
 }
 
 /**
- * Returns true if the detected type is in the acceptedMimes set.
+ * Gathers validation errors for client-supplied digests. Every algorithm they
+ * name (when known) was computed in the ingest pass.
  */
-bool isAcceptedMime(const string& detected, const vector<string>& accepted) {
-    for (const auto& candidate : accepted) {
-        if (equalsIgnoreParams(detected, candidate)) {
-            return true;
+void validateDigests(const UploadMeta& meta, const CompactIngestResult& result, IngestErrorSet& errors) {
+    for (const auto& expected : meta.expectedDigests) {
+        DigestAlgorithm algorithm;
+        if (!lookupExpectedAlgorithm(expected.algorithm, algorithm)) {
+            errors.add(IngestError::ExpectedDigestInvalid);
+            continue;
+        }
+        const uint8_t* actual = result.sha256.bytes.data();
+        size_t size = result.sha256.bytes.size();
+        if (algorithm != kExpectedSha256) {
+            actual = result.digests[algorithm].bytes.data();
+            size = result.digests[algorithm].size;
+        }
+        // Hex is tried first. A CRC's padded base64 is as long as its hex (8
+        // characters) but ends in '=', which is not a hex digit, so it falls
+        // through to base64.
+        uint8_t decoded[64];
+        if (!hexDecode(expected.value, decoded, size) && !base64Decode(expected.value, decoded, size)) {
+            errors.add(IngestError::ExpectedDigestInvalid);
+        } else if (memcmp(decoded, actual, size) != 0) {
+            errors.add(IngestError::ExpectedDigestMismatch);
         }
     }
-    return false;
 }
 
+constexpr array<const char*, static_cast<size_t>(IngestError::Count)> kErrorMessages = {
+    "contentLength is negative",
+    "contentLength mismatch",
+    "exceeds maxContentLength",
+    "claimedMime does not match detectedMime",
+    "detectedMime not accepted",
+    "zip entry CRC-32 mismatch",
+    "zip entry size mismatch",
+    "zip central directory mismatch",
+    "zip data is corrupt",
+    "zip archive is truncated",
+    "zip entry count exceeds maxZipEntries",
+    "zip uncompressed size exceeds maxZipUncompressedSize",
+    "zip compression ratio exceeds maxZipCompressionRatio",
+    "png chunk CRC-32 mismatch",
+    "png IHDR is missing or invalid",
+    "png pixel count exceeds maxImagePixels",
+    "png IEND chunk is missing",
+    "png chunk structure is corrupt",
+    "pdf is truncated",
+    "pdf startxref offset is invalid",
+    "expected digest mismatch",
+    "expected digest is invalid or unsupported"};
+
 /**
- * Gathers validation errors for contentLength and maxContentLength.
+ * Internal: IngestConfig::cdcAverageChunkSize, with out-of-range values mapped
+ * to one FastCdcChunker rejects.
  */
-void validateLengths(const UploadMeta& meta, int64_t size, int64_t maxContentLength, vector<string>& errors) {
-    if (meta.hasContentLength) {
-        if (meta.contentLength < 0) {
-            errors.emplace_back("contentLength is negative");
-        } else if (size != meta.contentLength) {
-            errors.emplace_back("contentLength mismatch");
+uint32_t cdcAverageSize(const IngestConfig& cfg) {
+    return static_cast<uint32_t>(min<int64_t>(cfg.cdcAverageChunkSize, numeric_limits<uint32_t>::max()));
+}
+
+/**
+ * Shared ingest pipeline: reads the source once, sniffing and hashing each chunk
+ * as it arrives, validates, records telemetry, then hands the result and a
+ * replay of the retained bytes to persist.
+ */
+template <typename PersistFn>
+void runIngest(const UploadMeta& meta, const IngestPolicy& policy, ByteSource& source, PersistFn&& persist) {
+    const IngestConfig& cfg = policy.config();
+    const uint64_t uploadId = tracingEnabled() ? nextTraceUploadId() : 0;
+    TraceScope ingestScope("ingest", uploadId);
+
+    // Single pass: each chunk is sniffed, hashed, matched against the content
+    // patterns and (for ZIP, PNG and PDF) structurally checked while still
+    // cache-hot, then retained so the same bytes can be replayed to the sink.
+    vector<uint8_t> buffer;
+    array<uint8_t, kReadChunkSize> chunk;
+    MimeSniffer sniffer;
+    Sha256 hasher;
+    Xxh3 prefilter;
+    Tlsh fuzzy;
+    ByteHistogram histogram;
+    ByteHistogram headHistogram;
+    Utf8Validator utf8;
+    const size_t entropyWindow = static_cast<size_t>(max<int64_t>(cfg.entropyWindow, 0));
+    // Digests the client supplied are computed whether or not configured.
+    // BLAKE3 is left out of the per-chunk pass: it tree-hashes the retained
+    // buffer afterwards, across threads.
+    DigestSelection selectedDigests = policy.digests();
+    for (const auto& expected : meta.expectedDigests) {
+        DigestAlgorithm algorithm;
+        if (lookupExpectedAlgorithm(expected.algorithm, algorithm) && algorithm != kExpectedSha256) {
+            selectedDigests.add(algorithm);
         }
     }
-    if (maxContentLength >= 0 && size > maxContentLength) {
-        errors.emplace_back("exceeds maxContentLength");
+    DigestSelection streamedDigests = selectedDigests;
+    streamedDigests.remove(DigestAlgorithm::Blake3);
+    MultiDigest digests(streamedDigests);
+    ZipIntegrityVerifier zipVerifier(
+        ZipLimits{cfg.maxZipEntries, cfg.maxZipUncompressedSize, cfg.maxZipCompressionRatio});
+    OoxmlActiveContentScanner ooxmlScanner;
+    zipVerifier.setContentVisitor(&ooxmlScanner);
+    PngVerifier pngVerifier(cfg.maxImagePixels);
+    PdfStructureScanner pdfScanner;
+    PatternScanner contentScanner(policy.contentMatcher());
+    const bool chunking = cfg.cdcAverageChunkSize > 0;
+    FastCdcChunker chunker(chunking ? cdcAverageSize(cfg) : FastCdcChunker::kMinAverageSize);
+    vector<CdcChunk> cdcChunks;
+    PerfCounterGroup* counters = perfSamplingEnabled() ? threadPerfCounters() : nullptr;
+    PerfSample sniffSample;
+    PerfSample hashSample;
+    PerfSample xxh3Sample;
+    PerfSample tlshSample;
+    PerfSample entropySample;
+    PerfSample utf8Sample;
+    PerfSample digestSample;
+    PerfSample zipSample;
+    PerfSample pngSample;
+    PerfSample pdfSample;
+    PerfSample contentSample;
+    int64_t sniffedBytes = 0;
+    int64_t zipBytes = 0;
+    int64_t pngBytes = 0;
+    int64_t pdfBytes = 0;
+    int64_t contentBytes = 0;
+    int64_t utf8Bytes = 0;
+    while (true) {
+        size_t readCount;
+        {
+            TraceScope scope("read", uploadId);
+            readCount = source.read(chunk.data(), chunk.size());
+            scope.setSize(static_cast<int64_t>(readCount));
+        }
+        if (readCount == 0) {
+            break;
+        }
+        if (buffer.size() + readCount > static_cast<size_t>(numeric_limits<int64_t>::max())) {
+            throw runtime_error("payload size exceeds supported range");
+        }
+        if (!sniffer.decided()) {
+            TraceScope scope("sniff", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            sniffer.feed(chunk.data(), readCount);
+            if (counters) accumulate(sniffSample, counters->stop());
+            sniffedBytes += static_cast<int64_t>(readCount);
+        }
+        // Text is validated as UTF-8 end to end, so its charset holds for the
+        // whole upload; validation stops once the sniffer settles on a
+        // non-text type or on UTF-16.
+        if (!utf8.failed() && (!sniffer.decided() || (isTextType(sniffer.decision()) &&
+                                                      sniffer.textEncoding() != TextEncoding::Utf16Le &&
+                                                      sniffer.textEncoding() != TextEncoding::Utf16Be))) {
+            TraceScope scope("utf8", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            utf8.update(chunk.data(), readCount);
+            if (counters) accumulate(utf8Sample, counters->stop());
+            utf8Bytes += static_cast<int64_t>(readCount);
+        }
+        {
+            TraceScope scope("hash", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            hasher.update(chunk.data(), readCount);
+            if (counters) accumulate(hashSample, counters->stop());
+        }
+        {
+            TraceScope scope("xxh3", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            prefilter.update(chunk.data(), readCount);
+            if (counters) accumulate(xxh3Sample, counters->stop());
+        }
+        if (cfg.fuzzyHash) {
+            TraceScope scope("tlsh", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            fuzzy.update(chunk.data(), readCount);
+            if (counters) accumulate(tlshSample, counters->stop());
+        }
+        if (cfg.entropy) {
+            TraceScope scope("entropy", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            histogram.update(chunk.data(), readCount);
+            if (headHistogram.total() < entropyWindow) {
+                headHistogram.update(chunk.data(), min<size_t>(readCount, entropyWindow - headHistogram.total()));
+            }
+            if (counters) accumulate(entropySample, counters->stop());
+        }
+        if (!digests.selection().empty()) {
+            TraceScope scope("digest", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            digests.update(chunk.data(), readCount);
+            if (counters) accumulate(digestSample, counters->stop());
+        }
+        if (zipVerifier.active()) {
+            TraceScope scope("zip_verify", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            zipVerifier.feed(chunk.data(), readCount);
+            if (counters) accumulate(zipSample, counters->stop());
+            zipBytes += static_cast<int64_t>(readCount);
+        }
+        if (pngVerifier.active()) {
+            TraceScope scope("png_verify", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            pngVerifier.feed(chunk.data(), readCount);
+            if (counters) accumulate(pngSample, counters->stop());
+            pngBytes += static_cast<int64_t>(readCount);
+        }
+        if (pdfScanner.active()) {
+            TraceScope scope("pdf_scan", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            pdfScanner.feed(chunk.data(), readCount);
+            if (counters) accumulate(pdfSample, counters->stop());
+            pdfBytes += static_cast<int64_t>(readCount);
+        }
+        if (contentScanner.active()) {
+            TraceScope scope("content_scan", uploadId, static_cast<int64_t>(readCount));
+            if (counters) counters->start();
+            contentScanner.feed(chunk.data(), readCount);
+            if (counters) accumulate(contentSample, counters->stop());
+            contentBytes += static_cast<int64_t>(readCount);
+        }
+        if (chunking) {
+            TraceScope scope("cdc", uploadId, static_cast<int64_t>(readCount));
+            chunker.update(chunk.data(), readCount, cdcChunks);
+        }
+        buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + readCount);
+    }
+    int64_t size = static_cast<int64_t>(buffer.size());
+    ingestScope.setSize(size);
+
+    CompactIngestResult result;
+    result.detectedMime = sniffer.finish();
+    result.charset = textCharset(result.detectedMime, sniffer.textEncoding(), utf8.valid());
+    result.size = size;
+    result.sha256 = hasher.finish();
+    result.xxh3 = prefilter.digest64();
+    result.xxh128 = prefilter.digest128();
+    if (cfg.fuzzyHash) {
+        result.tlsh = fuzzy.finish();
+    }
+    if (cfg.entropy) {
+        // The tail window is counted from the retained buffer once its end is known.
+        ByteHistogram tailHistogram;
+        const size_t tailLength = min(entropyWindow, buffer.size());
+        tailHistogram.update(buffer.data() + buffer.size() - tailLength, tailLength);
+        result.entropy.computed = true;
+        result.entropy.overall = histogram.entropy();
+        result.entropy.head = headHistogram.entropy();
+        result.entropy.tail = tailHistogram.entropy();
+    }
+    result.digests = digests.finish();
+    if (selectedDigests.has(DigestAlgorithm::Blake3)) {
+        TraceScope scope("blake3", uploadId, size);
+        const auto digest = Blake3::hash(buffer.data(), buffer.size(), cfg.hashThreads);
+        result.digests[DigestAlgorithm::Blake3].assign(digest.data(), digest.size());
+    }
+    if (chunking) {
+        chunker.finish(cdcChunks);
+        result.cdcChunks = move(cdcChunks);
+    }
+    if (cfg.manifestChunkSize > 0) {
+        TraceScope scope("manifest", uploadId, size);
+        result.manifest = buildChunkManifest(buffer.data(), buffer.size(),
+                                             static_cast<uint64_t>(cfg.manifestChunkSize), cfg.hashThreads);
+    }
+    zipVerifier.finish();
+    pngVerifier.finish();
+    if (result.detectedMime == MimeType::Pdf) {
+        result.pdf = pdfScanner.finish();
+        result.activeContent = pdfScanner.activeContent();
+    } else if (result.detectedMime == MimeType::Docx || result.detectedMime == MimeType::Xlsx ||
+               result.detectedMime == MimeType::Pptx) {
+        result.activeContent = ooxmlScanner.activeContent();
+    }
+    result.contentHits = contentScanner.hits();
+    if (counters) {
+        metricsRecordKernelSample(MetricsKernel::MimeSniff, sniffedBytes, sniffSample);
+        metricsRecordKernelSample(MetricsKernel::Sha256, size, hashSample);
+        metricsRecordKernelSample(MetricsKernel::Xxh3, size, xxh3Sample);
+        if (cfg.fuzzyHash) {
+            metricsRecordKernelSample(MetricsKernel::Tlsh, size, tlshSample);
+        }
+        if (cfg.entropy) {
+            metricsRecordKernelSample(MetricsKernel::Entropy, size, entropySample);
+        }
+        if (utf8Bytes > 0) {
+            metricsRecordKernelSample(MetricsKernel::Utf8, utf8Bytes, utf8Sample);
+        }
+        if (!digests.selection().empty()) {
+            metricsRecordKernelSample(MetricsKernel::Digests, size, digestSample);
+        }
+        if (isZipContainer(result.detectedMime)) {
+            metricsRecordKernelSample(MetricsKernel::ZipVerify, zipBytes, zipSample);
+        }
+        if (result.detectedMime == MimeType::Png) {
+            metricsRecordKernelSample(MetricsKernel::PngVerify, pngBytes, pngSample);
+        }
+        if (result.detectedMime == MimeType::Pdf) {
+            metricsRecordKernelSample(MetricsKernel::PdfScan, pdfBytes, pdfSample);
+        }
+        if (policy.contentMatcher().size() != 0) {
+            metricsRecordKernelSample(MetricsKernel::ContentScan, contentBytes, contentSample);
+        }
+    }
+    ingestScope.setMime(mimeTypeName(result.detectedMime));
+
+    {
+        TraceScope scope("validate", uploadId, size);
+        validateLengths(meta, size, cfg.maxContentLength, result.errors);
+        validateDigests(meta, result, result.errors);
+        validateMime(meta, result.detectedMime, policy, result.errors);
+        validateZip(result.detectedMime, zipVerifier, result.errors);
+        validatePng(result.detectedMime, pngVerifier, result.errors);
+        validatePdf(result.detectedMime, result.pdf, result.errors);
+        result.ok = result.errors.empty();
+    }
+
+    metricsRecordUpload(result.detectedMime, size);
+    result.errors.forEach([](IngestError error) { metricsRecordValidationError(error); });
+
+    VectorByteSource replay(buffer);
+    TraceScope persistScope("persist", uploadId, size);
+    persistScope.setMime(mimeTypeName(result.detectedMime));
+    // Sinks that fail are timed too, so the histogram count matches the upload count.
+    auto sinkStart = chrono::steady_clock::now();
+    auto recordSinkDuration = [&] {
+        metricsRecordSinkDuration(chrono::duration<double>(chrono::steady_clock::now() - sinkStart).count());
+    };
+    try {
+        persist(result, replay);
+    } catch (...) {
+        recordSinkDuration();
+        throw;
     }
+    recordSinkDuration();
 }
 
 /**
- * Gathers validation errors about allowed MIME and claimed-vs-detected.
+ * Internal: 16 hex digits, most significant first (XXH3's canonical form).
  */
-void validateMime(const UploadMeta& meta, const string& detected,
-                  const vector<string>& accepted, vector<string>& errors) {
-    if (!meta.claimedMime.empty() && !equalsIgnoreParams(meta.claimedMime, detected)) {
-        errors.emplace_back("claimedMime does not match detectedMime");
-    }
-    if (!accepted.empty() && !isAcceptedMime(detected, accepted)) {
-        errors.emplace_back("detectedMime not accepted");
+string hexUint64(uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
     }
+    return hexString(bytes, sizeof(bytes));
 }
 
 } // namespace (internal)
 
+vector<ExpectedDigest> parseDigestHeader(string_view header) {
+    auto trim = [](string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+        return text;
+    };
+    vector<ExpectedDigest> digests;
+    while (!header.empty()) {
+        const size_t comma = header.find(',');
+        const string_view item = trim(header.substr(0, comma));
+        header = comma == string_view::npos ? string_view() : header.substr(comma + 1);
+        const size_t equals = item.find('=');
+        if (equals == string_view::npos) {
+            continue;
+        }
+        const string_view algorithm = trim(item.substr(0, equals));
+        string_view value = trim(item.substr(equals + 1));
+        // RFC 9530 wraps the value as a structured-field byte sequence.
+        if (value.size() >= 2 && value.front() == ':' && value.back() == ':') {
+            value = value.substr(1, value.size() - 2);
+        }
+        DigestAlgorithm known;
+        if (lookupExpectedAlgorithm(algorithm, known)) {
+            digests.push_back(ExpectedDigest{string(algorithm), string(value)});
+        }
+    }
+    return digests;
+}
+
+IngestPolicy::IngestPolicy(const IngestConfig& cfg)
+    : config_(cfg), acceptAll_(cfg.acceptedMimes.empty()), contentMatcher_(cfg.contentPatterns) {
+    for (const auto& entry : cfg.acceptedMimes) {
+        MimeType id;
+        if (!lookupMimeType(entry, id)) {
+            continue;
+        }
+        for (size_t type = 0; type < accepted_.size(); ++type) {
+            if (mimeCovers(id, static_cast<MimeType>(type))) {
+                accepted_.set(type);
+            }
+        }
+    }
+    for (const auto& name : cfg.digests) {
+        DigestAlgorithm algorithm;
+        if (!lookupDigestAlgorithm(name, algorithm)) {
+            throw runtime_error("unknown digest algorithm: " + name);
+        }
+        digests_.add(algorithm);
+    }
+    if (cfg.cdcAverageChunkSize > 0) {
+        FastCdcChunker validated(cdcAverageSize(cfg)); // throws for unsupported sizes
+    }
+}
+
+const char* ingestErrorMessage(IngestError error) {
+    size_t index = static_cast<size_t>(error);
+    return index < kErrorMessages.size() ? kErrorMessages[index] : "unknown error";
+}
+
+IngestResult expandResult(const CompactIngestResult& compact) {
+    IngestResult result;
+    result.detectedMime = mimeTypeName(compact.detectedMime);
+    result.charset = textEncodingName(compact.charset);
+    result.size = compact.size;
+    result.sha256 = compact.sha256.hex();
+    result.xxh3 = hexUint64(compact.xxh3);
+    result.xxh128 = hexUint64(compact.xxh128.high) + hexUint64(compact.xxh128.low);
+    result.tlsh = compact.tlsh.hex();
+    result.entropy = compact.entropy;
+    result.ok = compact.ok;
+    compact.errors.forEach([&](IngestError error) { result.errors.emplace_back(ingestErrorMessage(error)); });
+    result.pdf = compact.pdf;
+    result.activeContent = compact.activeContent;
+    result.manifest = compact.manifest;
+    result.cdcChunks = compact.cdcChunks;
+    for (size_t i = 0; i < compact.digests.values.size(); ++i) {
+        const DigestValue& digest = compact.digests.values[i];
+        if (digest.size != 0) {
+            result.digests.emplace(digestAlgorithmName(static_cast<DigestAlgorithm>(i)), digest.hex());
+        }
+    }
+    return result;
+}
+
+IngestResult expandResult(const CompactIngestResult& compact, const IngestPolicy& policy) {
+    IngestResult result = expandResult(compact);
+    const AhoCorasick& matcher = policy.contentMatcher();
+    for (size_t i = 0; i < matcher.size(); ++i) {
+        if (compact.contentHits & (uint64_t(1) << i)) {
+            result.contentHits.push_back(matcher.pattern(i));
+        }
+    }
+    return result;
+}
+
 // --------------- INGEST API ---------------
 /**
  * Ingests an upload: consumes the source, computes validation and result info, and forwards the same bytes to the sink.
  * All error info is aggregated in result.errors—sink is always called.
  */
 void ingest(const UploadMeta& meta, const IngestConfig& cfg, ByteSource& source, IngestSink& sink) {
-    vector<uint8_t> buffer = consumeToBuffer(source, numeric_limits<size_t>::max());
-
-    if (buffer.size() > static_cast<size_t>(numeric_limits<int64_t>::max())) {
-        throw runtime_error("payload size exceeds supported range");
-    }
-    int64_t size = static_cast<int64_t>(buffer.size());
+    ingest(meta, IngestPolicy(cfg), source, sink);
+}
 
-    IngestResult result;
-    result.detectedMime = detectMime(buffer);
-    result.size = size;
-    result.sha256 = sha256Hex(buffer);
+void ingest(const UploadMeta& meta, const IngestConfig& cfg, ByteSource& source, CompactIngestSink& sink) {
+    ingest(meta, IngestPolicy(cfg), source, sink);
+}
 
-    validateLengths(meta, size, cfg.maxContentLength, result.errors);
-    validateMime(meta, result.detectedMime, cfg.acceptedMimes, result.errors);
-    result.ok = result.errors.empty();
+void ingest(const UploadMeta& meta, const IngestPolicy& policy, ByteSource& source, IngestSink& sink) {
+    runIngest(meta, policy, source, [&](const CompactIngestResult& compact, ByteSource& replay) {
+        sink.persist(meta, expandResult(compact, policy), replay);
+    });
+}
 
-    VectorByteSource replay(buffer);
-    sink.persist(meta, result, replay);
+/**
+ * Compact-result variant of ingest: identical validation and forwarding, without
+ * materializing strings for the digest, MIME type or errors.
+ */
+void ingest(const UploadMeta& meta, const IngestPolicy& policy, ByteSource& source, CompactIngestSink& sink) {
+    runIngest(meta, policy, source, [&](const CompactIngestResult& compact, ByteSource& replay) {
+        sink.persist(meta, compact, replay);
+    });
 }
@@ -1,12 +1,37 @@
 #pragma once
 
+#include "active_content.hpp"
+#include "aho_corasick.hpp"
+#include "byte_histogram.hpp"
 #include "byte_source.hpp"
+#include "chunk_manifest.hpp"
+#include "digest_set.hpp"
+#include "fastcdc.hpp"
+#include "mime.hpp"
+#include "pdf_scan.hpp"
+#include "sha256.hpp"
+#include "tlsh.hpp"
+#include "xxh3.hpp"
 
+#include <bitset>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
+/**
+ * A digest of the upload supplied by the client, checked against the value
+ * computed during ingest.
+ */
+struct ExpectedDigest {
+    // "sha-256", or any name lookupDigestAlgorithm() resolves ("md5", "sha-512", "crc32c", ...)
+    std::string algorithm;
+    // Base64 as sent in Digest and Content-MD5 headers, or hex
+    std::string value;
+};
+
 /**
  * Metadata about an upload request.
  */
@@ -16,14 +41,89 @@ struct UploadMeta {
     // contentLength presence modeled without std::optional for wider compiler support
     bool hasContentLength;
     std::int64_t contentLength;
+    // Checked after the single hashing pass; algorithms not in IngestConfig::digests
+    // are computed for this upload too. A Content-MD5 header is {"md5", value}.
+    std::vector<ExpectedDigest> expectedDigests = {};
 };
 
+/**
+ * Parses a Digest (RFC 3230) or Repr-Digest (RFC 9530) header value, e.g.
+ * "sha-256=X48E9q...=, md5=HUXZ...==" or "sha-256=:X48E9q...=:". Algorithms
+ * ingest cannot compute are skipped, as RFC 3230 asks of recipients.
+ */
+std::vector<ExpectedDigest> parseDigestHeader(std::string_view header);
+
 /**
  * Validation and policy configuration for document ingest.
  */
 struct IngestConfig {
     std::int64_t maxContentLength;
+    // Matched like a claimed MIME type: aliases resolve and text/plain covers CSV, JSON and XML.
     std::vector<std::string> acceptedMimes;
+    // Decompression-bomb limits for ZIP containers, checked against declared
+    // and inflated sizes as the archive streams (see ZipLimits); negative disables.
+    std::int64_t maxZipEntries = 10000;
+    std::int64_t maxZipUncompressedSize = std::int64_t(1) << 30;
+    double maxZipCompressionRatio = 100;
+    // Largest width * height accepted for images whose header declares it; negative disables.
+    std::int64_t maxImagePixels = 100000000;
+    // Byte strings looked for anywhere in the upload, e.g. "/JavaScript" or
+    // "vbaProject.bin"; occurrences are reported, not rejected. At most
+    // AhoCorasick::kMaxPatterns.
+    std::vector<std::string> contentPatterns = {};
+    // Digests computed alongside SHA-256, by name (see lookupDigestAlgorithm),
+    // e.g. {"md5", "crc32c"}.
+    std::vector<std::string> digests = {};
+    // Bytes per chunk of the SHA-256 chunk manifest (see ChunkManifest); 0 or
+    // negative builds none.
+    std::int64_t manifestChunkSize = 0;
+    // Target average size of FastCDC content-defined chunks (see FastCdcChunker),
+    // a power of two from 256 bytes to 16 MiB; 0 or negative disables chunking.
+    std::int64_t cdcAverageChunkSize = 0;
+    // Computes a TLSH fuzzy hash (see Tlsh) for near-duplicate clustering;
+    // slower than SHA-256, so off by default.
+    bool fuzzyHash = false;
+    // Byte histogram and Shannon entropy (see ByteEntropy), overall and over the
+    // first and last entropyWindow bytes.
+    bool entropy = false;
+    std::int64_t entropyWindow = 4096;
+    // Threads BLAKE3 and the chunk manifest may use on uploads over 1 MiB; 0
+    // means one per hardware thread.
+    unsigned hashThreads = 0;
+};
+
+/**
+ * IngestConfig compiled once for repeated use: the MIME allowlist is normalized
+ * into a set of interned ids, so each request's acceptance check is a single
+ * bit test. Allowlist entries naming types the sniffer never produces can never
+ * match and are dropped at compile time. The content patterns are compiled into
+ * a shared automaton and digest names resolved; invalid patterns, unknown
+ * digest names or an unsupported CDC chunk size make the constructor throw.
+ */
+class IngestPolicy {
+public:
+    explicit IngestPolicy(const IngestConfig& cfg);
+
+    const IngestConfig& config() const { return config_; }
+
+    /**
+     * True when the detected type passes the allowlist (an empty allowlist accepts everything).
+     * A text/plain entry also admits CSV, JSON and XML; see mimeCovers().
+     */
+    bool accepts(MimeType detected) const {
+        return acceptAll_ || accepted_.test(static_cast<std::size_t>(detected));
+    }
+
+    const AhoCorasick& contentMatcher() const { return contentMatcher_; }
+
+    DigestSelection digests() const { return digests_; }
+
+private:
+    IngestConfig config_;
+    bool acceptAll_;
+    AhoCorasick contentMatcher_;
+    std::bitset<static_cast<std::size_t>(MimeType::Count)> accepted_;
+    DigestSelection digests_;
 };
 
 /**
@@ -31,12 +131,123 @@ struct IngestConfig {
  */
 struct IngestResult {
     std::string detectedMime;
+    // Charset of text uploads ("utf-8", "utf-16le", "utf-16be"); empty for
+    // other types and for 8-bit text that is not valid UTF-8
+    std::string charset;
     std::int64_t size;
     std::string sha256;
+    // XXH3-64 and XXH3-128 of the upload, big-endian hex: cheap dedup index
+    // keys, to be confirmed against sha256 on a hit
+    std::string xxh3;
+    std::string xxh128;
+    // TLSH when IngestConfig::fuzzyHash is set; empty for uploads under 50
+    // bytes or too uniform to characterize
+    std::string tlsh;
+    ByteEntropy entropy;
     bool ok;
     std::vector<std::string> errors;
+    PdfInfo pdf; // structure of PDF uploads; pdf.scanned is false otherwise
+    ActiveContent activeContent; // set for PDF and OOXML uploads
+    std::vector<std::string> contentHits; // IngestConfig::contentPatterns that occurred, in config order
+    // IngestConfig::digests and those of UploadMeta::expectedDigests, by canonical name, lowercase hex
+    std::map<std::string, std::string> digests;
+    ChunkManifest manifest; // empty unless IngestConfig::manifestChunkSize > 0
+    std::vector<CdcChunk> cdcChunks; // empty unless IngestConfig::cdcAverageChunkSize > 0
 };
 
+/**
+ * Enumerated validation failures. Each has a static message, which is the
+ * string reported in IngestResult::errors.
+ */
+enum class IngestError : std::uint8_t {
+    ContentLengthNegative,
+    ContentLengthMismatch,
+    ExceedsMaxContentLength,
+    ClaimedMimeMismatch,
+    MimeNotAccepted,
+    ZipCrcMismatch,
+    ZipSizeMismatch,
+    ZipCentralDirectoryMismatch,
+    ZipCorrupt,
+    ZipTruncated,
+    ZipTooManyEntries,
+    ZipUncompressedSizeExceeded,
+    ZipCompressionRatioExceeded,
+    PngCrcMismatch,
+    PngInvalidHeader,
+    PngPixelLimitExceeded,
+    PngMissingEnd,
+    PngCorrupt,
+    PdfTruncated,
+    PdfInvalidStartxref,
+    ExpectedDigestMismatch,
+    ExpectedDigestInvalid,
+    Count
+};
+
+/**
+ * The static message for an error code.
+ */
+const char* ingestErrorMessage(IngestError error);
+
+/**
+ * A fixed-size set of IngestError codes. Iteration yields codes in enum order,
+ * which is also the order validation reports them.
+ */
+class IngestErrorSet {
+public:
+    void add(IngestError error) { bits_ |= bit(error); }
+    bool has(IngestError error) const { return (bits_ & bit(error)) != 0; }
+    bool empty() const { return bits_ == 0; }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(IngestError::Count); ++i) {
+            if (bits_ & (std::uint64_t(1) << i)) {
+                fn(static_cast<IngestError>(i));
+            }
+        }
+    }
+
+private:
+    static std::uint64_t bit(IngestError error) { return std::uint64_t(1) << static_cast<unsigned>(error); }
+
+    std::uint64_t bits_ = 0;
+};
+
+static_assert(static_cast<std::size_t>(IngestError::Count) <= 64, "IngestErrorSet holds at most 64 codes");
+
+/**
+ * Allocation-free counterpart of IngestResult: raw digest, interned MIME id and
+ * error codes. Use expandResult() to obtain the string form.
+ */
+struct CompactIngestResult {
+    MimeType detectedMime = MimeType::OctetStream;
+    TextEncoding charset = TextEncoding::None;
+    std::int64_t size = 0;
+    Sha256Digest sha256;
+    std::uint64_t xxh3 = 0;
+    Xxh128Hash xxh128;
+    TlshDigest tlsh; // valid only when IngestConfig::fuzzyHash is set
+    ByteEntropy entropy;
+    bool ok = false;
+    IngestErrorSet errors;
+    PdfInfo pdf;
+    ActiveContent activeContent;
+    std::uint64_t contentHits = 0; // bit i set when IngestConfig::contentPatterns[i] occurred
+    DigestValues digests;          // the IngestPolicy's selected digests and any expected ones
+    ChunkManifest manifest;        // allocates only when a manifest is configured
+    std::vector<CdcChunk> cdcChunks; // likewise, for content-defined chunking
+};
+
+/**
+ * Materializes the string-based IngestResult from a compact result. Content
+ * hits are named from the policy's patterns; the first overload, lacking
+ * them, leaves IngestResult::contentHits empty.
+ */
+IngestResult expandResult(const CompactIngestResult& compact);
+IngestResult expandResult(const CompactIngestResult& compact, const IngestPolicy& policy);
+
 /**
  * Sink API for forwarding uploads downstream (mocked in tests).
  */
@@ -51,6 +262,20 @@ public:
                         ByteSource& data) = 0;
 };
 
+/**
+ * Sink API receiving the compact result; avoids per-upload string allocations.
+ */
+class CompactIngestSink {
+public:
+    virtual ~CompactIngestSink() = default;
+    /**
+     * Persists the validated upload downstream. Implementation consumes the byte stream.
+     */
+    virtual void persist(const UploadMeta& meta,
+                        const CompactIngestResult& result,
+                        ByteSource& data) = 0;
+};
+
 /**
  * Consumes the source, computes validation, and forwards bytes to the sink.
  */
@@ -59,3 +284,25 @@ void ingest(const UploadMeta& meta,
             ByteSource& source,
             IngestSink& sink);
 
+/**
+ * As above, but hands the sink a CompactIngestResult.
+ */
+void ingest(const UploadMeta& meta,
+            const IngestConfig& cfg,
+            ByteSource& source,
+            CompactIngestSink& sink);
+
+/**
+ * Policy-based overloads. Prefer these when serving many requests under the same
+ * configuration: the allowlist is normalized once instead of on every call.
+ */
+void ingest(const UploadMeta& meta,
+            const IngestPolicy& policy,
+            ByteSource& source,
+            IngestSink& sink);
+
+void ingest(const UploadMeta& meta,
+            const IngestPolicy& policy,
+            ByteSource& source,
+            CompactIngestSink& sink);
+
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "mime.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Magic-number signatures and their compile-time dispatch index.
+ *
+ * A signature is a byte pattern anchored at offset 0 with an optional per-byte
+ * mask. buildMagicIndex() sorts a signature table by first byte (stably, so
+ * table order is match priority within a byte) and records where each first
+ * byte's bucket starts. Matching then touches only the bucket for the input's
+ * first byte, so sniff cost stays flat as signatures are added.
+ */
+
+constexpr std::size_t kMaxMagicLength = 16;
+
+struct MagicSignature {
+    std::array<std::uint8_t, kMaxMagicLength> bytes{};
+    std::array<std::uint8_t, kMaxMagicLength> mask{};
+    std::uint8_t length = 0;
+    MimeType type = MimeType::OctetStream;
+};
+
+/**
+ * An exact signature. The literal's terminator is not part of the pattern,
+ * so embedded NULs are allowed: magic("II*\0", MimeType::Tiff).
+ */
+template <std::size_t N>
+constexpr MagicSignature magic(const char (&pattern)[N], MimeType type) {
+    static_assert(N - 1 <= kMaxMagicLength, "magic pattern too long");
+    MagicSignature sig;
+    for (std::size_t i = 0; i + 1 < N; ++i) {
+        sig.bytes[i] = static_cast<std::uint8_t>(pattern[i]);
+        sig.mask[i] = 0xFF;
+    }
+    sig.length = static_cast<std::uint8_t>(N - 1);
+    sig.type = type;
+    return sig;
+}
+
+/**
+ * A signature with wildcards: each '?' in shape matches any byte at that position.
+ */
+template <std::size_t N>
+constexpr MagicSignature magicMasked(const char (&pattern)[N], const char (&shape)[N], MimeType type) {
+    MagicSignature sig = magic(pattern, type);
+    for (std::size_t i = 0; i + 1 < N; ++i) {
+        if (shape[i] == '?') {
+            sig.bytes[i] = 0;
+            sig.mask[i] = 0;
+        }
+    }
+    return sig;
+}
+
+template <std::size_t N>
+struct MagicIndex {
+    std::array<MagicSignature, N> signatures{};
+    // signatures[bucketStart[b] .. bucketStart[b + 1]) all start with byte b.
+    std::array<std::uint16_t, 257> bucketStart{};
+};
+
+template <std::size_t N>
+constexpr MagicIndex<N> buildMagicIndex(const std::array<MagicSignature, N>& table) {
+    static_assert(N < 65536, "too many signatures for a 16-bit bucket index");
+    MagicIndex<N> index;
+    std::array<std::uint16_t, 257> counts{};
+    for (std::size_t i = 0; i < N; ++i) {
+        ++counts[table[i].bytes[0] + 1];
+    }
+    for (std::size_t b = 1; b < 257; ++b) {
+        counts[b] += counts[b - 1];
+    }
+    index.bucketStart = counts;
+    for (std::size_t i = 0; i < N; ++i) {
+        index.signatures[counts[table[i].bytes[0]]++] = table[i];
+    }
+    return index;
+}
+
+enum class MagicStatus {
+    NoMatch, // no signature can match these leading bytes
+    Pending, // the highest-priority live candidate needs more bytes
+    Matched, // a signature matched in full; see MagicResult::type
+};
+
+struct MagicResult {
+    MagicStatus status;
+    MimeType type;
+};
+
+/**
+ * Matches the leading len bytes of the input against the index. Signatures
+ * must start with a concrete byte: a wildcard in position 0 is never dispatched to.
+ */
+template <std::size_t N>
+MagicResult matchMagic(const MagicIndex<N>& index, const std::uint8_t* head, std::size_t len) {
+    if (len == 0) {
+        return {MagicStatus::Pending, MimeType::OctetStream};
+    }
+    const std::size_t end = index.bucketStart[head[0] + 1];
+    for (std::size_t i = index.bucketStart[head[0]]; i < end; ++i) {
+        const MagicSignature& sig = index.signatures[i];
+        const std::size_t n = len < sig.length ? len : sig.length;
+        bool live = true;
+        for (std::size_t j = 1; j < n; ++j) {
+            if ((head[j] & sig.mask[j]) != sig.bytes[j]) {
+                live = false;
+                break;
+            }
+        }
+        if (live) {
+            return {len >= sig.length ? MagicStatus::Matched : MagicStatus::Pending, sig.type};
+        }
+    }
+    return {MagicStatus::NoMatch, MimeType::OctetStream};
+}
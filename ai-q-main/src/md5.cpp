@@ -0,0 +1,130 @@
+#include "md5.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr array<uint32_t, 64> kMd5K = {
+    0xd76aa478UL, 0xe8c7b756UL, 0x242070dbUL, 0xc1bdceeeUL, 0xf57c0fafUL, 0x4787c62aUL, 0xa8304613UL, 0xfd469501UL,
+    0x698098d8UL, 0x8b44f7afUL, 0xffff5bb1UL, 0x895cd7beUL, 0x6b901122UL, 0xfd987193UL, 0xa679438eUL, 0x49b40821UL,
+    0xf61e2562UL, 0xc040b340UL, 0x265e5a51UL, 0xe9b6c7aaUL, 0xd62f105dUL, 0x02441453UL, 0xd8a1e681UL, 0xe7d3fbc8UL,
+    0x21e1cde6UL, 0xc33707d6UL, 0xf4d50d87UL, 0x455a14edUL, 0xa9e3e905UL, 0xfcefa3f8UL, 0x676f02d9UL, 0x8d2a4c8aUL,
+    0xfffa3942UL, 0x8771f681UL, 0x6d9d6122UL, 0xfde5380cUL, 0xa4beea44UL, 0x4bdecfa9UL, 0xf6bb4b60UL, 0xbebfbc70UL,
+    0x289b7ec6UL, 0xeaa127faUL, 0xd4ef3085UL, 0x04881d05UL, 0xd9d4d039UL, 0xe6db99e5UL, 0x1fa27cf8UL, 0xc4ac5665UL,
+    0xf4292244UL, 0x432aff97UL, 0xab9423a7UL, 0xfc93a039UL, 0x655b59c3UL, 0x8f0ccc92UL, 0xffeff47dUL, 0x85845dd1UL,
+    0x6fa87e4fUL, 0xfe2ce6e0UL, 0xa3014314UL, 0x4e0811a1UL, 0xf7537e82UL, 0xbd3af235UL, 0x2ad7d2bbUL, 0xeb86d391UL};
+
+constexpr array<uint32_t, 64> kMd5Shift = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                                           5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+                                           4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                                           6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+inline uint32_t rotl(uint32_t value, uint32_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * Internal: Updates MD5 state with a message block (little-endian words).
+ */
+void md5ProcessBlock(array<uint32_t, 4>& state, const uint8_t* block) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = (static_cast<uint32_t>(block[i * 4])) | (static_cast<uint32_t>(block[i * 4 + 1]) << 8) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 16) | (static_cast<uint32_t>(block[i * 4 + 3]) << 24);
+    }
+
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+
+    // One loop per round function keeps the rounds branch-free.
+    auto round = [&](int i, uint32_t f, int g) {
+        const uint32_t rotated = rotl(a + f + kMd5K[i] + m[g], kMd5Shift[i]);
+        a = d;
+        d = c;
+        c = b;
+        b += rotated;
+    };
+    for (int i = 0; i < 16; ++i) {
+        round(i, (b & c) | (~b & d), i);
+    }
+    for (int i = 16; i < 32; ++i) {
+        round(i, (d & b) | (~d & c), (5 * i + 1) & 15);
+    }
+    for (int i = 32; i < 48; ++i) {
+        round(i, b ^ c ^ d, (3 * i + 5) & 15);
+    }
+    for (int i = 48; i < 64; ++i) {
+        round(i, c ^ (b | ~d), (7 * i) & 15);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+} // namespace (internal)
+
+Md5::Md5() : state_{0x67452301UL, 0xefcdab89UL, 0x98badcfeUL, 0x10325476UL}, pending_{}, pendingLen_(0), totalLen_(0) {}
+
+void Md5::update(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    totalLen_ += len;
+    if (pendingLen_ > 0) {
+        size_t take = min(len, sizeof(pending_) - pendingLen_);
+        memcpy(pending_ + pendingLen_, data, take);
+        pendingLen_ += take;
+        data += take;
+        len -= take;
+        if (pendingLen_ < sizeof(pending_)) {
+            return;
+        }
+        md5ProcessBlock(state_, pending_);
+        pendingLen_ = 0;
+    }
+    while (len >= 64) {
+        md5ProcessBlock(state_, data);
+        data += 64;
+        len -= 64;
+    }
+    if (len > 0) {
+        memcpy(pending_, data, len);
+        pendingLen_ = len;
+    }
+}
+
+array<uint8_t, 16> Md5::finish() {
+    uint64_t bitLength = totalLen_ * 8;
+    uint8_t finalBlock[128] = {0};
+    memcpy(finalBlock, pending_, pendingLen_);
+    finalBlock[pendingLen_] = 0x80;
+
+    // The length goes last, little-endian.
+    size_t paddingIndex = ((pendingLen_ + 9) <= 64) ? 64 - 8 : 128 - 8;
+    for (size_t i = 0; i < 8; ++i) {
+        finalBlock[paddingIndex + i] = static_cast<uint8_t>((bitLength >> (i * 8)) & 0xFF);
+    }
+
+    md5ProcessBlock(state_, finalBlock);
+    if (paddingIndex != 64 - 8) {
+        md5ProcessBlock(state_, finalBlock + 64);
+    }
+
+    array<uint8_t, 16> digest;
+    for (size_t i = 0; i < 4; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state_[i]);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i] >> 24);
+    }
+    return digest;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Incremental MD5 (RFC 1321). Kept for systems that still key content by it;
+ * it is not collision resistant and must not be used for integrity decisions.
+ * Feed bytes with update(), then call finish() once.
+ */
+class Md5 {
+public:
+    Md5();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Applies the final padding and returns the 16-byte digest.
+     */
+    std::array<std::uint8_t, 16> finish();
+
+private:
+    std::array<std::uint32_t, 4> state_;
+    std::uint8_t pending_[64];
+    std::size_t pendingLen_;
+    std::uint64_t totalLen_;
+};
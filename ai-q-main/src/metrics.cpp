@@ -0,0 +1,348 @@
+#include "metrics.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Label sets are the interned MIME ids and error codes, so every counter lives in a fixed slot.
+constexpr size_t kMimeSlots = static_cast<size_t>(MimeType::Count);
+constexpr size_t kErrorSlots = static_cast<size_t>(IngestError::Count);
+
+// Upper bounds in seconds; the implicit +Inf bucket follows.
+constexpr array<double, 10> kSinkBuckets = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.5, 1.0};
+
+constexpr size_t kKernelSlots = static_cast<size_t>(MetricsKernel::Count);
+
+constexpr array<const char*, kKernelSlots> kKernelLabels = {
+    "sha256", "mime_sniff", "zip_verify", "png_verify", "pdf_scan", "content_scan",
+    "digests", "xxh3", "tlsh", "entropy", "utf8"};
+static_assert(kKernelLabels.size() == static_cast<size_t>(MetricsKernel::Count), "one label per MetricsKernel");
+static_assert(kKernelLabels.back() != nullptr, "a MetricsKernel is missing its label");
+
+constexpr size_t kShardCount = 32;
+
+/**
+ * Accumulated hardware counters for one kernel.
+ */
+struct KernelCounters {
+    atomic<uint64_t> samples{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> cycles{0};
+    atomic<uint64_t> instructions{0};
+    atomic<uint64_t> cacheMisses{0};
+    atomic<uint64_t> branchMisses{0};
+};
+
+/**
+ * One shard of every counter, padded to its own cache lines.
+ */
+struct alignas(64) MetricShard {
+    atomic<uint64_t> bytes{0};
+    array<atomic<uint64_t>, kMimeSlots> uploads{};
+    array<atomic<uint64_t>, kErrorSlots> errors{};
+    array<atomic<uint64_t>, kSinkBuckets.size() + 1> sinkBuckets{};
+    atomic<uint64_t> sinkNanos{0};
+    array<KernelCounters, kKernelSlots> kernels{};
+};
+
+array<MetricShard, kShardCount> gShards;
+
+/**
+ * Picks the shard for the calling thread: the current CPU where the OS exposes
+ * it, otherwise a per-thread slot assigned round-robin.
+ */
+MetricShard& localShard() {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return gShards[static_cast<size_t>(cpu) % kShardCount];
+    }
+#endif
+    static atomic<size_t> nextSlot{0};
+    thread_local size_t slot = nextSlot.fetch_add(1, memory_order_relaxed) % kShardCount;
+    return gShards[slot];
+}
+
+inline void bump(atomic<uint64_t>& counter, uint64_t delta = 1) {
+    counter.fetch_add(delta, memory_order_relaxed);
+}
+
+inline uint64_t load(const atomic<uint64_t>& counter) {
+    return counter.load(memory_order_relaxed);
+}
+
+} // namespace (internal)
+
+void metricsRecordUpload(MimeType detectedMime, int64_t bytes) {
+    size_t slot = static_cast<size_t>(detectedMime);
+    if (slot >= kMimeSlots) {
+        return;
+    }
+    MetricShard& shard = localShard();
+    bump(shard.uploads[slot]);
+    if (bytes > 0) {
+        bump(shard.bytes, static_cast<uint64_t>(bytes));
+    }
+}
+
+void metricsRecordValidationError(IngestError error) {
+    size_t slot = static_cast<size_t>(error);
+    if (slot < kErrorSlots) {
+        bump(localShard().errors[slot]);
+    }
+}
+
+void metricsRecordSinkDuration(double seconds) {
+    if (seconds < 0) {
+        seconds = 0;
+    }
+    size_t bucket = 0;
+    while (bucket < kSinkBuckets.size() && seconds > kSinkBuckets[bucket]) {
+        ++bucket;
+    }
+    MetricShard& shard = localShard();
+    bump(shard.sinkBuckets[bucket]);
+    bump(shard.sinkNanos, static_cast<uint64_t>(seconds * 1e9));
+}
+
+void metricsRecordKernelSample(MetricsKernel kernel, int64_t bytes, const PerfSample& sample) {
+    const size_t index = static_cast<size_t>(kernel);
+    if (!sample.valid || index >= kKernelSlots) {
+        return;
+    }
+    KernelCounters& counters = localShard().kernels[index];
+    bump(counters.samples);
+    bump(counters.bytes, bytes > 0 ? static_cast<uint64_t>(bytes) : 0);
+    bump(counters.cycles, sample.cycles);
+    bump(counters.instructions, sample.instructions);
+    bump(counters.cacheMisses, sample.cacheMisses);
+    bump(counters.branchMisses, sample.branchMisses);
+}
+
+string metricsSnapshot() {
+    uint64_t bytes = 0;
+    array<uint64_t, kMimeSlots> uploads{};
+    array<uint64_t, kErrorSlots> errors{};
+    array<uint64_t, kSinkBuckets.size() + 1> sinkBuckets{};
+    uint64_t sinkNanos = 0;
+    struct KernelTotals {
+        uint64_t samples, bytes, cycles, instructions, cacheMisses, branchMisses;
+    };
+    array<KernelTotals, kKernelSlots> kernels{};
+    for (const auto& shard : gShards) {
+        bytes += load(shard.bytes);
+        for (size_t i = 0; i < uploads.size(); ++i) uploads[i] += load(shard.uploads[i]);
+        for (size_t i = 0; i < errors.size(); ++i) errors[i] += load(shard.errors[i]);
+        for (size_t i = 0; i < sinkBuckets.size(); ++i) sinkBuckets[i] += load(shard.sinkBuckets[i]);
+        sinkNanos += load(shard.sinkNanos);
+        for (size_t i = 0; i < kernels.size(); ++i) {
+            const KernelCounters& k = shard.kernels[i];
+            kernels[i].samples += load(k.samples);
+            kernels[i].bytes += load(k.bytes);
+            kernels[i].cycles += load(k.cycles);
+            kernels[i].instructions += load(k.instructions);
+            kernels[i].cacheMisses += load(k.cacheMisses);
+            kernels[i].branchMisses += load(k.branchMisses);
+        }
+    }
+
+    ostringstream out;
+    out << "# HELP ingest_bytes_total Bytes consumed by ingest.\n"
+        << "# TYPE ingest_bytes_total counter\n"
+        << "ingest_bytes_total " << bytes << "\n";
+
+    out << "# HELP ingest_uploads_total Completed uploads by detected MIME type.\n"
+        << "# TYPE ingest_uploads_total counter\n";
+    for (size_t i = 0; i < uploads.size(); ++i) {
+        out << "ingest_uploads_total{mime=\"" << mimeTypeName(static_cast<MimeType>(i)) << "\"} " << uploads[i] << "\n";
+    }
+
+    out << "# HELP ingest_validation_errors_total Validation errors by message.\n"
+        << "# TYPE ingest_validation_errors_total counter\n";
+    for (size_t i = 0; i < errors.size(); ++i) {
+        out << "ingest_validation_errors_total{error=\"" << ingestErrorMessage(static_cast<IngestError>(i)) << "\"} " << errors[i] << "\n";
+    }
+
+    out << "# HELP ingest_sink_duration_seconds Time spent in IngestSink::persist.\n"
+        << "# TYPE ingest_sink_duration_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kSinkBuckets.size(); ++i) {
+        cumulative += sinkBuckets[i];
+        out << "ingest_sink_duration_seconds_bucket{le=\"" << kSinkBuckets[i] << "\"} " << cumulative << "\n";
+    }
+    cumulative += sinkBuckets.back();
+    out << "ingest_sink_duration_seconds_bucket{le=\"+Inf\"} " << cumulative << "\n"
+        // Printed from the integer nanoseconds, so the sum keeps its resolution
+        // however long the process runs.
+        << "ingest_sink_duration_seconds_sum " << sinkNanos / 1000000000 << '.' << setw(9) << setfill('0')
+        << sinkNanos % 1000000000 << setfill(' ') << "\n"
+        << "ingest_sink_duration_seconds_count " << cumulative << "\n";
+
+    // Hardware counter families only appear once sampling has produced data.
+    bool anyKernel = false;
+    for (const auto& k : kernels) anyKernel = anyKernel || k.samples > 0;
+    if (anyKernel) {
+        auto family = [&](const char* name, const char* help, uint64_t KernelTotals::*field) {
+            out << "# HELP " << name << " " << help << "\n"
+                << "# TYPE " << name << " counter\n";
+            for (size_t i = 0; i < kernels.size(); ++i) {
+                out << name << "{kernel=\"" << kKernelLabels[i] << "\"} " << kernels[i].*field << "\n";
+            }
+        };
+        family("ingest_kernel_samples_total", "Perf-counter samples taken per kernel.", &KernelTotals::samples);
+        family("ingest_kernel_bytes_total", "Bytes processed by sampled kernel runs.", &KernelTotals::bytes);
+        family("ingest_kernel_cycles_total", "CPU cycles spent in sampled kernel runs.", &KernelTotals::cycles);
+        family("ingest_kernel_instructions_total", "Instructions retired in sampled kernel runs.", &KernelTotals::instructions);
+        family("ingest_kernel_cache_misses_total", "Cache misses in sampled kernel runs.", &KernelTotals::cacheMisses);
+        family("ingest_kernel_branch_misses_total", "Branch misses in sampled kernel runs.", &KernelTotals::branchMisses);
+
+        out << "# HELP ingest_kernel_cycles_per_byte Mean cycles per byte over all sampled runs.\n"
+            << "# TYPE ingest_kernel_cycles_per_byte gauge\n"
+            << setprecision(17);
+        for (size_t i = 0; i < kernels.size(); ++i) {
+            double cpb = kernels[i].bytes > 0 ? static_cast<double>(kernels[i].cycles) / kernels[i].bytes : 0.0;
+            out << "ingest_kernel_cycles_per_byte{kernel=\"" << kKernelLabels[i] << "\"} " << cpb << "\n";
+        }
+    }
+    return out.str();
+}
+
+void metricsReset() {
+    for (auto& shard : gShards) {
+        shard.bytes.store(0, memory_order_relaxed);
+        for (auto& c : shard.uploads) c.store(0, memory_order_relaxed);
+        for (auto& c : shard.errors) c.store(0, memory_order_relaxed);
+        for (auto& c : shard.sinkBuckets) c.store(0, memory_order_relaxed);
+        shard.sinkNanos.store(0, memory_order_relaxed);
+        for (auto& k : shard.kernels) {
+            for (auto* c : {&k.samples, &k.bytes, &k.cycles, &k.instructions, &k.cacheMisses, &k.branchMisses}) {
+                c->store(0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+// --------------- HTTP listener ---------------
+
+MetricsHttpListener::~MetricsHttpListener() {
+    stop();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+} // namespace (internal)
+
+void MetricsHttpListener::start(uint16_t port) {
+    if (running_.load()) {
+        throw runtime_error("metrics listener already started");
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw runtime_error("metrics listener: socket() failed");
+    }
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0) {
+        ::close(fd);
+        throw runtime_error("metrics listener: bind/listen failed");
+    }
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        ::close(fd);
+        throw runtime_error("metrics listener: getsockname() failed");
+    }
+
+    listenFd_ = fd;
+    port_ = ntohs(addr.sin_port);
+    running_.store(true);
+    worker_ = thread([this] { serve(); });
+}
+
+void MetricsHttpListener::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    ::close(listenFd_);
+    listenFd_ = -1;
+}
+
+void MetricsHttpListener::serve() {
+    while (running_.load()) {
+        pollfd pfd{listenFd_, POLLIN, 0};
+        // Short timeout so stop() is honoured promptly without cross-thread close().
+        if (::poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        int client = ::accept(listenFd_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        // The request itself is irrelevant; drain what has arrived so the peer sees a clean close.
+        char request[1024];
+        pollfd cpfd{client, POLLIN, 0};
+        if (::poll(&cpfd, 1, 100) > 0) {
+            (void)::recv(client, request, sizeof(request), 0);
+        }
+
+        string body = metricsSnapshot();
+        string response = "HTTP/1.0 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: " + to_string(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = ::send(client, response.data() + sent, response.size() - sent, kSendFlags);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        ::close(client);
+    }
+}
+
+#else
+
+void MetricsHttpListener::start(uint16_t) {
+    throw runtime_error("metrics listener is not supported on this platform");
+}
+
+void MetricsHttpListener::stop() {}
+
+void MetricsHttpListener::serve() {}
+
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ingest.hpp"
+#include "mime.hpp"
+#include "perf_counters.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * Process-wide ingest telemetry. Counters are sharded per core so concurrent
+ * ingest calls never contend on a shared cache line; shards are only summed
+ * when a snapshot is taken.
+ */
+
+/**
+ * Records one completed upload: bumps the per-MIME upload counter and the byte total.
+ */
+void metricsRecordUpload(MimeType detectedMime, std::int64_t bytes);
+
+/**
+ * Records one validation error; it is exported labelled with ingestErrorMessage().
+ */
+void metricsRecordValidationError(IngestError error);
+
+/**
+ * Records the wall time spent inside IngestSink::persist.
+ */
+void metricsRecordSinkDuration(double seconds);
+
+/**
+ * Kernels whose hardware counters can be sampled during ingest.
+ */
+enum class MetricsKernel {
+    Sha256,
+    MimeSniff,
+    ZipVerify,
+    PngVerify,
+    PdfScan,
+    ContentScan,
+    Digests,
+    Xxh3,
+    Tlsh,
+    Entropy,
+    Utf8,
+    Count
+};
+
+/**
+ * Accumulates one perf-counter sample for a kernel that processed the given
+ * number of bytes. Invalid samples are ignored.
+ */
+void metricsRecordKernelSample(MetricsKernel kernel, std::int64_t bytes, const PerfSample& sample);
+
+/**
+ * Renders all ingest metrics in the Prometheus text exposition format (version 0.0.4).
+ */
+std::string metricsSnapshot();
+
+/**
+ * Zeroes every counter. Intended for tests.
+ */
+void metricsReset();
+
+/**
+ * Minimal HTTP/1.0 listener serving metricsSnapshot() on the loopback interface.
+ * Every request, whatever its path, receives the current snapshot.
+ */
+class MetricsHttpListener {
+public:
+    MetricsHttpListener() = default;
+    ~MetricsHttpListener();
+
+    MetricsHttpListener(const MetricsHttpListener&) = delete;
+    MetricsHttpListener& operator=(const MetricsHttpListener&) = delete;
+
+    /**
+     * Binds 127.0.0.1:port (0 picks an ephemeral port) and starts serving on a
+     * background thread. Throws on socket errors or if already started.
+     */
+    void start(std::uint16_t port);
+
+    /**
+     * Stops serving and joins the background thread. Safe to call repeatedly.
+     */
+    void stop();
+
+    /**
+     * The bound port, valid after start().
+     */
+    std::uint16_t port() const { return port_; }
+
+private:
+    void serve();
+
+    int listenFd_ = -1;
+    std::uint16_t port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+};
@@ -0,0 +1,680 @@
+#include "mime.hpp"
+
+#include "magic.hpp"
+#include "simd_search.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr array<const char*, static_cast<size_t>(MimeType::Count)> kMimeNames = {
+    "application/octet-stream",
+    "application/pdf",
+    "application/vnd.openxmlformats-officedocument.wordprocessingml.document",
+    "image/png",
+    "image/jpeg",
+    "image/gif",
+    "image/tiff",
+    "image/webp",
+    "image/heic",
+    "video/mp4",
+    "application/rtf",
+    "application/zip",
+    "application/x-7z-compressed",
+    "application/gzip",
+    "text/plain",
+    "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet",
+    "application/vnd.openxmlformats-officedocument.presentationml.presentation",
+    "application/vnd.oasis.opendocument.text",
+    "application/epub+zip",
+    "application/java-archive",
+    "text/csv",
+    "application/json",
+    "application/xml"};
+
+// Other names clients send for a type, accepted wherever a MIME string is looked up.
+constexpr pair<const char*, MimeType> kMimeAliases[] = {
+    {"text/xml", MimeType::Xml},
+};
+
+constexpr array<const char*, static_cast<size_t>(TextEncoding::Count)> kTextEncodingNames = {
+    "", "utf-8", "utf-16le", "utf-16be"};
+
+} // namespace (internal)
+
+bool isZipContainer(MimeType type) {
+    switch (type) {
+    case MimeType::Zip:
+    case MimeType::Docx:
+    case MimeType::Xlsx:
+    case MimeType::Pptx:
+    case MimeType::Odt:
+    case MimeType::Epub:
+    case MimeType::Jar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isTextType(MimeType type) {
+    switch (type) {
+    case MimeType::PlainText:
+    case MimeType::Csv:
+    case MimeType::Json:
+    case MimeType::Xml:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char* mimeTypeName(MimeType type) {
+    size_t index = static_cast<size_t>(type);
+    return index < kMimeNames.size() ? kMimeNames[index] : kMimeNames[0];
+}
+
+const char* textEncodingName(TextEncoding encoding) {
+    size_t index = static_cast<size_t>(encoding);
+    return index < kTextEncodingNames.size() ? kTextEncodingNames[index] : kTextEncodingNames[0];
+}
+
+TextEncoding textCharset(MimeType type, TextEncoding sniffed, bool validUtf8) {
+    if (!isTextType(type)) {
+        return TextEncoding::None;
+    }
+    if (sniffed == TextEncoding::Utf16Le || sniffed == TextEncoding::Utf16Be) {
+        return sniffed;
+    }
+    return validUtf8 ? TextEncoding::Utf8 : TextEncoding::None;
+}
+
+string_view mimeEssence(string_view mime) {
+    mime = mime.substr(0, mime.find(';'));
+    auto isSpace = [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\f' || ch == '\v'; };
+    while (!mime.empty() && isSpace(mime.front())) mime.remove_prefix(1);
+    while (!mime.empty() && isSpace(mime.back())) mime.remove_suffix(1);
+    return mime;
+}
+
+bool mimeEqualsIgnoreCase(string_view lhs, string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    auto lower = [](char ch) { return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch | 0x20) : ch; };
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (lower(lhs[i]) != lower(rhs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lookupMimeType(string_view mime, MimeType& out) {
+    string_view essence = mimeEssence(mime);
+    for (size_t i = 0; i < kMimeNames.size(); ++i) {
+        if (mimeEqualsIgnoreCase(essence, kMimeNames[i])) {
+            out = static_cast<MimeType>(i);
+            return true;
+        }
+    }
+    for (const auto& [alias, type] : kMimeAliases) {
+        if (mimeEqualsIgnoreCase(essence, alias)) {
+            out = type;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mimeCovers(MimeType declared, MimeType detected) {
+    return declared == detected || (declared == MimeType::PlainText && isTextType(detected));
+}
+
+// ------------ Streaming sniffer ----------
+
+namespace {
+
+// Offsets within an ISO BMFF ftyp box: the major brand, and the compatible brands after the minor version.
+constexpr size_t kFtypMajorBrand = 8;
+constexpr size_t kFtypCompatibleBrands = 16;
+// Compatible brands looked at before giving up on a generic HEIF file.
+constexpr size_t kMaxFtypBox = kFtypCompatibleBrands + 4 * 32;
+
+/**
+ * Internal: whether an ftyp major brand is a generic HEIF one, which needs
+ * its compatible brands to say whether the image is HEIC.
+ */
+bool isGenericHeifBrand(const uint8_t* brand) {
+    return memcmp(brand, "mif1", 4) == 0 || memcmp(brand, "msf1", 4) == 0;
+}
+
+static_assert(kFtypCompatibleBrands >= kMaxMagicLength, "the sniffer head must not reach the compatible brands");
+
+// Order matters only among signatures sharing a first byte: earlier entries win.
+constexpr array<MagicSignature, 30> kMagicTable = {
+    magic("%PDF", MimeType::Pdf),
+    magic("\x89PNG\r\n\x1a\n", MimeType::Png),
+    magic("PK\x03\x04", MimeType::Zip),
+    magic("PK\x05\x06", MimeType::Zip), // empty archive
+    magic("\xFF\xD8\xFF", MimeType::Jpeg),
+    magic("GIF87a", MimeType::Gif),
+    magic("GIF89a", MimeType::Gif),
+    magic("II*\0", MimeType::Tiff),
+    magic("MM\0*", MimeType::Tiff),
+    magicMasked("RIFF\0\0\0\0WEBP", "xxxx????xxxx", MimeType::Webp),
+    // ISO BMFF: a 32-bit box size (high byte 0 in practice) then "ftyp" and the
+    // major brand. Only brands naming the format are listed; QuickTime, M4A,
+    // 3GP, AVIF and the rest stay octet-stream.
+    magicMasked("\0\0\0\0ftypheic", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftypheix", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftyphevc", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftyphevx", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftypheim", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftypheis", "x???xxxxxxxx", MimeType::Heic),
+    // Generic HEIF image and sequence brands: HEIC only if a compatible brand
+    // says so (see MimeSniffer::scanFtypBrands).
+    magicMasked("\0\0\0\0ftypmif1", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftypmsf1", "x???xxxxxxxx", MimeType::Heic),
+    magicMasked("\0\0\0\0ftypisom", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypiso2", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypiso4", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypiso5", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypiso6", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypmp41", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypmp42", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypavc1", "x???xxxxxxxx", MimeType::Mp4),
+    magicMasked("\0\0\0\0ftypdash", "x???xxxxxxxx", MimeType::Mp4),
+    magic("{\\rtf", MimeType::Rtf),
+    magic("7z\xBC\xAF\x27\x1C", MimeType::SevenZip),
+    magic("\x1F\x8B\x08", MimeType::Gzip),
+};
+
+constexpr MagicIndex<kMagicTable.size()> kMagicIndex = buildMagicIndex(kMagicTable);
+
+/**
+ * One searcher for all ZIP container markers, in MimeSniffer::ZipMarker order.
+ */
+const MultiNeedleSearch& zipMarkerSearch() {
+    static const MultiNeedleSearch search{"word/", "xl/", "ppt/", "[Content_Types].xml", "mimetype"};
+    return search;
+}
+
+constexpr uint32_t kPartDirectoryMarkers = (1u << static_cast<unsigned>(MimeSniffer::ZipMarker::Word)) |
+                                           (1u << static_cast<unsigned>(MimeSniffer::ZipMarker::Excel)) |
+                                           (1u << static_cast<unsigned>(MimeSniffer::ZipMarker::PowerPoint));
+
+/**
+ * Verdict from container markers alone, for archives the header walk cannot
+ * classify: a part directory names the OOXML package, and a content-types
+ * part without one is taken as DOCX.
+ */
+MimeType zipMarkerVerdict(uint32_t markers) {
+    using Marker = MimeSniffer::ZipMarker;
+    if (MimeSniffer::hasZipMarker(markers, Marker::Word)) return MimeType::Docx;
+    if (MimeSniffer::hasZipMarker(markers, Marker::Excel)) return MimeType::Xlsx;
+    if (MimeSniffer::hasZipMarker(markers, Marker::PowerPoint)) return MimeType::Pptx;
+    if (MimeSniffer::hasZipMarker(markers, Marker::ContentTypes)) return MimeType::Docx;
+    return MimeType::Zip;
+}
+
+constexpr string_view kOdtMimetype = "application/vnd.oasis.opendocument.text";
+constexpr string_view kEpubMimetype = "application/epub+zip";
+
+inline bool startsWith(string_view text, string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+/**
+ * Bytes that never occur in text (WHATWG MIME sniffing "binary data byte").
+ */
+inline bool isBinaryByte(uint8_t byte) {
+    return byte <= 0x08 || byte == 0x0B || (byte >= 0x0E && byte <= 0x1A) || (byte >= 0x1C && byte <= 0x1F);
+}
+
+inline bool isJsonSpace(uint8_t byte) {
+    return byte == ' ' || byte == '\t' || byte == '\r' || byte == '\n';
+}
+
+/**
+ * Internal: whether text opening with '{' or '[' lexes as JSON: only JSON
+ * tokens, with brackets balanced. A window cut short may end mid-token or
+ * with brackets open; complete input must close them all.
+ */
+bool looksLikeJson(const uint8_t* text, size_t len, bool complete) {
+    constexpr size_t kMaxDepth = 64;
+    char open[kMaxDepth];
+    size_t depth = 0;
+    size_t i = 0;
+    while (i < len) {
+        const uint8_t c = text[i];
+        if (isJsonSpace(c) || c == ':' || c == ',') {
+            ++i;
+        } else if (c == '{' || c == '[') {
+            if (depth == kMaxDepth) {
+                return !complete; // deeper than we track; the window proves nothing more
+            }
+            open[depth++] = static_cast<char>(c);
+            ++i;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || open[depth - 1] != (c == '}' ? '{' : '[')) {
+                return false;
+            }
+            --depth;
+            ++i;
+            if (depth == 0) {
+                // Only whitespace may follow the top-level value.
+                for (; i < len; ++i) {
+                    if (!isJsonSpace(text[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        } else if (c == '"') {
+            for (++i; i < len && text[i] != '"'; ++i) {
+                if (text[i] == '\\') {
+                    ++i;
+                } else if (text[i] < 0x20) {
+                    return false;
+                }
+            }
+            if (i >= len) {
+                return !complete;
+            }
+            ++i;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            for (++i; i < len; ++i) {
+                const uint8_t d = text[i];
+                if (!((d >= '0' && d <= '9') || d == '.' || d == 'e' || d == 'E' || d == '+' || d == '-')) {
+                    break;
+                }
+            }
+        } else {
+            bool literal = false;
+            for (string_view word : {"true", "false", "null"}) {
+                const size_t n = min(word.size(), len - i);
+                if (memcmp(text + i, word.data(), n) == 0 && (n == word.size() || !complete)) {
+                    i += n;
+                    literal = true;
+                    break;
+                }
+            }
+            if (!literal) {
+                return false;
+            }
+        }
+    }
+    return depth == 0 || !complete;
+}
+
+/**
+ * Internal: whether text reads as delimiter-separated records, each with the
+ * same non-zero number of commas (or of semicolons) outside double quotes:
+ * at least three records, or two with at least two delimiters each, since
+ * two lines of prose easily share a single comma. A record cut off by the
+ * window is not counted.
+ */
+bool looksLikeCsv(const uint8_t* text, size_t len, bool complete) {
+    for (uint8_t delimiter : {uint8_t(','), uint8_t(';')}) {
+        size_t records = 0;
+        size_t fields = 0;
+        size_t expected = 0;
+        size_t recordLen = 0;
+        bool quoted = false;
+        bool consistent = true;
+        for (size_t i = 0; i <= len && consistent; ++i) {
+            const bool end = i == len;
+            if (end && (!complete || quoted)) {
+                break;
+            }
+            const uint8_t c = end ? '\n' : text[i];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (!quoted && c == delimiter) {
+                ++fields;
+            } else if (!quoted && c == '\n') {
+                if (recordLen > 0) {
+                    if (records == 0) {
+                        expected = fields;
+                    }
+                    consistent = fields != 0 && fields == expected;
+                    ++records;
+                }
+                fields = 0;
+                recordLen = 0;
+                continue;
+            }
+            if (c != '\r') {
+                ++recordLen;
+            }
+        }
+        if (consistent && (records >= 3 || (records == 2 && expected >= 2))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace (internal)
+
+/**
+ * Classifies a ZIP package from the entries the walker reports. The first
+ * conclusive entry decides: an OOXML part directory, a JAR manifest, or the
+ * stored "mimetype" entry that opens every ODF and EPUB package.
+ */
+class MimeSniffer::ZipClassifier : public ZipEntryVisitor {
+public:
+    explicit ZipClassifier(MimeSniffer& sniffer) : sniffer_(sniffer) {}
+
+    void onEntry(const ZipEntry& entry) override {
+        if (sniffer_.decided() || entry.nameTruncated) {
+            return;
+        }
+        const string_view name = entry.name;
+        if (name == "mimetype") {
+            sniffer_.inZipMimetype_ = entry.method == 0;
+            sniffer_.zipMimetypeLen_ = 0;
+        } else if (startsWith(name, "word/")) {
+            sniffer_.decide(MimeType::Docx);
+        } else if (startsWith(name, "xl/")) {
+            sniffer_.decide(MimeType::Xlsx);
+        } else if (startsWith(name, "ppt/")) {
+            sniffer_.decide(MimeType::Pptx);
+        } else if (name == "META-INF/MANIFEST.MF") {
+            sniffer_.decide(MimeType::Jar);
+        }
+    }
+
+    void onEntryData(const ZipEntry&, const uint8_t* data, size_t len) override {
+        if (!sniffer_.inZipMimetype_) {
+            return;
+        }
+        size_t take = min(len, sizeof(sniffer_.zipMimetype_) - sniffer_.zipMimetypeLen_);
+        memcpy(sniffer_.zipMimetype_ + sniffer_.zipMimetypeLen_, data, take);
+        sniffer_.zipMimetypeLen_ += take;
+    }
+
+    void onEntryEnd(const ZipEntry&) override {
+        if (!sniffer_.inZipMimetype_ || sniffer_.decided()) {
+            return;
+        }
+        sniffer_.inZipMimetype_ = false;
+        const string_view content(sniffer_.zipMimetype_, sniffer_.zipMimetypeLen_);
+        if (content == kOdtMimetype) {
+            sniffer_.decide(MimeType::Odt);
+        } else if (content == kEpubMimetype) {
+            sniffer_.decide(MimeType::Epub);
+        } else {
+            // Another ODF flavour (spreadsheet, drawing, ...): not one we label.
+            sniffer_.decide(MimeType::Zip);
+        }
+    }
+
+private:
+    MimeSniffer& sniffer_;
+};
+
+void MimeSniffer::feed(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (state_ == State::Magic) {
+        size_t previous = headLen_;
+        size_t take = min(len, sizeof(head_) - headLen_);
+        memcpy(head_ + headLen_, data, take);
+        headLen_ += take;
+
+        MagicResult match = matchMagic(kMagicIndex, head_, headLen_);
+        if (match.status == MagicStatus::Pending) {
+            return;
+        }
+        if (match.status == MagicStatus::Matched && match.type == MimeType::Heic &&
+            isGenericHeifBrand(head_ + kFtypMajorBrand)) {
+            state_ = State::FtypBrands;
+            ftypSize_ = (uint32_t(head_[0]) << 24) | (uint32_t(head_[1]) << 16) | (uint32_t(head_[2]) << 8) | head_[3];
+            // The head stops where the compatible brands start, or before.
+            ftypOffset_ = headLen_;
+            scanFtypBrands(data + take, len - take);
+            return;
+        }
+        if (match.status == MagicStatus::Matched && match.type != MimeType::Zip) {
+            decide(match.type);
+            return;
+        }
+        // Head bytes from earlier feeds are replayed into the follow-up scan,
+        // exactly as if they had been scanned in place; this chunk is scanned whole.
+        if (match.status == MagicStatus::Matched) {
+            state_ = State::ZipScan;
+            carryLen_ = previous;
+            memcpy(carry_, head_, carryLen_);
+            scanned_ = carryLen_;
+            ZipClassifier classifier(*this);
+            zipWalker_.feed(head_, previous, classifier);
+            scanZip(data, len);
+        } else {
+            state_ = State::TextScan;
+            scanText(head_, previous);
+            scanText(data, len);
+        }
+        return;
+    }
+    if (state_ == State::ZipScan) {
+        scanZip(data, len);
+    } else if (state_ == State::TextScan) {
+        scanText(data, len);
+    } else if (state_ == State::FtypBrands) {
+        scanFtypBrands(data, len);
+    }
+}
+
+void MimeSniffer::scanFtypBrands(const uint8_t* data, size_t len) {
+    const size_t boxEnd = min<size_t>(ftypSize_, kMaxFtypBox);
+    for (size_t i = 0; i < len && state_ == State::FtypBrands; ++i, ++ftypOffset_) {
+        if (ftypOffset_ >= boxEnd) {
+            decide(MimeType::OctetStream);
+            return;
+        }
+        if (ftypOffset_ < kFtypCompatibleBrands) {
+            continue; // the rest of the minor version
+        }
+        const size_t slot = (ftypOffset_ - kFtypCompatibleBrands) % 4;
+        ftypBrand_[slot] = data[i];
+        if (slot == 3 && (memcmp(ftypBrand_, "heic", 4) == 0 || memcmp(ftypBrand_, "heix", 4) == 0)) {
+            decide(MimeType::Heic);
+        }
+    }
+    if (state_ == State::FtypBrands && ftypOffset_ >= boxEnd) {
+        decide(MimeType::OctetStream);
+    }
+}
+
+void MimeSniffer::scanZip(const uint8_t* data, size_t len) {
+    ZipClassifier classifier(*this);
+    zipWalker_.feed(data, len, classifier);
+    if (decided()) {
+        return;
+    }
+    if (scanned_ < kZipMarkerWindow) {
+        scanZipMarkers(data, len);
+    }
+    switch (zipWalker_.status()) {
+    case ZipStreamWalker::Status::CentralDirectory:
+    case ZipStreamWalker::Status::Finished:
+        // Every entry has been seen without a conclusive one.
+        decide(MimeType::Zip);
+        break;
+    case ZipStreamWalker::Status::Lost:
+        if (scanned_ >= kZipMarkerWindow || (zipMarkers_ & kPartDirectoryMarkers) != 0) {
+            decide(zipMarkerVerdict(zipMarkers_));
+        }
+        break;
+    case ZipStreamWalker::Status::Walking:
+        break;
+    }
+}
+
+void MimeSniffer::scanZipMarkers(const uint8_t* data, size_t len) {
+    len = min(len, kZipMarkerWindow - scanned_);
+
+    // Markers straddling the previous chunk: search carry + the head of this chunk.
+    const MultiNeedleSearch& search = zipMarkerSearch();
+    uint8_t seam[kCarryCapacity * 2];
+    size_t seamHead = min(len, kCarryCapacity);
+    memcpy(seam, carry_, carryLen_);
+    memcpy(seam + carryLen_, data, seamHead);
+    zipMarkers_ |= search.findAll(seam, carryLen_ + seamHead) | search.findAll(data, len);
+
+    scanned_ += len;
+    if (len >= kCarryCapacity) {
+        memcpy(carry_, data + len - kCarryCapacity, kCarryCapacity);
+        carryLen_ = kCarryCapacity;
+    } else {
+        size_t keep = min(carryLen_, kCarryCapacity - len);
+        memmove(carry_, carry_ + carryLen_ - keep, keep);
+        memcpy(carry_ + keep, data, len);
+        carryLen_ = keep + len;
+    }
+}
+
+void MimeSniffer::scanText(const uint8_t* data, size_t len) {
+    if (state_ != State::TextScan) {
+        return;
+    }
+    len = min(len, kTextWindow - scanned_);
+    memcpy(text_ + scanned_, data, len);
+    scanned_ += len;
+    if (scanned_ >= kTextWindow) {
+        decide(classifyText(false));
+    }
+}
+
+MimeType MimeSniffer::classifyText(bool complete) {
+    const uint8_t* text = text_;
+    size_t len = scanned_;
+    if (len == 0) {
+        return MimeType::OctetStream;
+    }
+    textEncoding_ = TextEncoding::None;
+    if (len >= 3 && text[0] == 0xEF && text[1] == 0xBB && text[2] == 0xBF) {
+        textEncoding_ = TextEncoding::Utf8;
+        text += 3;
+        len -= 3;
+    } else if (len >= 2 && text[0] == 0xFF && text[1] == 0xFE) {
+        textEncoding_ = TextEncoding::Utf16Le;
+        text += 2;
+        len -= 2;
+    } else if (len >= 2 && text[0] == 0xFE && text[1] == 0xFF) {
+        textEncoding_ = TextEncoding::Utf16Be;
+        text += 2;
+        len -= 2;
+    } else if (len >= 4) {
+        // Without a BOM, ASCII-range UTF-16 has a zero in nearly every code
+        // unit's high byte and almost none in the low bytes.
+        size_t evenZeros = 0;
+        size_t oddZeros = 0;
+        const size_t units = len / 2;
+        for (size_t i = 0; i < units; ++i) {
+            evenZeros += text[2 * i] == 0;
+            oddZeros += text[2 * i + 1] == 0;
+        }
+        if (oddZeros * 4 >= units * 3 && evenZeros * 16 <= units) {
+            textEncoding_ = TextEncoding::Utf16Le;
+        } else if (evenZeros * 4 >= units * 3 && oddZeros * 16 <= units) {
+            textEncoding_ = TextEncoding::Utf16Be;
+        }
+    }
+
+    // UTF-16 is judged through its code units: ASCII ones as themselves,
+    // the rest as a placeholder non-ASCII byte.
+    uint8_t units[kTextWindow / 2];
+    if (textEncoding_ == TextEncoding::Utf16Le || textEncoding_ == TextEncoding::Utf16Be) {
+        const size_t low = textEncoding_ == TextEncoding::Utf16Le ? 0 : 1;
+        const size_t count = len / 2;
+        for (size_t i = 0; i < count; ++i) {
+            const uint8_t lo = text[2 * i + low];
+            const uint8_t hi = text[2 * i + 1 - low];
+            units[i] = hi == 0 && lo < 0x80 ? lo : 0x80;
+        }
+        text = units;
+        len = count;
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+        if (isBinaryByte(text[i])) {
+            textEncoding_ = TextEncoding::None;
+            return MimeType::OctetStream;
+        }
+    }
+    size_t start = 0;
+    while (start < len && isJsonSpace(text[start])) {
+        ++start;
+    }
+    const uint8_t* body = text + start;
+    const size_t bodyLen = len - start;
+    constexpr string_view kXmlDeclaration = "<?xml";
+    if (bodyLen >= kXmlDeclaration.size() && memcmp(body, kXmlDeclaration.data(), kXmlDeclaration.size()) == 0) {
+        return MimeType::Xml;
+    }
+    if (bodyLen > 0 && (body[0] == '{' || body[0] == '[') && looksLikeJson(body, bodyLen, complete)) {
+        return MimeType::Json;
+    }
+    if (looksLikeCsv(text, len, complete)) {
+        return MimeType::Csv;
+    }
+    return MimeType::PlainText;
+}
+
+MimeType MimeSniffer::finish() {
+    if (state_ == State::Magic) {
+        // Input ended before any signature was conclusive: judge what we have as text.
+        state_ = State::TextScan;
+        scanText(head_, headLen_);
+    }
+    switch (state_) {
+    case State::ZipScan:
+        // Truncated archive or a walk that lost its place.
+        decide(zipMarkerVerdict(zipMarkers_));
+        break;
+    case State::TextScan:
+        decide(classifyText(true));
+        break;
+    case State::FtypBrands:
+        // The box ended early without a HEIC brand.
+        decide(MimeType::OctetStream);
+        break;
+    default:
+        break;
+    }
+    return result_;
+}
+
+MimeType sniffMime(const uint8_t* bytes, size_t len) {
+    MimeSniffer sniffer;
+    sniffer.feed(bytes, len);
+    return sniffer.finish();
+}
+
+string detectMime(const vector<uint8_t>& bytes) {
+    MimeSniffer sniffer;
+    sniffer.feed(bytes.data(), bytes.size());
+    const MimeType type = sniffer.finish();
+    string mime = mimeTypeName(type);
+    const TextEncoding charset =
+        textCharset(type, sniffer.textEncoding(), isValidUtf8(bytes.data(), bytes.size()));
+    if (charset != TextEncoding::None) {
+        mime += "; charset=";
+        mime += textEncodingName(charset);
+    }
+    return mime;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "zip_stream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Interned identifiers for every MIME type the sniffer can produce.
+ * Names are static strings, so results can carry a type without allocating.
+ */
+enum class MimeType : std::uint8_t {
+    OctetStream,
+    Pdf,
+    Docx,
+    Png,
+    Jpeg,
+    Gif,
+    Tiff,
+    Webp,
+    Heic,
+    Mp4,
+    Rtf,
+    Zip,
+    SevenZip,
+    Gzip,
+    PlainText,
+    Xlsx,
+    Pptx,
+    Odt,
+    Epub,
+    Jar,
+    Csv,
+    Json,
+    Xml,
+    Count
+};
+
+/**
+ * Character encoding of text input, as reported in a "charset" parameter.
+ * None when the input is not text or its 8-bit encoding is not UTF-8.
+ */
+enum class TextEncoding : std::uint8_t {
+    None,
+    Utf8,
+    Utf16Le,
+    Utf16Be,
+    Count
+};
+
+/**
+ * True for ZIP and the package formats built on it (OOXML, ODF, EPUB, JAR).
+ */
+bool isZipContainer(MimeType type);
+
+/**
+ * True for the text types: plain text and the formats recognized within it (CSV, JSON, XML).
+ */
+bool isTextType(MimeType type);
+
+/**
+ * The canonical "type/subtype" string for a MimeType (static storage).
+ */
+const char* mimeTypeName(MimeType type);
+
+/**
+ * The charset parameter value for a TextEncoding ("utf-8", ...); empty for None.
+ */
+const char* textEncodingName(TextEncoding encoding);
+
+/**
+ * The charset of text input once the whole stream is known: UTF-16 as the
+ * sniffer found it, otherwise UTF-8 only if every byte validated (a UTF-8 BOM
+ * alone does not make it so). None for non-text types.
+ */
+TextEncoding textCharset(MimeType type, TextEncoding sniffed, bool validUtf8);
+
+/**
+ * The "type/subtype" essence of a MIME string: parameters dropped and
+ * surrounding whitespace trimmed. Returns a view into the input; never allocates.
+ */
+std::string_view mimeEssence(std::string_view mime);
+
+/**
+ * ASCII case-insensitive equality, as MIME types and subtypes are case-insensitive.
+ */
+bool mimeEqualsIgnoreCase(std::string_view lhs, std::string_view rhs);
+
+/**
+ * Maps a MIME string (parameters and case ignored) to its interned id;
+ * aliases such as "text/xml" map to the canonical type. Returns false when
+ * the type is not one the sniffer can produce.
+ */
+bool lookupMimeType(std::string_view mime, MimeType& out);
+
+/**
+ * Whether content detected as `detected` satisfies a claimed or allowlisted
+ * `declared` type: the same type, or any text type for text/plain, since CSV,
+ * JSON and XML are plain text the sniffer happened to recognize.
+ */
+bool mimeCovers(MimeType declared, MimeType detected);
+
+/**
+ * Incremental MIME sniffer fed chunk by chunk as bytes stream past.
+ * Leading bytes are matched against the compiled signature index (see magic.hpp)
+ * and the decision is made as soon as the magic is conclusive. ZIP archives are
+ * then walked header by header (see zip_stream.hpp) and classified from their
+ * entry names and ODF "mimetype" entry; if the walk loses its place, container
+ * markers found in the leading bytes decide instead. An ISO BMFF file with a
+ * generic HEIF major brand (mif1, msf1) is HEIC only if its ftyp box lists a
+ * heic or heix compatible brand. Input matching no
+ * signature is judged from its first kTextWindow bytes: a byte order mark or
+ * the zero-byte pattern of ASCII-range UTF-16 sets the encoding, binary bytes
+ * mean opaque data, and text is told apart as XML, JSON, CSV or plain text.
+ * Apart from the walker's header window and the text window, at most a
+ * 16-byte head and a needle-sized carry are held, so nothing is buffered per
+ * entry and markers split across chunk boundaries are still found. Once
+ * decided(), further feed() calls are no-ops.
+ */
+class MimeSniffer {
+public:
+    void feed(const std::uint8_t* data, std::size_t len);
+
+    bool decided() const { return state_ == State::Done; }
+
+    /**
+     * Container markers searched for in the leading bytes of ZIP archives.
+     */
+    enum class ZipMarker : std::uint8_t {
+        Word,         // "word/"
+        Excel,        // "xl/"
+        PowerPoint,   // "ppt/"
+        ContentTypes, // "[Content_Types].xml"
+        OdfMimetype,  // "mimetype"
+        Count
+    };
+
+    /**
+     * Bitmask (bit = ZipMarker) of every marker seen so far in a ZIP archive.
+     */
+    std::uint32_t zipMarkers() const { return zipMarkers_; }
+
+    static bool hasZipMarker(std::uint32_t markers, ZipMarker marker) {
+        return (markers >> static_cast<unsigned>(marker)) & 1u;
+    }
+
+    /**
+     * Signals end of input and returns the decision.
+     */
+    MimeType finish();
+
+    /**
+     * The decision, once decided().
+     */
+    MimeType decision() const { return result_; }
+
+    /**
+     * For text: UTF-16 when a byte order mark or the zero-byte pattern says
+     * so, UTF-8 after a UTF-8 byte order mark, otherwise None, since only the
+     * whole stream can show 8-bit text is UTF-8 (see textCharset()).
+     */
+    TextEncoding textEncoding() const { return textEncoding_; }
+
+    // ZIP containers are searched for container markers within this many leading bytes.
+    // The markers only decide when the header walk cannot.
+    static constexpr std::size_t kZipMarkerWindow = 4096;
+    // Input without a signature is classified from this many leading bytes.
+    static constexpr std::size_t kTextWindow = 512;
+
+private:
+    enum class State { Magic, ZipScan, TextScan, FtypBrands, Done };
+
+    class ZipClassifier;
+
+    void decide(MimeType type) {
+        result_ = type;
+        state_ = State::Done;
+    }
+    void scanZip(const std::uint8_t* data, std::size_t len);
+    void scanZipMarkers(const std::uint8_t* data, std::size_t len);
+    void scanText(const std::uint8_t* data, std::size_t len);
+    void scanFtypBrands(const std::uint8_t* data, std::size_t len);
+    MimeType classifyText(bool complete);
+
+    static constexpr std::size_t kCarryCapacity = 18; // longest marker minus one
+
+    State state_ = State::Magic;
+    MimeType result_ = MimeType::OctetStream;
+    std::uint8_t head_[16] = {};
+    std::size_t headLen_ = 0;
+    std::uint8_t carry_[kCarryCapacity] = {};
+    std::size_t carryLen_ = 0;
+    std::size_t scanned_ = 0;
+    std::uint32_t zipMarkers_ = 0;
+    std::uint8_t text_[kTextWindow] = {};
+    TextEncoding textEncoding_ = TextEncoding::None;
+    ZipStreamWalker zipWalker_;
+    // Leading bytes of a stored ODF "mimetype" entry, while it streams past.
+    bool inZipMimetype_ = false;
+    char zipMimetype_[64] = {};
+    std::size_t zipMimetypeLen_ = 0;
+    // ISO BMFF ftyp box of a generic HEIF file: its declared size, the offset
+    // reached in it, and the compatible brand being read.
+    std::uint32_t ftypSize_ = 0;
+    std::size_t ftypOffset_ = 0;
+    std::uint8_t ftypBrand_[4] = {};
+};
+
+/**
+ * Detects the MIME type of a buffer by sniffing content.
+ * Returns MimeType::OctetStream when no known signature matches.
+ */
+MimeType sniffMime(const std::uint8_t* data, std::size_t len);
+
+/**
+ * Detects the MIME type of a file's bytes by sniffing content, with a
+ * charset parameter for text ("text/csv; charset=utf-8").
+ * Returns "application/octet-stream" when no known signature matches.
+ */
+std::string detectMime(const std::vector<std::uint8_t>& bytes);
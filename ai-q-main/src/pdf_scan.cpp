@@ -0,0 +1,300 @@
+#include "pdf_scan.hpp"
+
+#include "simd_search.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+enum Keyword : size_t {
+    Eof,
+    Startxref,
+    Linearized,
+    Encrypt,
+    JavaScript,
+    OpenAction,
+    EmbeddedFile,
+    // A '#' escaping a letter (0x41-0x7A) inside a name; the name is decoded from there.
+    Escape4,
+    Escape5,
+    Escape6,
+    Escape7,
+};
+
+const MultiNeedleSearch& pdfKeywordSearch() {
+    static const MultiNeedleSearch search{"%%EOF", "startxref", "/Linearized", "/Encrypt", "/JavaScript",
+                                          "/OpenAction", "/EmbeddedFile", "#4", "#5", "#6", "#7"};
+    return search;
+}
+
+constexpr uint64_t kKeywordLength[] = {5, 9, 11, 8, 11, 11, 13, 2, 2, 2, 2};
+
+constexpr unsigned kMaxDigits = 19; // fits an int64_t
+
+// The linearization dictionary is the first object in the file (PDF 32000 Annex F).
+constexpr uint64_t kLinearizedWindow = 1024;
+
+inline bool isPdfWhitespace(uint8_t c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\0';
+}
+
+inline bool isPdfDelimiter(uint8_t c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' || c == '{' || c == '}' ||
+           c == '/' || c == '%';
+}
+
+inline int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace (internal)
+
+void PdfStructureScanner::feed(const uint8_t* data, size_t len) {
+    if (state_ == State::NotPdf || len == 0) {
+        return;
+    }
+    const size_t previous = headerLen_;
+    if (headerLen_ < kHeaderLength) {
+        const size_t take = min(len, kHeaderLength - headerLen_);
+        memcpy(header_ + headerLen_, data, take);
+        headerLen_ += take;
+        if (headerLen_ == kHeaderLength && header_[6] == '.' && header_[5] >= '0' && header_[5] <= '9' &&
+            header_[7] >= '0' && header_[7] <= '9') {
+            info_.versionMajor = static_cast<uint8_t>(header_[5] - '0');
+            info_.versionMinor = static_cast<uint8_t>(header_[7] - '0');
+        }
+    }
+    if (state_ == State::Header) {
+        const size_t checked = min<size_t>(headerLen_, 5);
+        if (memcmp(header_, "%PDF-", checked) != 0) {
+            state_ = State::NotPdf;
+            return;
+        }
+        if (checked < 5) {
+            return;
+        }
+        // Header bytes held from earlier feeds are scanned first, in place.
+        state_ = State::Body;
+        info_.scanned = true;
+        scan(header_, previous);
+    }
+    scan(data, len);
+}
+
+void PdfStructureScanner::scan(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    // A value cut off at the previous chunk continues here; it holds no keywords.
+    if (value_ != Value::Idle) {
+        parseStartxref(data, len);
+    }
+    // Likewise an escaped name.
+    if (nameOpen_) {
+        decodeName(offset_, data, len);
+    }
+
+    // Keywords straddling the previous chunk: search carry + the head of this
+    // chunk, keeping only matches that cross the boundary.
+    const MultiNeedleSearch& search = pdfKeywordSearch();
+    uint8_t seam[kCarryCapacity * 2];
+    const size_t seamHead = min(len, kCarryCapacity);
+    memcpy(seam, carry_, carryLen_);
+    memcpy(seam + carryLen_, data, seamHead);
+    search.forEachMatch(seam, carryLen_ + seamHead, [&](size_t needle, size_t at) {
+        if (at < carryLen_ && at + kKeywordLength[needle] > carryLen_) {
+            onMatch(needle, offset_ - carryLen_ + at, data, len);
+        }
+        return at < carryLen_;
+    });
+    search.forEachMatch(data, len, [&](size_t needle, size_t at) {
+        onMatch(needle, offset_ + at, data, len);
+        return true;
+    });
+
+    if (len >= kCarryCapacity) {
+        memcpy(carry_, data + len - kCarryCapacity, kCarryCapacity);
+        carryLen_ = kCarryCapacity;
+    } else {
+        const size_t keep = min(carryLen_, kCarryCapacity - len);
+        memmove(carry_, carry_ + carryLen_ - keep, keep);
+        memcpy(carry_ + keep, data, len);
+        carryLen_ = keep + len;
+    }
+    offset_ += len;
+}
+
+void PdfStructureScanner::onMatch(size_t needle, uint64_t offset, const uint8_t* data, size_t len) {
+    switch (needle) {
+    case Keyword::Eof:
+        ++info_.eofMarkers;
+        lastEofEnd_ = offset + kKeywordLength[Keyword::Eof];
+        break;
+    case Keyword::Startxref: {
+        endStartxref(); // a value still open ends at the next keyword
+        startxrefSeen_ = true;
+        lastStartxrefAt_ = offset;
+        info_.startxref = -1;
+        value_ = Value::Space;
+        pendingValue_ = 0;
+        pendingDigits_ = 0;
+        // The value follows the keyword, within this chunk or from the next one.
+        const uint64_t valueAt = offset + kKeywordLength[Keyword::Startxref] - offset_;
+        if (valueAt < len) {
+            parseStartxref(data + valueAt, len - static_cast<size_t>(valueAt));
+        }
+        break;
+    }
+    case Keyword::Linearized:
+        info_.linearized = info_.linearized || offset < kLinearizedWindow;
+        break;
+    case Keyword::Encrypt:
+        active_.encrypted = true;
+        break;
+    case Keyword::JavaScript:
+        active_.javaScript = true;
+        break;
+    case Keyword::OpenAction:
+        active_.openAction = true;
+        break;
+    case Keyword::EmbeddedFile:
+        active_.embeddedFiles = true;
+        break;
+    case Keyword::Escape4:
+    case Keyword::Escape5:
+    case Keyword::Escape6:
+    case Keyword::Escape7:
+        onEscape(offset, data, len);
+        break;
+    default:
+        break;
+    }
+}
+
+uint8_t PdfStructureScanner::byteAt(uint64_t offset, const uint8_t* data) const {
+    return offset >= offset_ ? data[offset - offset_] : carry_[carryLen_ - (offset_ - offset)];
+}
+
+void PdfStructureScanner::onEscape(uint64_t offset, const uint8_t* data, size_t len) {
+    if (offset < nameEnd_) {
+        return; // part of a name already decoded
+    }
+    // Walk back to the '/' opening the name, no further than an escaped keyword reaches.
+    const uint64_t available = offset_ - carryLen_;
+    uint64_t start = offset;
+    for (;;) {
+        if (offset - start >= kMaxEncodedName || start <= available) {
+            return;
+        }
+        const uint8_t c = byteAt(--start, data);
+        if (c == '/') {
+            break;
+        }
+        if (isPdfWhitespace(c) || isPdfDelimiter(c)) {
+            return;
+        }
+    }
+    nameOpen_ = true;
+    nameStart_ = start;
+    nameLen_ = 0;
+    nameEscapeDigits_ = 0;
+    decodeName(start, data, len);
+}
+
+void PdfStructureScanner::decodeName(uint64_t from, const uint8_t* data, size_t len) {
+    const uint64_t end = offset_ + len;
+    uint64_t at = from;
+    for (; at < end && nameOpen_; ++at) {
+        const uint8_t c = byteAt(at, data);
+        if (at == nameStart_) {
+            appendNameChar(c, data, len);
+        } else if (nameEscapeDigits_ > 0) {
+            const int digit = hexValue(c);
+            if (digit < 0) {
+                nameOpen_ = false; // a malformed escape names nothing we look for
+                break;
+            }
+            nameEscapeValue_ = static_cast<uint8_t>(nameEscapeValue_ * 16 + digit);
+            if (--nameEscapeDigits_ == 0) {
+                appendNameChar(nameEscapeValue_, data, len);
+            }
+        } else if (c == '#') {
+            nameEscapeDigits_ = 2;
+            nameEscapeValue_ = 0;
+        } else if (isPdfWhitespace(c) || isPdfDelimiter(c)) {
+            endName(data, len);
+        } else {
+            appendNameChar(c, data, len);
+        }
+    }
+    nameEnd_ = at;
+}
+
+void PdfStructureScanner::appendNameChar(uint8_t c, const uint8_t* data, size_t len) {
+    name_[nameLen_++] = static_cast<char>(c);
+    if (nameLen_ == kMaxNameLength) {
+        endName(data, len); // long enough to hold any keyword as a prefix, as the raw search matches
+    }
+}
+
+void PdfStructureScanner::endName(const uint8_t* data, size_t len) {
+    nameOpen_ = false;
+    const MultiNeedleSearch& search = pdfKeywordSearch();
+    for (size_t keyword = Keyword::Linearized; keyword <= Keyword::EmbeddedFile; ++keyword) {
+        const string& needle = search.needle(keyword);
+        if (nameLen_ >= needle.size() && memcmp(name_, needle.data(), needle.size()) == 0) {
+            onMatch(keyword, nameStart_, data, len);
+        }
+    }
+}
+
+void PdfStructureScanner::parseStartxref(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len && value_ != Value::Idle; ++i) {
+        const uint8_t c = data[i];
+        if (c >= '0' && c <= '9') {
+            if (pendingDigits_ == kMaxDigits) {
+                // Too long to be an offset: leave startxref unset.
+                value_ = Value::Idle;
+                break;
+            }
+            value_ = Value::Digits;
+            pendingValue_ = pendingValue_ * 10 + (c - '0');
+            ++pendingDigits_;
+        } else if (value_ == Value::Digits || !isPdfWhitespace(c)) {
+            endStartxref();
+        }
+    }
+}
+
+void PdfStructureScanner::endStartxref() {
+    if (value_ != Value::Idle && pendingDigits_ > 0) {
+        info_.startxref = static_cast<int64_t>(pendingValue_);
+    }
+    value_ = Value::Idle;
+}
+
+const PdfInfo& PdfStructureScanner::finish() {
+    if (!info_.scanned) {
+        return info_;
+    }
+    endStartxref();
+    if (nameOpen_) {
+        endName(nullptr, 0);
+    }
+    const uint64_t size = offset_;
+    info_.truncated = info_.eofMarkers == 0 || !startxrefSeen_ || size - lastEofEnd_ > kEofWindow ||
+                      lastStartxrefAt_ > lastEofEnd_;
+    info_.invalidStartxref = startxrefSeen_ && (info_.startxref < 0 ||
+                                                static_cast<uint64_t>(info_.startxref) >= lastStartxrefAt_);
+    const uint32_t revisions = info_.eofMarkers - (info_.linearized && info_.eofMarkers >= 2 ? 1 : 0);
+    info_.incrementalUpdates = revisions > 0 ? revisions - 1 : 0;
+    return info_;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "active_content.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * What a PdfStructureScanner learned about a PDF's file structure.
+ */
+struct PdfInfo {
+    bool scanned = false; // the upload started with a PDF header and was scanned
+    std::uint8_t versionMajor = 0;
+    std::uint8_t versionMinor = 0;
+    std::uint32_t eofMarkers = 0;
+    // Revisions appended after the original file (PDF 32000 7.5.6); the
+    // first-page section of a linearized file is not counted as one.
+    std::uint32_t incrementalUpdates = 0;
+    bool linearized = false;
+    std::int64_t startxref = -1; // offset after the last "startxref"; -1 when absent
+    // No "%%EOF" in the last kEofWindow bytes, or no "startxref" at all.
+    bool truncated = false;
+    // The last startxref offset does not point back into the file.
+    bool invalidStartxref = false;
+};
+
+/**
+ * Single pass over a PDF's bytes as they stream past, locating "startxref"
+ * values and "%%EOF" markers with one SIMD multi-needle search per chunk (see
+ * simd_search.hpp). Keywords split across chunks are found through a small
+ * carry; nothing else is buffered. Input that does not start with "%PDF-" is
+ * ignored after its first bytes.
+ *
+ * The same search flags active content by its dictionary keys (/Encrypt,
+ * /JavaScript, /OpenAction, /EmbeddedFile). Names spelled with #xx escapes
+ * (PDF 32000 7.3.5, e.g. /J#61vaScript) are found through their escapes and
+ * decoded before matching. Keys inside compressed object streams (PDF 1.5+)
+ * are not seen.
+ */
+class PdfStructureScanner {
+public:
+    /**
+     * How far from the end of the file the last "%%EOF" may sit: readers
+     * search this many trailing bytes for it (PDF 32000 Annex H).
+     */
+    static constexpr std::uint64_t kEofWindow = 1024;
+
+    void feed(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Marks the end of input and completes the info.
+     */
+    const PdfInfo& finish();
+
+    /**
+     * False once the input has turned out not to be a PDF.
+     */
+    bool active() const { return state_ != State::NotPdf; }
+
+    const PdfInfo& info() const { return info_; }
+
+    const ActiveContent& activeContent() const { return active_; }
+
+private:
+    enum class State { Header, Body, NotPdf };
+    enum class Value { Idle, Space, Digits };
+
+    void scan(const std::uint8_t* data, std::size_t len);
+    void onMatch(std::size_t needle, std::uint64_t offset, const std::uint8_t* data, std::size_t len);
+    void parseStartxref(const std::uint8_t* data, std::size_t len);
+    void endStartxref();
+    void onEscape(std::uint64_t offset, const std::uint8_t* data, std::size_t len);
+    void decodeName(std::uint64_t from, const std::uint8_t* data, std::size_t len);
+    void appendNameChar(std::uint8_t c, const std::uint8_t* data, std::size_t len);
+    void endName(const std::uint8_t* data, std::size_t len);
+    std::uint8_t byteAt(std::uint64_t offset, const std::uint8_t* data) const;
+
+    // The longest name keyword, "/EmbeddedFile", and its length with every letter escaped.
+    static constexpr std::size_t kMaxNameLength = 13;
+    static constexpr std::size_t kMaxEncodedName = 1 + 3 * (kMaxNameLength - 1);
+    // Enough to walk back from an escape to the start of its name.
+    static constexpr std::size_t kCarryCapacity = kMaxEncodedName + 3;
+    static constexpr std::size_t kHeaderLength = 8; // "%PDF-1.7"
+
+    State state_ = State::Header;
+    PdfInfo info_;
+    ActiveContent active_;
+    std::uint64_t offset_ = 0; // bytes fed before the current chunk
+    std::uint64_t lastEofEnd_ = 0;
+    bool startxrefSeen_ = false;
+    std::uint64_t lastStartxrefAt_ = 0;
+    std::uint8_t header_[kHeaderLength] = {};
+    std::size_t headerLen_ = 0;
+
+    // Parsing the number after "startxref", which may span chunks.
+    Value value_ = Value::Idle;
+    std::uint64_t pendingValue_ = 0;
+    unsigned pendingDigits_ = 0;
+
+    std::uint8_t carry_[kCarryCapacity] = {};
+    std::size_t carryLen_ = 0;
+
+    // A name with #xx escapes, decoded as it streams past; it may span chunks.
+    bool nameOpen_ = false;
+    std::uint64_t nameStart_ = 0;
+    std::uint64_t nameEnd_ = 0; // offset the decoding has reached
+    char name_[kMaxNameLength] = {};
+    std::size_t nameLen_ = 0;
+    std::uint8_t nameEscapeDigits_ = 0; // hex digits still owed by a '#'
+    std::uint8_t nameEscapeValue_ = 0;
+};
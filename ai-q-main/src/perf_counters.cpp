@@ -0,0 +1,120 @@
+#include "perf_counters.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+atomic<bool> gPerfSamplingEnabled{false};
+
+#if defined(__linux__)
+
+int openCounter(uint32_t type, uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+#endif
+
+} // namespace (internal)
+
+#if defined(__linux__)
+
+PerfCounterGroup::PerfCounterGroup() {
+    leaderFd_ = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (leaderFd_ < 0) {
+        return;
+    }
+    const uint64_t members[3] = {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < 3; ++i) {
+        memberFds_[i] = openCounter(PERF_TYPE_HARDWARE, members[i], leaderFd_);
+        if (memberFds_[i] < 0) {
+            // A partial group would report misleading ratios; treat as unavailable.
+            for (int j = 0; j < i; ++j) {
+                close(memberFds_[j]);
+                memberFds_[j] = -1;
+            }
+            close(leaderFd_);
+            leaderFd_ = -1;
+            return;
+        }
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : memberFds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (leaderFd_ >= 0) {
+        close(leaderFd_);
+    }
+}
+
+void PerfCounterGroup::start() {
+    if (leaderFd_ < 0) {
+        return;
+    }
+    ioctl(leaderFd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leaderFd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfSample PerfCounterGroup::stop() {
+    PerfSample sample;
+    if (leaderFd_ < 0) {
+        return sample;
+    }
+    ioctl(leaderFd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // PERF_FORMAT_GROUP layout: nr, then one value per counter in open order.
+    uint64_t values[1 + 4] = {0};
+    if (read(leaderFd_, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[0] != 4) {
+        return sample;
+    }
+    sample.valid = true;
+    sample.cycles = values[1];
+    sample.instructions = values[2];
+    sample.cacheMisses = values[3];
+    sample.branchMisses = values[4];
+    return sample;
+}
+
+#else
+
+PerfCounterGroup::PerfCounterGroup() {}
+
+PerfCounterGroup::~PerfCounterGroup() {}
+
+void PerfCounterGroup::start() {}
+
+PerfSample PerfCounterGroup::stop() {
+    return PerfSample{};
+}
+
+#endif
+
+void setPerfSamplingEnabled(bool enabled) {
+    gPerfSamplingEnabled.store(enabled, memory_order_relaxed);
+}
+
+bool perfSamplingEnabled() {
+    return gPerfSamplingEnabled.load(memory_order_relaxed);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Hardware counter readings for one measured region.
+ * valid is false when counters are unavailable (non-Linux, no PMU access,
+ * perf_event_paranoid too strict, or running under a VM without vPMU).
+ */
+struct PerfSample {
+    bool valid = false;
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cacheMisses = 0;
+    std::uint64_t branchMisses = 0;
+};
+
+/**
+ * A perf_event_open counter group (cycles, instructions, cache misses, branch
+ * misses) for the calling thread, user space only. The group is opened once on
+ * construction; start()/stop() bracket each measured region. When the counters
+ * cannot be opened every call is a cheap no-op and stop() returns an invalid sample.
+ */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool available() const { return leaderFd_ >= 0; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    int leaderFd_ = -1;
+    int memberFds_[3] = {-1, -1, -1};
+};
+
+/**
+ * Enables counter sampling around the hashing and sniffing kernels inside
+ * ingest(); samples are accumulated into the metrics snapshot. Off by default.
+ */
+void setPerfSamplingEnabled(bool enabled);
+
+bool perfSamplingEnabled();
@@ -0,0 +1,172 @@
+#include "png_verify.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr uint32_t kChunkIhdr = 0x49484452; // "IHDR"
+constexpr uint32_t kChunkIend = 0x49454E44; // "IEND"
+constexpr uint32_t kMaxChunkLength = 0x7FFFFFFF;
+
+inline uint32_t be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline bool isAsciiLetter(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/**
+ * Internal: the bit depths PNG allows for a colour type (spec 11.2.2, table 11.1).
+ */
+bool validBitDepth(uint8_t colorType, uint8_t bitDepth) {
+    switch (colorType) {
+    case 0: // greyscale
+        return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+    case 3: // indexed
+        return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+    case 2: // truecolour
+    case 4: // greyscale with alpha
+    case 6: // truecolour with alpha
+        return bitDepth == 8 || bitDepth == 16;
+    default:
+        return false;
+    }
+}
+
+} // namespace (internal)
+
+void PngVerifier::stop(Issue issue) {
+    report(issue);
+    state_ = State::Stopped;
+}
+
+size_t PngVerifier::fill(const uint8_t* data, size_t len, size_t want) {
+    size_t take = min(len, want - bufferLen_);
+    memcpy(buffer_ + bufferLen_, data, take);
+    bufferLen_ += take;
+    return take;
+}
+
+void PngVerifier::beginChunk() {
+    const uint32_t length = be32(buffer_);
+    const uint8_t* type = buffer_ + 4;
+    if (length > kMaxChunkLength || !isAsciiLetter(type[0]) || !isAsciiLetter(type[1]) ||
+        !isAsciiLetter(type[2]) || !isAsciiLetter(type[3])) {
+        stop(Issue::Corrupt);
+        return;
+    }
+    chunkType_ = be32(type);
+    ++chunkCount_;
+    // IHDR comes first, exactly once, with a fixed length.
+    if ((chunkCount_ == 1) != (chunkType_ == kChunkIhdr) || (chunkType_ == kChunkIhdr && length != 13)) {
+        stop(Issue::InvalidHeader);
+        return;
+    }
+    crc_.reset();
+    crc_.update(type, 4);
+    remaining_ = length;
+    bufferLen_ = 0;
+    state_ = State::ChunkData;
+}
+
+void PngVerifier::parseHeader() {
+    Header header;
+    header.width = be32(buffer_);
+    header.height = be32(buffer_ + 4);
+    header.bitDepth = buffer_[8];
+    header.colorType = buffer_[9];
+    header.interlace = buffer_[12];
+    const uint8_t compression = buffer_[10];
+    const uint8_t filter = buffer_[11];
+    if (header.width == 0 || header.height == 0 || header.width > kMaxChunkLength ||
+        header.height > kMaxChunkLength || !validBitDepth(header.colorType, header.bitDepth) ||
+        compression != 0 || filter != 0 || header.interlace > 1) {
+        stop(Issue::InvalidHeader);
+        return;
+    }
+    header_ = header;
+    hasHeader_ = true;
+    if (maxPixels_ >= 0 && header.pixels() > static_cast<uint64_t>(maxPixels_)) {
+        stop(Issue::PixelLimitExceeded);
+    }
+}
+
+void PngVerifier::endChunk() {
+    if (be32(buffer_) != crc_.value()) {
+        report(Issue::CrcMismatch);
+    }
+    bufferLen_ = 0;
+    if (chunkType_ == kChunkIend) {
+        ended_ = true;
+        state_ = State::Stopped;
+    } else {
+        state_ = State::ChunkHeader;
+    }
+}
+
+void PngVerifier::feed(const uint8_t* data, size_t len) {
+    // Empty chunks (IEND among them) close without waiting for more input.
+    while (state_ != State::Stopped && (len > 0 || (state_ == State::ChunkData && remaining_ == 0))) {
+        size_t used = 0;
+        switch (state_) {
+        case State::Signature: {
+            const size_t start = bufferLen_;
+            used = fill(data, len, sizeof(kPngSignature));
+            if (memcmp(buffer_ + start, kPngSignature + start, used) != 0) {
+                state_ = State::Stopped;
+            } else if (bufferLen_ == sizeof(kPngSignature)) {
+                isPng_ = true;
+                bufferLen_ = 0;
+                state_ = State::ChunkHeader;
+            }
+            break;
+        }
+        case State::ChunkHeader:
+            used = fill(data, len, 8);
+            if (bufferLen_ == 8) {
+                beginChunk();
+            }
+            break;
+        case State::ChunkData:
+            used = static_cast<size_t>(min<uint64_t>(len, remaining_));
+            crc_.update(data, used);
+            if (chunkType_ == kChunkIhdr) {
+                fill(data, used, 13);
+            }
+            remaining_ -= static_cast<uint32_t>(used);
+            if (remaining_ == 0) {
+                if (chunkType_ == kChunkIhdr) {
+                    parseHeader();
+                }
+                bufferLen_ = 0;
+                if (state_ != State::Stopped) {
+                    state_ = State::ChunkCrc;
+                }
+            }
+            break;
+        case State::ChunkCrc:
+            used = fill(data, len, 4);
+            if (bufferLen_ == 4) {
+                endChunk();
+            }
+            break;
+        case State::Stopped:
+            break;
+        }
+        data += used;
+        len -= used;
+    }
+}
+
+void PngVerifier::finish() {
+    if (isPng_ && !ended_ && state_ != State::Stopped) {
+        report(Issue::MissingEnd);
+    }
+}
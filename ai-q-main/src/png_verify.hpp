@@ -0,0 +1,101 @@
+#pragma once
+
+#include "crc32.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Walks a PNG's chunks as its bytes stream past: each chunk's CRC-32 is
+ * checked, the IHDR header is decoded and validated, and the image's pixel
+ * count is held to a limit before any decoder allocates for it. Chunk data is
+ * never buffered (IHDR's 13 bytes aside) and image data is not decompressed.
+ * Input without the PNG signature is ignored after its first bytes.
+ */
+class PngVerifier {
+public:
+    enum class Issue : std::uint8_t {
+        CrcMismatch,         // a chunk's CRC does not match its type and data
+        InvalidHeader,       // IHDR missing, misplaced or holding invalid values
+        PixelLimitExceeded,  // width * height over the configured limit
+        MissingEnd,          // input ended before the IEND chunk
+        Corrupt,             // chunk length or type out of range
+    };
+
+    /**
+     * IHDR fields (PNG spec 11.2.2).
+     */
+    struct Header {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        std::uint8_t bitDepth = 0;
+        std::uint8_t colorType = 0;
+        std::uint8_t interlace = 0;
+
+        std::uint64_t pixels() const { return static_cast<std::uint64_t>(width) * height; }
+    };
+
+    /**
+     * maxPixels bounds width * height; negative disables the limit.
+     */
+    explicit PngVerifier(std::int64_t maxPixels = -1) : maxPixels_(maxPixels) {}
+
+    void feed(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Marks the end of input: a PNG without its IEND chunk is truncated.
+     */
+    void finish();
+
+    /**
+     * False once the walk has ended: IEND reached, not a PNG, or stopped on a problem.
+     */
+    bool active() const { return state_ != State::Stopped; }
+
+    /**
+     * True once the signature has matched.
+     */
+    bool isPng() const { return isPng_; }
+
+    /**
+     * Whether a valid IHDR has been read; header() is meaningful only then.
+     */
+    bool hasHeader() const { return hasHeader_; }
+
+    const Header& header() const { return header_; }
+
+    std::uint64_t chunkCount() const { return chunkCount_; }
+
+    bool has(Issue issue) const { return (issues_ & bit(issue)) != 0; }
+
+    bool ok() const { return issues_ == 0; }
+
+private:
+    enum class State { Signature, ChunkHeader, ChunkData, ChunkCrc, Stopped };
+
+    static std::uint32_t bit(Issue issue) { return 1u << static_cast<unsigned>(issue); }
+
+    void report(Issue issue) { issues_ |= bit(issue); }
+    void stop(Issue issue);
+    std::size_t fill(const std::uint8_t* data, std::size_t len, std::size_t want);
+    void beginChunk();
+    void endChunk();
+    void parseHeader();
+
+    std::int64_t maxPixels_;
+    State state_ = State::Signature;
+    std::uint32_t issues_ = 0;
+    bool isPng_ = false;
+    bool hasHeader_ = false;
+    bool ended_ = false;
+    Header header_;
+    std::uint64_t chunkCount_ = 0;
+
+    // The chunk being walked.
+    std::uint32_t chunkType_ = 0;
+    std::uint32_t remaining_ = 0;
+    Crc32 crc_;
+    // Staging for the signature, chunk headers, CRCs and IHDR data.
+    std::uint8_t buffer_[13] = {};
+    std::size_t bufferLen_ = 0;
+};
@@ -0,0 +1,130 @@
+#include "sha1.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+inline uint32_t rotl(uint32_t value, uint32_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * Internal: Updates SHA-1 state with a message block. The schedule is kept in
+ * a 16-word ring and expanded as the rounds consume it.
+ */
+void sha1ProcessBlock(array<uint32_t, 5>& state, const uint8_t* block) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
+               (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+               (static_cast<uint32_t>(block[i * 4 + 3]));
+    }
+
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+
+    auto word = [&](int i) {
+        if (i >= 16) {
+            w[i & 15] = rotl(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15], 1);
+        }
+        return w[i & 15];
+    };
+    // One loop per round function keeps the rounds branch-free.
+    auto round = [&](uint32_t f, uint32_t k, uint32_t x) {
+        const uint32_t temp = rotl(a, 5) + f + e + k + x;
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = temp;
+    };
+    for (int i = 0; i < 20; ++i) {
+        round((b & c) | (~b & d), 0x5a827999UL, word(i));
+    }
+    for (int i = 20; i < 40; ++i) {
+        round(b ^ c ^ d, 0x6ed9eba1UL, word(i));
+    }
+    for (int i = 40; i < 60; ++i) {
+        round((b & c) | (b & d) | (c & d), 0x8f1bbcdcUL, word(i));
+    }
+    for (int i = 60; i < 80; ++i) {
+        round(b ^ c ^ d, 0xca62c1d6UL, word(i));
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+} // namespace (internal)
+
+Sha1::Sha1()
+    : state_{0x67452301UL, 0xefcdab89UL, 0x98badcfeUL, 0x10325476UL, 0xc3d2e1f0UL},
+      pending_{},
+      pendingLen_(0),
+      totalLen_(0) {}
+
+void Sha1::update(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    totalLen_ += len;
+    if (pendingLen_ > 0) {
+        size_t take = min(len, sizeof(pending_) - pendingLen_);
+        memcpy(pending_ + pendingLen_, data, take);
+        pendingLen_ += take;
+        data += take;
+        len -= take;
+        if (pendingLen_ < sizeof(pending_)) {
+            return;
+        }
+        sha1ProcessBlock(state_, pending_);
+        pendingLen_ = 0;
+    }
+    while (len >= 64) {
+        sha1ProcessBlock(state_, data);
+        data += 64;
+        len -= 64;
+    }
+    if (len > 0) {
+        memcpy(pending_, data, len);
+        pendingLen_ = len;
+    }
+}
+
+array<uint8_t, 20> Sha1::finish() {
+    uint64_t bitLength = totalLen_ * 8;
+    uint8_t finalBlock[128] = {0};
+    memcpy(finalBlock, pending_, pendingLen_);
+    finalBlock[pendingLen_] = 0x80;
+
+    size_t paddingIndex = ((pendingLen_ + 9) <= 64) ? 64 - 8 : 128 - 8;
+    for (size_t i = 0; i < 8; ++i) {
+        finalBlock[paddingIndex + i] = static_cast<uint8_t>((bitLength >> (56 - i * 8)) & 0xFF);
+    }
+
+    sha1ProcessBlock(state_, finalBlock);
+    if (paddingIndex != 64 - 8) {
+        sha1ProcessBlock(state_, finalBlock + 64);
+    }
+
+    array<uint8_t, 20> digest;
+    for (size_t i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Incremental SHA-1 (FIPS 180-4). Offered for compatibility with systems
+ * keyed by it; collisions are practical, so it must not back integrity
+ * decisions. Feed bytes with update(), then call finish() once.
+ */
+class Sha1 {
+public:
+    Sha1();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Applies the final padding and returns the 20-byte digest.
+     */
+    std::array<std::uint8_t, 20> finish();
+
+private:
+    std::array<std::uint32_t, 5> state_;
+    std::uint8_t pending_[64];
+    std::size_t pendingLen_;
+    std::uint64_t totalLen_;
+};
@@ -0,0 +1,159 @@
+#include "sha256.hpp"
+
+#include "hex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr array<uint32_t, 64> kSha256K = {
+    0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+    0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+    0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+    0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+    0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+    0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+    0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+    0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL};
+
+inline uint32_t rotr(uint32_t value, uint32_t bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+array<uint32_t, 8> sha256StateInit() {
+    return {0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+            0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL};
+}
+
+/**
+ * Internal: Updates SHA-256 state with a message block.
+ */
+void sha256ProcessBlock(array<uint32_t, 8>& state, const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) |
+               (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
+               (static_cast<uint32_t>(block[i * 4 + 3]));
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0];
+    uint32_t b = state[1];
+    uint32_t c = state[2];
+    uint32_t d = state[3];
+    uint32_t e = state[4];
+    uint32_t f = state[5];
+    uint32_t g = state[6];
+    uint32_t h = state[7];
+
+    for (int i = 0; i < 64; ++i) {
+        uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ ((~e) & g);
+        uint32_t temp1 = h + S1 + ch + kSha256K[i] + w[i];
+        uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = S0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+} // namespace (internal)
+
+Sha256::Sha256() : state_(sha256StateInit()), pending_{}, pendingLen_(0), totalLen_(0) {}
+
+void Sha256::update(const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    totalLen_ += len;
+    if (pendingLen_ > 0) {
+        size_t take = min(len, sizeof(pending_) - pendingLen_);
+        memcpy(pending_ + pendingLen_, data, take);
+        pendingLen_ += take;
+        data += take;
+        len -= take;
+        if (pendingLen_ < sizeof(pending_)) {
+            return;
+        }
+        sha256ProcessBlock(state_, pending_);
+        pendingLen_ = 0;
+    }
+    while (len >= 64) {
+        sha256ProcessBlock(state_, data);
+        data += 64;
+        len -= 64;
+    }
+    if (len > 0) {
+        memcpy(pending_, data, len);
+        pendingLen_ = len;
+    }
+}
+
+void Sha256Digest::toHex(char out[64]) const {
+    hexEncode(bytes.data(), bytes.size(), out);
+}
+
+string Sha256Digest::hex() const {
+    return hexString(bytes.data(), bytes.size());
+}
+
+Sha256Digest Sha256::finish() {
+    uint64_t bitLength = totalLen_ * 8;
+    uint8_t finalBlock[128] = {0};
+    memcpy(finalBlock, pending_, pendingLen_);
+    finalBlock[pendingLen_] = 0x80;
+
+    size_t paddingIndex = ((pendingLen_ + 9) <= 64) ? 64 - 8 : 128 - 8;
+    for (size_t i = 0; i < 8; ++i) {
+        finalBlock[paddingIndex + i] = static_cast<uint8_t>((bitLength >> (56 - i * 8)) & 0xFF);
+    }
+
+    sha256ProcessBlock(state_, finalBlock);
+    if (paddingIndex != 64 - 8) {
+        sha256ProcessBlock(state_, finalBlock + 64);
+    }
+
+    Sha256Digest digest;
+    for (size_t i = 0; i < 8; ++i) {
+        digest.bytes[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest.bytes[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest.bytes[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest.bytes[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+string sha256Hex(const vector<uint8_t>& data) {
+    Sha256 hasher;
+    hasher.update(data.data(), data.size());
+    return hasher.finishHex();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A raw SHA-256 digest. Hex is produced on demand so results can carry the
+ * digest without a heap allocation.
+ */
+struct Sha256Digest {
+    std::array<std::uint8_t, 32> bytes{};
+
+    /**
+     * Writes the 64-character lowercase hex form to out (no terminator).
+     */
+    void toHex(char out[64]) const;
+
+    std::string hex() const;
+
+    bool operator==(const Sha256Digest& other) const { return bytes == other.bytes; }
+    bool operator!=(const Sha256Digest& other) const { return bytes != other.bytes; }
+};
+
+/**
+ * Incremental SHA-256 (FIPS 180-4). Feed bytes with update(), then call
+ * finish() or finishHex() once; the object must not be updated afterwards.
+ */
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Applies the final padding and returns the digest.
+     */
+    Sha256Digest finish();
+
+    std::string finishHex() { return finish().hex(); }
+
+private:
+    std::array<std::uint32_t, 8> state_;
+    std::uint8_t pending_[64];
+    std::size_t pendingLen_;
+    std::uint64_t totalLen_;
+};
+
+/**
+ * Computes the SHA-256 hex digest of the given buffer.
+ */
+std::string sha256Hex(const std::vector<std::uint8_t>& data);
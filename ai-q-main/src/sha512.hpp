@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Incremental SHA-512 (FIPS 180-4). Feed bytes with update(), then call
+ * finish() once; the object must not be updated afterwards.
+ */
+class Sha512 {
+public:
+    Sha512();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Applies the final padding and returns the 64-byte digest.
+     */
+    std::array<std::uint8_t, 64> finish();
+
+private:
+    std::array<std::uint64_t, 8> state_;
+    std::uint8_t pending_[128];
+    std::size_t pendingLen_;
+    std::uint64_t totalLen_;
+};
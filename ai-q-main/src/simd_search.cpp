@@ -0,0 +1,230 @@
+#include "simd_search.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_SIMD_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+#if INGEST_SIMD_X86
+
+/**
+ * Internal: SSE2 candidate scan. A position is a candidate when it and the
+ * following byte equal some needle's leading pair. Advances pos past every
+ * position it covered; returns false if verify asked to stop.
+ */
+template <typename Verify>
+__attribute__((target("sse2"))) bool scanSse2(const uint8_t* pairFirst, const uint8_t* pairSecond,
+                                              size_t pairCount, const uint8_t* data, size_t len, size_t& pos,
+                                              Verify& verify) {
+    __m128i first[MultiNeedleSearch::kMaxNeedles];
+    __m128i second[MultiNeedleSearch::kMaxNeedles];
+    for (size_t p = 0; p < pairCount; ++p) {
+        first[p] = _mm_set1_epi8(static_cast<char>(pairFirst[p]));
+        second[p] = _mm_set1_epi8(static_cast<char>(pairSecond[p]));
+    }
+    // Two blocks per step so the compare chains of each block overlap.
+    size_t at = pos;
+    for (; at + 33 <= len; at += 32) {
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at + 1));
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at + 16));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at + 17));
+        __m128i hitsA = _mm_setzero_si128();
+        __m128i hitsB = _mm_setzero_si128();
+        for (size_t p = 0; p < pairCount; ++p) {
+            hitsA = _mm_or_si128(hitsA, _mm_and_si128(_mm_cmpeq_epi8(a0, first[p]), _mm_cmpeq_epi8(a1, second[p])));
+            hitsB = _mm_or_si128(hitsB, _mm_and_si128(_mm_cmpeq_epi8(b0, first[p]), _mm_cmpeq_epi8(b1, second[p])));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hitsA)) |
+                        (static_cast<uint32_t>(_mm_movemask_epi8(hitsB)) << 16);
+        while (mask != 0) {
+            if (!verify(at + static_cast<size_t>(__builtin_ctz(mask)))) {
+                pos = at;
+                return false;
+            }
+            mask &= mask - 1;
+        }
+    }
+    pos = at;
+    return true;
+}
+
+/**
+ * Internal: AVX2 variant of scanSse2, 64 positions per step.
+ */
+template <typename Verify>
+__attribute__((target("avx2"))) bool scanAvx2(const uint8_t* pairFirst, const uint8_t* pairSecond,
+                                              size_t pairCount, const uint8_t* data, size_t len, size_t& pos,
+                                              Verify& verify) {
+    __m256i first[MultiNeedleSearch::kMaxNeedles];
+    __m256i second[MultiNeedleSearch::kMaxNeedles];
+    for (size_t p = 0; p < pairCount; ++p) {
+        first[p] = _mm256_set1_epi8(static_cast<char>(pairFirst[p]));
+        second[p] = _mm256_set1_epi8(static_cast<char>(pairSecond[p]));
+    }
+    size_t at = pos;
+    for (; at + 65 <= len; at += 64) {
+        const __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at));
+        const __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at + 1));
+        const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at + 32));
+        const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at + 33));
+        __m256i hitsA = _mm256_setzero_si256();
+        __m256i hitsB = _mm256_setzero_si256();
+        for (size_t p = 0; p < pairCount; ++p) {
+            hitsA = _mm256_or_si256(
+                hitsA, _mm256_and_si256(_mm256_cmpeq_epi8(a0, first[p]), _mm256_cmpeq_epi8(a1, second[p])));
+            hitsB = _mm256_or_si256(
+                hitsB, _mm256_and_si256(_mm256_cmpeq_epi8(b0, first[p]), _mm256_cmpeq_epi8(b1, second[p])));
+        }
+        uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hitsA)) |
+                        (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hitsB))) << 32);
+        while (mask != 0) {
+            if (!verify(at + static_cast<size_t>(__builtin_ctzll(mask)))) {
+                pos = at;
+                return false;
+            }
+            mask &= mask - 1;
+        }
+    }
+    pos = at;
+    return true;
+}
+
+#endif
+
+MultiNeedleSearch::Engine detectBestEngine() {
+#if INGEST_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return MultiNeedleSearch::Engine::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return MultiNeedleSearch::Engine::Sse2;
+    }
+#endif
+    return MultiNeedleSearch::Engine::Scalar;
+}
+
+} // namespace (internal)
+
+MultiNeedleSearch::MultiNeedleSearch(initializer_list<string_view> needles) {
+    for (string_view needle : needles) {
+        needles_.emplace_back(needle);
+    }
+    compile();
+}
+
+MultiNeedleSearch::MultiNeedleSearch(const vector<string>& needles) : needles_(needles) {
+    compile();
+}
+
+void MultiNeedleSearch::compile() {
+    if (needles_.empty() || needles_.size() > kMaxNeedles) {
+        throw runtime_error("multi-needle search needs 1.." + to_string(kMaxNeedles) + " needles");
+    }
+    for (const string& needle : needles_) {
+        if (needle.size() < 2) {
+            throw runtime_error("multi-needle search needles must be at least two bytes");
+        }
+        maxLength_ = max(maxLength_, needle.size());
+        const uint8_t first = static_cast<uint8_t>(needle[0]);
+        const uint8_t second = static_cast<uint8_t>(needle[1]);
+        isFirstByte_[first] = 1;
+        bool seen = false;
+        for (size_t p = 0; p < pairCount_ && !seen; ++p) {
+            seen = pairFirst_[p] == first && pairSecond_[p] == second;
+        }
+        if (!seen) {
+            pairFirst_[pairCount_] = first;
+            pairSecond_[pairCount_] = second;
+            ++pairCount_;
+        }
+    }
+    engine_ = bestEngine();
+}
+
+MultiNeedleSearch::Engine MultiNeedleSearch::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool MultiNeedleSearch::engineSupported(Engine engine) {
+    return static_cast<int>(engine) <= static_cast<int>(bestEngine());
+}
+
+const char* MultiNeedleSearch::engineName(Engine engine) {
+    switch (engine) {
+    case Engine::Avx2:
+        return "avx2";
+    case Engine::Sse2:
+        return "sse2";
+    case Engine::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+void MultiNeedleSearch::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("multi-needle search engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+void MultiNeedleSearch::scan(const uint8_t* data, size_t len, MatchCallback callback, void* context) const {
+    if (len < 2) {
+        return;
+    }
+    auto verify = [&](size_t at) {
+        for (size_t n = 0; n < needles_.size(); ++n) {
+            const string& needle = needles_[n];
+            if (needle.size() <= len - at && memcmp(data + at, needle.data(), needle.size()) == 0 &&
+                !callback(context, n, at)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    size_t pos = 0;
+#if INGEST_SIMD_X86
+    if (engine_ == Engine::Avx2 &&
+        !scanAvx2(pairFirst_.data(), pairSecond_.data(), pairCount_, data, len, pos, verify)) {
+        return;
+    }
+    if (engine_ != Engine::Scalar &&
+        !scanSse2(pairFirst_.data(), pairSecond_.data(), pairCount_, data, len, pos, verify)) {
+        return;
+    }
+#endif
+    // Tail (and the whole buffer for the scalar engine). The last byte cannot
+    // start a needle of two or more bytes.
+    for (; pos + 1 < len; ++pos) {
+        if (isFirstByte_[data[pos]] && !verify(pos)) {
+            return;
+        }
+    }
+}
+
+uint32_t MultiNeedleSearch::findAll(const uint8_t* data, size_t len) const {
+    const uint32_t all = (1u << needles_.size()) - 1;
+    uint32_t found = 0;
+    forEachMatch(data, len, [&](size_t needle, size_t) {
+        found |= 1u << needle;
+        return found != all;
+    });
+    return found;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Single-pass search for a small set of needles (up to kMaxNeedles, each at
+ * least two bytes long). Candidate positions are found by comparing every
+ * input position against each needle's first two bytes at once — 64 positions
+ * per step with AVX2, 32 with SSE2, one at a time in the portable fallback —
+ * and only candidates are verified in full. The widest engine the CPU supports
+ * is picked at runtime.
+ *
+ * Only matches lying wholly inside the given buffer are reported; callers
+ * streaming across chunk boundaries must re-present the seam themselves.
+ */
+class MultiNeedleSearch {
+public:
+    static constexpr std::size_t kMaxNeedles = 16;
+
+    enum class Engine {
+        Scalar,
+        Sse2,
+        Avx2,
+    };
+
+    /**
+     * Throws std::runtime_error if there are no needles, too many, or one shorter than two bytes.
+     */
+    MultiNeedleSearch(std::initializer_list<std::string_view> needles);
+    explicit MultiNeedleSearch(const std::vector<std::string>& needles);
+
+    std::size_t size() const { return needles_.size(); }
+    const std::string& needle(std::size_t index) const { return needles_[index]; }
+
+    /**
+     * Length of the longest needle; a seam of maxNeedleLength() - 1 bytes
+     * suffices to catch matches straddling two chunks.
+     */
+    std::size_t maxNeedleLength() const { return maxLength_; }
+
+    /**
+     * Returns a bitmask with bit i set when needle i occurs anywhere in the buffer.
+     * Stops early once every needle has been seen.
+     */
+    std::uint32_t findAll(const std::uint8_t* data, std::size_t len) const;
+
+    /**
+     * Calls fn(needleIndex, offset) for every occurrence in ascending offset
+     * order (ties in needle order); fn returns false to stop the scan.
+     */
+    template <typename Fn>
+    void forEachMatch(const std::uint8_t* data, std::size_t len, Fn&& fn) const {
+        scan(data, len,
+             [](void* context, std::size_t needle, std::size_t offset) {
+                 return static_cast<bool>((*static_cast<std::remove_reference_t<Fn>*>(context))(needle, offset));
+             },
+             &fn);
+    }
+
+    /**
+     * The widest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    Engine engine() const { return engine_; }
+
+    /**
+     * Pins this searcher to a specific engine, e.g. to cross-check engines in
+     * tests and benchmarks. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+private:
+    using MatchCallback = bool (*)(void* context, std::size_t needle, std::size_t offset);
+
+    void compile();
+    void scan(const std::uint8_t* data, std::size_t len, MatchCallback callback, void* context) const;
+
+    std::vector<std::string> needles_;
+    std::size_t maxLength_ = 0;
+    Engine engine_ = Engine::Scalar;
+    // Distinct leading byte pairs, compared against the input in bulk.
+    std::size_t pairCount_ = 0;
+    std::array<std::uint8_t, kMaxNeedles> pairFirst_{};
+    std::array<std::uint8_t, kMaxNeedles> pairSecond_{};
+    // Non-zero for bytes that start some needle; drives the scalar engine.
+    std::array<std::uint8_t, 256> isFirstByte_{};
+};
@@ -0,0 +1,217 @@
+#include "tlsh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+// TLSH's Pearson permutation.
+constexpr uint8_t kPearson[256] = {
+    1,   87,  49,  12,  176, 178, 102, 166, 121, 193, 6,   84,  249, 230, 44,  163, 14,  197, 213, 181, 161, 85,
+    218, 80,  64,  239, 24,  226, 236, 142, 38,  200, 110, 177, 104, 103, 141, 253, 255, 50,  77,  101, 81,  18,
+    45,  96,  31,  222, 25,  107, 190, 70,  86,  237, 240, 34,  72,  242, 20,  214, 244, 227, 149, 235, 97,  234,
+    57,  22,  60,  250, 82,  175, 208, 5,   127, 199, 111, 62,  135, 248, 174, 169, 211, 58,  66,  154, 106, 195,
+    245, 171, 17,  187, 182, 179, 0,   243, 132, 56,  148, 75,  128, 133, 158, 100, 130, 126, 91,  13,  153, 246,
+    216, 219, 119, 68,  223, 78,  83,  88,  201, 99,  122, 11,  92,  32,  136, 114, 52,  10,  138, 30,  48,  183,
+    156, 35,  61,  26,  143, 74,  251, 94,  129, 162, 63,  152, 170, 7,   115, 167, 241, 206, 3,   150, 55,  59,
+    151, 220, 90,  53,  23,  131, 125, 173, 15,  238, 79,  95,  89,  16,  105, 137, 225, 224, 217, 160, 37,  123,
+    118, 73,  2,   157, 46,  116, 9,   145, 134, 228, 207, 212, 202, 215, 69,  229, 27,  188, 67,  124, 168, 252,
+    42,  4,   29,  108, 21,  247, 19,  205, 39,  203, 233, 40,  186, 147, 198, 192, 155, 33,  164, 191, 98,  204,
+    165, 180, 117, 76,  140, 36,  210, 172, 41,  54,  159, 8,   185, 232, 113, 196, 231, 47,  146, 120, 51,  65,
+    28,  144, 254, 221, 93,  189, 194, 139, 112, 43,  71,  109, 184, 209};
+
+constexpr size_t kBuckets = 128;
+constexpr size_t kCodeSize = kBuckets / 4;
+
+/**
+ * Internal: Pearson hash of a salt and three bytes; the salt's first step is
+ * folded into the caller's constant.
+ */
+inline uint8_t pearson(uint8_t saltStep, uint8_t a, uint8_t b, uint8_t c) {
+    return kPearson[kPearson[kPearson[saltStep ^ a] ^ b] ^ c];
+}
+
+uint8_t lengthCapture(uint64_t len) {
+    const double l = log(static_cast<double>(len));
+    double value;
+    if (len <= 656) {
+        value = l / log(1.5);
+    } else if (len <= 3199) {
+        value = l / log(1.3) - 8.72777;
+    } else {
+        value = l / log(1.1) - 62.5472;
+    }
+    return static_cast<uint8_t>(static_cast<int64_t>(floor(value)) & 0xFF);
+}
+
+uint8_t swapNibbles(uint8_t value) {
+    return static_cast<uint8_t>((value << 4) | (value >> 4));
+}
+
+/**
+ * Internal: distance on a circle of range values.
+ */
+int modDiff(int x, int y, int range) {
+    const int d = abs(x - y);
+    return min(d, range - d);
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace (internal)
+
+string TlshDigest::hex() const {
+    if (!valid) {
+        return string();
+    }
+    static const char kDigits[] = "0123456789ABCDEF";
+    array<uint8_t, 3 + kCodeSize> bytes;
+    bytes[0] = swapNibbles(checksum);
+    bytes[1] = swapNibbles(lvalue);
+    bytes[2] = static_cast<uint8_t>((q1Ratio << 4) | q2Ratio);
+    copy(code.begin(), code.end(), bytes.begin() + 3);
+    string out = "T1";
+    for (uint8_t b : bytes) {
+        out += kDigits[b >> 4];
+        out += kDigits[b & 0xF];
+    }
+    return out;
+}
+
+bool TlshDigest::fromHex(string_view text, TlshDigest& out) {
+    if (text.size() >= 2 && (text[0] == 'T' || text[0] == 't') && text[1] == '1') {
+        text.remove_prefix(2);
+    }
+    array<uint8_t, 3 + kCodeSize> bytes;
+    if (text.size() != 2 * bytes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        const int hi = hexValue(text[2 * i]);
+        const int lo = hexValue(text[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    out.valid = true;
+    out.checksum = swapNibbles(bytes[0]);
+    out.lvalue = swapNibbles(bytes[1]);
+    out.q1Ratio = bytes[2] >> 4;
+    out.q2Ratio = bytes[2] & 0xF;
+    copy(bytes.begin() + 3, bytes.end(), out.code.begin());
+    return true;
+}
+
+bool TlshDigest::operator==(const TlshDigest& other) const {
+    return valid == other.valid && checksum == other.checksum && lvalue == other.lvalue &&
+           q1Ratio == other.q1Ratio && q2Ratio == other.q2Ratio && code == other.code;
+}
+
+int tlshDistance(const TlshDigest& a, const TlshDigest& b, bool includeLength) {
+    int diff = 0;
+    if (includeLength) {
+        const int ldiff = modDiff(a.lvalue, b.lvalue, 256);
+        diff += ldiff <= 1 ? ldiff : ldiff * 12;
+    }
+    for (const auto& ratios : {make_pair(a.q1Ratio, b.q1Ratio), make_pair(a.q2Ratio, b.q2Ratio)}) {
+        const int qdiff = modDiff(ratios.first, ratios.second, 16);
+        diff += qdiff <= 1 ? qdiff : (qdiff - 1) * 12;
+    }
+    if (a.checksum != b.checksum) {
+        diff += 1;
+    }
+    // Buckets two quartiles apart count 2; opposite quartiles count 6, not 3.
+    for (size_t i = 0; i < a.code.size(); ++i) {
+        for (int shift = 0; shift < 8; shift += 2) {
+            const int d = abs(((a.code[i] >> shift) & 3) - ((b.code[i] >> shift) & 3));
+            diff += d == 3 ? 6 : d;
+        }
+    }
+    return diff;
+}
+
+void Tlsh::update(const uint8_t* data, size_t len) {
+    // Salts 2, 3, 5, 7, 11 and 13 pick the six triplets; 0 drives the checksum.
+    const uint8_t s0 = kPearson[0], s2 = kPearson[2], s3 = kPearson[3], s5 = kPearson[5], s7 = kPearson[7],
+                  s11 = kPearson[11], s13 = kPearson[13];
+    uint8_t w1 = window_[0], w2 = window_[1], w3 = window_[2], w4 = window_[3];
+    uint8_t checksum = checksum_;
+    uint32_t* buckets = buckets_.data();
+    size_t i = 0;
+    // The window fills over the first four bytes of the input.
+    for (; i < len && length_ + i < 4; ++i) {
+        w4 = w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = data[i];
+    }
+    for (; i < len; ++i) {
+        const uint8_t b = data[i];
+        checksum = pearson(s0, b, w1, checksum);
+        ++buckets[pearson(s2, b, w1, w2)];
+        ++buckets[pearson(s3, b, w1, w3)];
+        ++buckets[pearson(s5, b, w2, w3)];
+        ++buckets[pearson(s7, b, w2, w4)];
+        ++buckets[pearson(s11, b, w1, w4)];
+        ++buckets[pearson(s13, b, w3, w4)];
+        w4 = w3;
+        w3 = w2;
+        w2 = w1;
+        w1 = b;
+    }
+    window_[0] = w1;
+    window_[1] = w2;
+    window_[2] = w3;
+    window_[3] = w4;
+    checksum_ = checksum;
+    length_ += len;
+}
+
+TlshDigest Tlsh::finish() const {
+    TlshDigest digest;
+    if (length_ < kMinLength) {
+        return digest;
+    }
+    array<uint32_t, kBuckets> sorted;
+    copy(buckets_.begin(), buckets_.begin() + kBuckets, sorted.begin());
+    const size_t quarter = kBuckets / 4;
+    nth_element(sorted.begin(), sorted.begin() + (quarter - 1), sorted.end());
+    const uint64_t q1 = sorted[quarter - 1];
+    nth_element(sorted.begin() + quarter, sorted.begin() + (2 * quarter - 1), sorted.end());
+    const uint64_t q2 = sorted[2 * quarter - 1];
+    nth_element(sorted.begin() + 2 * quarter, sorted.begin() + (3 * quarter - 1), sorted.end());
+    const uint64_t q3 = sorted[3 * quarter - 1];
+    const size_t nonZero = static_cast<size_t>(
+        count_if(buckets_.begin(), buckets_.begin() + kBuckets, [](uint32_t count) { return count != 0; }));
+    if (q3 == 0 || nonZero <= kBuckets / 2) {
+        return digest;
+    }
+    for (size_t i = 0; i < kCodeSize; ++i) {
+        uint8_t packed = 0;
+        for (size_t j = 0; j < 4; ++j) {
+            const uint32_t k = buckets_[4 * i + j];
+            const uint8_t quartile = k > q3 ? 3 : k > q2 ? 2 : k > q1 ? 1 : 0;
+            packed |= static_cast<uint8_t>(quartile << (2 * j));
+        }
+        digest.code[kCodeSize - 1 - i] = packed;
+    }
+    digest.valid = true;
+    digest.checksum = checksum_;
+    digest.lvalue = lengthCapture(length_);
+    digest.q1Ratio = static_cast<uint8_t>((q1 * 100 / q3) % 16);
+    digest.q2Ratio = static_cast<uint8_t>((q2 * 100 / q3) % 16);
+    return digest;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * A TLSH digest (128 buckets, 1-byte checksum). Invalid for inputs that are
+ * too short or too uniform to be characterized.
+ */
+struct TlshDigest {
+    bool valid = false;
+    std::uint8_t checksum = 0;
+    std::uint8_t lvalue = 0; // log-scaled input length
+    std::uint8_t q1Ratio = 0;
+    std::uint8_t q2Ratio = 0;
+    std::array<std::uint8_t, 32> code{}; // two bits per bucket, in TLSH's (reversed) byte order
+
+    /**
+     * The "T1" + 70 hex digit form; empty when not valid.
+     */
+    std::string hex() const;
+
+    /**
+     * Parses hex()'s output (the "T1" prefix is optional). Returns false if it is malformed.
+     */
+    static bool fromHex(std::string_view text, TlshDigest& out);
+
+    bool operator==(const TlshDigest& other) const;
+    bool operator!=(const TlshDigest& other) const { return !(*this == other); }
+};
+
+/**
+ * TLSH distance between two valid digests: 0 for identical ones, growing as
+ * the inputs diverge; under roughly 50 usually means near-duplicates. With
+ * includeLength false, a difference in input length is not counted.
+ */
+int tlshDistance(const TlshDigest& a, const TlshDigest& b, bool includeLength = true);
+
+/**
+ * Incremental TLSH (Oliver, Cheng and Chen, "TLSH - A Locality Sensitive
+ * Hash", 2013), a fuzzy hash for clustering similar files. A 5-byte window
+ * slides over the input; six of its byte triplets are Pearson-hashed into
+ * 128 buckets, and the digest records each bucket's quartile, so files that
+ * share most of their content produce digests a small distance apart.
+ */
+class Tlsh {
+public:
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * The digest of the bytes fed so far; invalid under kMinLength bytes or
+     * when fewer than half the buckets were hit.
+     */
+    TlshDigest finish() const;
+
+    static constexpr std::uint64_t kMinLength = 50;
+
+private:
+    std::array<std::uint32_t, 256> buckets_{}; // Pearson output is a byte; only the first 128 are used
+    std::uint8_t window_[4] = {};               // the previous four bytes, newest first
+    std::uint8_t checksum_ = 0;
+    std::uint64_t length_ = 0;
+};
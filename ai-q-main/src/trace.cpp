@@ -0,0 +1,234 @@
+#include "trace.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kRingCapacity = 4096;
+constexpr size_t kMimeCapacity = 80;
+constexpr size_t kMimeWords = kMimeCapacity / sizeof(uint64_t);
+static_assert(kMimeCapacity % sizeof(uint64_t) == 0, "mime is stored as whole words");
+
+/**
+ * One recorded event, as the dumper copies it out. Fixed-size so recording
+ * never allocates.
+ */
+struct TraceEvent {
+    const char* stage;
+    char phase;
+    uint64_t timestampNanos;
+    uint64_t uploadId;
+    int64_t size;
+    char mime[kMimeCapacity];
+};
+
+/**
+ * A ring slot guarded by a seqlock. seq is odd while the owner writes and
+ * 2 * (index + 1) once it holds logical event `index`, so a reader can tell
+ * both a torn copy and an event the writer has since lapped. The fields are
+ * relaxed atomics: readers race with the writer by design, and the sequence
+ * check decides afterwards whether the copy counts.
+ */
+struct TraceSlot {
+    atomic<uint64_t> seq{0};
+    atomic<const char*> stage{nullptr};
+    atomic<char> phase{0};
+    atomic<uint64_t> timestampNanos{0};
+    atomic<uint64_t> uploadId{0};
+    atomic<int64_t> size{0};
+    array<atomic<uint64_t>, kMimeWords> mime{};
+};
+
+/**
+ * Per-thread event ring. Only the owning thread writes; head counts the events
+ * recorded so far and bounds which slots a dumper looks at.
+ */
+struct ThreadRing {
+    explicit ThreadRing(uint32_t tidValue) : tid(tidValue) {}
+
+    uint32_t tid;
+    atomic<uint64_t> head{0};
+    array<TraceSlot, kRingCapacity> slots{};
+};
+
+atomic<bool> gTracingEnabled{false};
+atomic<uint64_t> gNextUploadId{1};
+
+mutex gRegistryMutex;
+vector<shared_ptr<ThreadRing>> gRings;
+
+const chrono::steady_clock::time_point gEpoch = chrono::steady_clock::now();
+
+/**
+ * The calling thread's ring, registered on first use. The registry keeps rings
+ * alive after their thread exits so late dumps still see those events.
+ */
+ThreadRing& localRing() {
+    thread_local shared_ptr<ThreadRing> ring = [] {
+        lock_guard<mutex> lock(gRegistryMutex);
+        auto created = make_shared<ThreadRing>(static_cast<uint32_t>(gRings.size() + 1));
+        gRings.push_back(created);
+        return created;
+    }();
+    return *ring;
+}
+
+void record(const char* stage, char phase, uint64_t uploadId, int64_t size, const char* mime) {
+    ThreadRing& ring = localRing();
+    uint64_t index = ring.head.load(memory_order_relaxed);
+    TraceSlot& slot = ring.slots[index % kRingCapacity];
+    char text[kMimeCapacity] = {};
+    if (mime != nullptr) {
+        strncpy(text, mime, kMimeCapacity - 1);
+    }
+    // Mark the slot busy before touching the fields; the fence keeps the field
+    // stores from moving above the odd sequence.
+    slot.seq.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.stage.store(stage, memory_order_relaxed);
+    slot.phase.store(phase, memory_order_relaxed);
+    slot.timestampNanos.store(
+        static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - gEpoch).count()),
+        memory_order_relaxed);
+    slot.uploadId.store(uploadId, memory_order_relaxed);
+    slot.size.store(size, memory_order_relaxed);
+    for (size_t w = 0; w < kMimeWords; ++w) {
+        uint64_t word;
+        memcpy(&word, text + w * sizeof(word), sizeof(word));
+        slot.mime[w].store(word, memory_order_relaxed);
+    }
+    slot.seq.store(2 * index + 2, memory_order_release);
+    ring.head.store(index + 1, memory_order_release);
+}
+
+/**
+ * Copies logical event `index` out of its slot. False when the slot is being
+ * written, holds another event, or changed during the copy.
+ */
+bool readSlot(const TraceSlot& slot, uint64_t index, TraceEvent& event) {
+    const uint64_t expected = 2 * index + 2;
+    if (slot.seq.load(memory_order_acquire) != expected) {
+        return false;
+    }
+    event.stage = slot.stage.load(memory_order_relaxed);
+    event.phase = slot.phase.load(memory_order_relaxed);
+    event.timestampNanos = slot.timestampNanos.load(memory_order_relaxed);
+    event.uploadId = slot.uploadId.load(memory_order_relaxed);
+    event.size = slot.size.load(memory_order_relaxed);
+    for (size_t w = 0; w < kMimeWords; ++w) {
+        const uint64_t word = slot.mime[w].load(memory_order_relaxed);
+        memcpy(event.mime + w * sizeof(word), &word, sizeof(word));
+    }
+    event.mime[kMimeCapacity - 1] = '\0';
+    // Keeps the field loads above from sinking below the re-check.
+    atomic_thread_fence(memory_order_acquire);
+    return slot.seq.load(memory_order_relaxed) == expected;
+}
+
+void writeJsonString(ostream& out, const char* text) {
+    out << '"';
+    for (const char* p = text; *p != '\0'; ++p) {
+        char ch = *p;
+        if (ch == '"' || ch == '\\') {
+            out << '\\' << ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            out << ' ';
+        } else {
+            out << ch;
+        }
+    }
+    out << '"';
+}
+
+void writeEvent(ostream& out, const TraceEvent& event, uint32_t tid) {
+    out << "{\"name\":";
+    writeJsonString(out, event.stage);
+    out << ",\"cat\":\"ingest\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << tid
+        << ",\"ts\":" << event.timestampNanos / 1000 << '.';
+    uint64_t fraction = event.timestampNanos % 1000;
+    out << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + (fraction / 10) % 10)
+        << static_cast<char>('0' + fraction % 10);
+    out << ",\"args\":{\"upload\":" << event.uploadId;
+    if (event.size >= 0) {
+        out << ",\"size\":" << event.size;
+    }
+    if (event.mime[0] != '\0') {
+        out << ",\"mime\":";
+        writeJsonString(out, event.mime);
+    }
+    out << "}}";
+}
+
+} // namespace (internal)
+
+void setTracingEnabled(bool enabled) {
+    gTracingEnabled.store(enabled, memory_order_relaxed);
+}
+
+bool tracingEnabled() {
+    return gTracingEnabled.load(memory_order_relaxed);
+}
+
+uint64_t nextTraceUploadId() {
+    return gNextUploadId.fetch_add(1, memory_order_relaxed);
+}
+
+void dumpChromeTrace(ostream& out) {
+    vector<shared_ptr<ThreadRing>> rings;
+    {
+        lock_guard<mutex> lock(gRegistryMutex);
+        rings = gRings;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    TraceEvent event;
+    for (const auto& ring : rings) {
+        uint64_t end = ring->head.load(memory_order_acquire);
+        uint64_t begin = end > kRingCapacity ? end - kRingCapacity : 0;
+        for (uint64_t i = begin; i < end; ++i) {
+            // Events the writer lapped while we were dumping fail the check; drop them.
+            if (!readSlot(ring->slots[i % kRingCapacity], i, event)) {
+                continue;
+            }
+            if (!first) {
+                out << ',';
+            }
+            first = false;
+            writeEvent(out, event, ring->tid);
+        }
+    }
+    out << "]}\n";
+}
+
+void traceReset() {
+    lock_guard<mutex> lock(gRegistryMutex);
+    for (auto& ring : gRings) {
+        ring->head.store(0, memory_order_release);
+    }
+}
+
+// --------------- TraceScope ---------------
+
+TraceScope::TraceScope(const char* stage, uint64_t uploadId, int64_t size)
+    : stage_(stage), uploadId_(uploadId), size_(size), active_(tracingEnabled()) {
+    if (active_) {
+        record(stage_, 'B', uploadId_, size_, nullptr);
+    }
+}
+
+TraceScope::~TraceScope() {
+    if (active_) {
+        record(stage_, 'E', uploadId_, size_, mime_);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Opt-in stage tracing for ingest. Each thread records begin/end events into
+ * its own fixed-size ring (single writer, no locks on the hot path); the rings
+ * can be dumped at any time as Chrome trace-event JSON, which both
+ * chrome://tracing and Perfetto load directly.
+ */
+
+/**
+ * Turns event recording on or off process-wide. Off by default.
+ */
+void setTracingEnabled(bool enabled);
+
+bool tracingEnabled();
+
+/**
+ * Returns a process-unique id used to correlate the stages of one upload.
+ */
+std::uint64_t nextTraceUploadId();
+
+/**
+ * Writes every retained event as a Chrome trace-event JSON document.
+ * Events overwritten while the dump runs are skipped rather than emitted torn.
+ */
+void dumpChromeTrace(std::ostream& out);
+
+/**
+ * Discards all retained events. Intended for tests.
+ */
+void traceReset();
+
+/**
+ * RAII stage marker: records a begin event on construction and an end event on
+ * destruction. Size and MIME may be filled in before the scope closes; they are
+ * attached to the end event. Does nothing while tracing is disabled.
+ */
+class TraceScope {
+public:
+    TraceScope(const char* stage, std::uint64_t uploadId, std::int64_t size = -1);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void setSize(std::int64_t size) { size_ = size; }
+    void setMime(const char* mime) { mime_ = mime; }
+
+private:
+    const char* stage_;
+    std::uint64_t uploadId_;
+    std::int64_t size_;
+    const char* mime_ = nullptr;
+    bool active_;
+};
@@ -0,0 +1,257 @@
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_UTF8_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_UTF8_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+#if INGEST_UTF8_X86
+
+// Error classes of a (previous byte, byte) pair; a pair is invalid when all
+// three lookups agree on some class.
+constexpr uint8_t kTooShort = 1 << 0;    // lead not followed by a continuation
+constexpr uint8_t kTooLong = 1 << 1;     // ASCII followed by a continuation
+constexpr uint8_t kOverlong3 = 1 << 2;   // E0 80..9F
+constexpr uint8_t kTooLarge = 1 << 3;    // F4 90..BF, F5..FF
+constexpr uint8_t kSurrogate = 1 << 4;   // ED A0..BF
+constexpr uint8_t kOverlong2 = 1 << 5;   // C0, C1
+constexpr uint8_t kTooLarge1000 = 1 << 6; // F5..FF 80..8F
+constexpr uint8_t kOverlong4 = 1 << 6;   // F0 80..8F
+constexpr uint8_t kTwoConts = 1 << 7;    // continuation after continuation, legal only inside 3- and 4-byte characters
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+__attribute__((target("avx2"))) inline __m256i table16(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3,
+                                                          uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+                                                          uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11,
+                                                          uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15) {
+    return _mm256_setr_epi8(static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2),
+                            static_cast<char>(b3), static_cast<char>(b4), static_cast<char>(b5),
+                            static_cast<char>(b6), static_cast<char>(b7), static_cast<char>(b8),
+                            static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+                            static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14),
+                            static_cast<char>(b15), static_cast<char>(b0), static_cast<char>(b1),
+                            static_cast<char>(b2), static_cast<char>(b3), static_cast<char>(b4),
+                            static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+                            static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10),
+                            static_cast<char>(b11), static_cast<char>(b12), static_cast<char>(b13),
+                            static_cast<char>(b14), static_cast<char>(b15));
+}
+
+/**
+ * Internal: validates whole 32-byte blocks starting on a character boundary.
+ * A character cut off by the end of the last block is not an error here; the
+ * caller re-checks it with whatever follows.
+ */
+__attribute__((target("avx2"))) bool validateBlocksAvx2(const uint8_t* data, size_t blocks) {
+    const __m256i byte1High = table16(kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+                                      kTooLong, kTwoConts, kTwoConts, kTwoConts, kTwoConts, kTooShort | kOverlong2,
+                                      kTooShort, kTooShort | kOverlong3 | kSurrogate,
+                                      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4);
+    const __m256i byte1Low = table16(
+        kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry, kCarry | kTooLarge,
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000 | kSurrogate, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000);
+    const __m256i byte2High = table16(
+        kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge, kTooShort, kTooShort, kTooShort, kTooShort);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    // Bytes at or above these in the last three positions start a character
+    // the block does not finish.
+    const __m256i incompleteMax = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    for (size_t b = 0; b < blocks; ++b, data += 32) {
+        const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        if (_mm256_movemask_epi8(input) == 0) {
+            // All ASCII: only a character left open by the previous block can be wrong.
+            error = _mm256_or_si256(error, prevIncomplete);
+            prev = input;
+            continue;
+        }
+        // The input shifted right by one to three bytes, pulling in the end of the previous block.
+        const __m256i carried = _mm256_permute2x128_si256(prev, input, 0x21);
+        const __m256i prev1 = _mm256_alignr_epi8(input, carried, 15);
+        const __m256i prev2 = _mm256_alignr_epi8(input, carried, 14);
+        const __m256i prev3 = _mm256_alignr_epi8(input, carried, 13);
+
+        const __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, nibble))),
+            _mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+        // Third and fourth bytes of 3- and 4-byte characters, where kTwoConts is expected rather than an error.
+        const __m256i expectContinuation =
+            _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+                                             _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80))),
+                             _mm256_set1_epi8(static_cast<char>(0x80)));
+        error = _mm256_or_si256(error, _mm256_xor_si256(special, expectContinuation));
+        prevIncomplete = _mm256_subs_epu8(input, incompleteMax);
+        prev = input;
+    }
+    return _mm256_testz_si256(error, error) != 0;
+}
+
+#endif
+
+/**
+ * Internal: where a character cut off by the end of [begin, end) starts, or
+ * end when the range ends on a character boundary.
+ */
+size_t resumePoint(const uint8_t* data, size_t begin, size_t end) {
+    for (size_t k = 1; k <= 3 && end - k >= begin; ++k) {
+        const uint8_t b = data[end - k];
+        if ((b & 0xC0) != 0x80) {
+            const size_t length = b >= 0xF0 ? 4 : b >= 0xE0 ? 3 : b >= 0xC0 ? 2 : 1;
+            return length > k ? end - k : end;
+        }
+    }
+    return end;
+}
+
+Utf8Validator::Engine detectBestEngine() {
+#if INGEST_UTF8_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Utf8Validator::Engine::Avx2;
+    }
+#endif
+    return Utf8Validator::Engine::Scalar;
+}
+
+} // namespace (internal)
+
+Utf8Validator::Engine Utf8Validator::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool Utf8Validator::engineSupported(Engine engine) {
+    return engine == Engine::Scalar || bestEngine() == Engine::Avx2;
+}
+
+const char* Utf8Validator::engineName(Engine engine) {
+    return engine == Engine::Avx2 ? "avx2" : "scalar";
+}
+
+void Utf8Validator::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("utf8 engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+Utf8Validator::Utf8Validator() : engine_(bestEngine()) {}
+
+void Utf8Validator::update(const uint8_t* data, size_t len) {
+    if (failed_) {
+        return;
+    }
+#if INGEST_UTF8_X86
+    if (engine_ == Engine::Avx2) {
+        // Finish the character left open by the previous piece, so the blocks
+        // start on a boundary.
+        const size_t head = min<size_t>(need_, len);
+        updateScalar(data, head);
+        const size_t blocks = (len - head) / 32;
+        if (failed_ || blocks == 0) {
+            updateScalar(data + head, len - head);
+            return;
+        }
+        const size_t end = head + 32 * blocks;
+        if (!validateBlocksAvx2(data + head, blocks)) {
+            failed_ = true;
+            return;
+        }
+        const size_t resume = resumePoint(data, head, end);
+        updateScalar(data + resume, len - resume);
+        return;
+    }
+#endif
+    updateScalar(data, len);
+}
+
+void Utf8Validator::updateScalar(const uint8_t* data, size_t len) {
+    uint8_t need = need_, lo = lo_, hi = hi_;
+    size_t i = 0;
+    while (i < len && !failed_) {
+        if (need == 0) {
+            for (; i + 8 <= len; i += 8) {
+                uint64_t v;
+                memcpy(&v, data + i, sizeof(v));
+                if ((v & kHighBits) != 0) {
+                    break;
+                }
+            }
+            if (i == len) {
+                break;
+            }
+            const uint8_t b = data[i++];
+            if (b < 0x80) {
+                continue;
+            }
+            lo = 0x80;
+            hi = 0xBF;
+            if (b >= 0xC2 && b <= 0xDF) {
+                need = 1;
+            } else if (b >= 0xE0 && b <= 0xEF) {
+                need = 2;
+                if (b == 0xE0) {
+                    lo = 0xA0; // overlong
+                } else if (b == 0xED) {
+                    hi = 0x9F; // surrogates
+                }
+            } else if (b >= 0xF0 && b <= 0xF4) {
+                need = 3;
+                if (b == 0xF0) {
+                    lo = 0x90; // overlong
+                } else if (b == 0xF4) {
+                    hi = 0x8F; // past U+10FFFF
+                }
+            } else {
+                failed_ = true;
+            }
+        } else {
+            const uint8_t b = data[i++];
+            if (b < lo || b > hi) {
+                failed_ = true;
+            } else {
+                --need;
+                lo = 0x80;
+                hi = 0xBF;
+            }
+        }
+    }
+    need_ = need;
+    lo_ = lo;
+    hi_ = hi;
+}
+
+bool isValidUtf8(const uint8_t* data, size_t len) {
+    Utf8Validator validator;
+    validator.update(data, len);
+    return validator.valid();
+}
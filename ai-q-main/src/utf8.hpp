@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Streaming UTF-8 validation (RFC 3629: no overlong forms, surrogates or code
+ * points past U+10FFFF), fed in arbitrary pieces. The scalar engine is a
+ * byte-at-a-time state machine that skips ASCII eight bytes at a time. The
+ * AVX2 engine checks 32 bytes per step with the lookup algorithm of Keiser
+ * and Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte", 2021):
+ * three nibble-indexed table lookups classify each byte against its
+ * predecessor, so it runs near memory bandwidth on non-ASCII text too.
+ */
+class Utf8Validator {
+public:
+    enum class Engine {
+        Scalar,
+        Avx2,
+    };
+
+    Utf8Validator();
+
+    /**
+     * Once the input is known to be invalid, further updates return at once.
+     */
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Whether everything fed so far is valid UTF-8 and ends on a character
+     * boundary. Does not modify the validator.
+     */
+    bool valid() const { return !failed_ && need_ == 0; }
+
+    /**
+     * Set as soon as an invalid byte is seen; a truncated final character
+     * only shows in valid().
+     */
+    bool failed() const { return failed_; }
+
+    /**
+     * The widest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    /**
+     * Pins this validator to a specific engine. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+private:
+    void updateScalar(const std::uint8_t* data, std::size_t len);
+
+    Engine engine_;
+    bool failed_ = false;
+    // State between pieces: continuation bytes still owed by the current
+    // character, and the range the next one must fall in.
+    std::uint8_t need_ = 0;
+    std::uint8_t lo_ = 0x80;
+    std::uint8_t hi_ = 0xBF;
+};
+
+/**
+ * Whether a whole buffer is valid UTF-8, using the best engine.
+ */
+bool isValidUtf8(const std::uint8_t* data, std::size_t len);
@@ -0,0 +1,462 @@
+#include "xxh3.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INGEST_XXH3_X86 1
+#include <immintrin.h>
+#else
+#define INGEST_XXH3_X86 0
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr uint8_t kSecret[192] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+constexpr uint32_t kPrime32_1 = 0x9E3779B1u;
+constexpr uint32_t kPrime32_2 = 0x85EBCA77u;
+constexpr uint32_t kPrime32_3 = 0xC2B2AE3Du;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ull;
+constexpr uint64_t kPrimeMx1 = 0x165667919E3779F9ull;
+constexpr uint64_t kPrimeMx2 = 0x9FB21C651E98DF25ull;
+
+constexpr size_t kStripeLen = 64;
+constexpr size_t kSecretLimit = sizeof(kSecret) - kStripeLen; // offset of the scramble key
+constexpr size_t kStripesPerBlock = kSecretLimit / 8;           // the secret advances 8 bytes per stripe
+constexpr size_t kLastStripeSecret = kSecretLimit - 7;
+constexpr size_t kMergeSecret = 11;
+constexpr size_t kMidsizeMax = 240;
+
+inline uint32_t readLe32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+inline uint64_t readLe64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline uint64_t rotl64(uint64_t x, unsigned n) {
+    return (x << n) | (x >> (64 - n));
+}
+
+inline uint32_t rotl32(uint32_t x, unsigned n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+inline Xxh128Hash multiply128(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+    return Xxh128Hash{static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+    const uint64_t loLo = (lhs & 0xFFFFFFFFu) * (rhs & 0xFFFFFFFFu);
+    const uint64_t hiLo = (lhs >> 32) * (rhs & 0xFFFFFFFFu);
+    const uint64_t loHi = (lhs & 0xFFFFFFFFu) * (rhs >> 32);
+    const uint64_t hiHi = (lhs >> 32) * (rhs >> 32);
+    const uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFFu) + loHi;
+    return Xxh128Hash{(cross << 32) | (loLo & 0xFFFFFFFFu), (hiLo >> 32) + (cross >> 32) + hiHi};
+#endif
+}
+
+inline uint64_t multiplyFold64(uint64_t lhs, uint64_t rhs) {
+    const Xxh128Hash product = multiply128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+uint64_t xxh64Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    return h ^ (h >> 32);
+}
+
+uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= kPrimeMx1;
+    return h ^ (h >> 32);
+}
+
+uint64_t rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= kPrimeMx2;
+    h ^= (h >> 35) + len;
+    h *= kPrimeMx2;
+    return h ^ (h >> 28);
+}
+
+uint64_t mix16(const uint8_t* input, const uint8_t* secret) {
+    return multiplyFold64(readLe64(input) ^ readLe64(secret), readLe64(input + 8) ^ readLe64(secret + 8));
+}
+
+Xxh128Hash mix32(Xxh128Hash acc, const uint8_t* input1, const uint8_t* input2, const uint8_t* secret) {
+    acc.low += mix16(input1, secret);
+    acc.low ^= readLe64(input2) + readLe64(input2 + 8);
+    acc.high += mix16(input2, secret + 16);
+    acc.high ^= readLe64(input1) + readLe64(input1 + 8);
+    return acc;
+}
+
+// ---- Inputs of at most kMidsizeMax bytes: hashed whole, without accumulators ----
+
+uint64_t hashShort64(const uint8_t* input, size_t len) {
+    const uint8_t* s = kSecret;
+    if (len == 0) {
+        return xxh64Avalanche(readLe64(s + 56) ^ readLe64(s + 64));
+    }
+    if (len <= 3) {
+        const uint32_t combined = (static_cast<uint32_t>(input[0]) << 16) |
+                                  (static_cast<uint32_t>(input[len >> 1]) << 24) |
+                                  static_cast<uint32_t>(input[len - 1]) | (static_cast<uint32_t>(len) << 8);
+        return xxh64Avalanche(combined ^ static_cast<uint64_t>(readLe32(s) ^ readLe32(s + 4)));
+    }
+    if (len <= 8) {
+        const uint64_t input64 = readLe32(input + len - 4) + (static_cast<uint64_t>(readLe32(input)) << 32);
+        return rrmxmx(input64 ^ (readLe64(s + 8) ^ readLe64(s + 16)), len);
+    }
+    if (len <= 16) {
+        const uint64_t lo = readLe64(input) ^ (readLe64(s + 24) ^ readLe64(s + 32));
+        const uint64_t hi = readLe64(input + len - 8) ^ (readLe64(s + 40) ^ readLe64(s + 48));
+        return avalanche(len + __builtin_bswap64(lo) + hi + multiplyFold64(lo, hi));
+    }
+    uint64_t acc = len * kPrime64_1;
+    if (len <= 128) {
+        // Pairs of 16-byte blocks from both ends, meeting in the middle.
+        for (size_t i = 0; i <= (len - 1) / 32; ++i) {
+            acc += mix16(input + 16 * i, s + 32 * i);
+            acc += mix16(input + len - 16 * (i + 1), s + 32 * i + 16);
+        }
+        return avalanche(acc);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        acc += mix16(input + 16 * i, s + 16 * i);
+    }
+    acc = avalanche(acc);
+    uint64_t tail = mix16(input + len - 16, s + 136 - 17);
+    for (size_t i = 8; i < len / 16; ++i) {
+        tail += mix16(input + 16 * i, s + 16 * (i - 8) + 3);
+    }
+    return avalanche(acc + tail);
+}
+
+Xxh128Hash finish128(Xxh128Hash acc, size_t len) {
+    Xxh128Hash h;
+    h.low = avalanche(acc.low + acc.high);
+    h.high = 0 - avalanche(acc.low * kPrime64_1 + acc.high * kPrime64_4 + len * kPrime64_2);
+    return h;
+}
+
+Xxh128Hash hashShort128(const uint8_t* input, size_t len) {
+    const uint8_t* s = kSecret;
+    if (len == 0) {
+        return Xxh128Hash{xxh64Avalanche(readLe64(s + 64) ^ readLe64(s + 72)),
+                          xxh64Avalanche(readLe64(s + 80) ^ readLe64(s + 88))};
+    }
+    if (len <= 3) {
+        const uint32_t combinedLow = (static_cast<uint32_t>(input[0]) << 16) |
+                                     (static_cast<uint32_t>(input[len >> 1]) << 24) |
+                                     static_cast<uint32_t>(input[len - 1]) | (static_cast<uint32_t>(len) << 8);
+        const uint32_t combinedHigh = rotl32(__builtin_bswap32(combinedLow), 13);
+        return Xxh128Hash{xxh64Avalanche(combinedLow ^ static_cast<uint64_t>(readLe32(s) ^ readLe32(s + 4))),
+                          xxh64Avalanche(combinedHigh ^ static_cast<uint64_t>(readLe32(s + 8) ^ readLe32(s + 12)))};
+    }
+    if (len <= 8) {
+        const uint64_t input64 = readLe32(input) + (static_cast<uint64_t>(readLe32(input + len - 4)) << 32);
+        Xxh128Hash m = multiply128(input64 ^ (readLe64(s + 16) ^ readLe64(s + 24)), kPrime64_1 + (len << 2));
+        m.high += m.low << 1;
+        m.low ^= m.high >> 3;
+        m.low ^= m.low >> 35;
+        m.low *= kPrimeMx2;
+        m.low ^= m.low >> 28;
+        m.high = avalanche(m.high);
+        return m;
+    }
+    if (len <= 16) {
+        const uint64_t lo = readLe64(input);
+        const uint64_t hi = readLe64(input + len - 8) ^ (readLe64(s + 48) ^ readLe64(s + 56));
+        Xxh128Hash m = multiply128(lo ^ readLe64(input + len - 8) ^ (readLe64(s + 32) ^ readLe64(s + 40)), kPrime64_1);
+        m.low += static_cast<uint64_t>(len - 1) << 54;
+        m.high += hi + static_cast<uint64_t>(static_cast<uint32_t>(hi)) * (kPrime32_2 - 1);
+        m.low ^= __builtin_bswap64(m.high);
+        Xxh128Hash h = multiply128(m.low, kPrime64_2);
+        h.high += m.high * kPrime64_2;
+        return Xxh128Hash{avalanche(h.low), avalanche(h.high)};
+    }
+    Xxh128Hash acc{len * kPrime64_1, 0};
+    if (len <= 128) {
+        for (size_t i = (len - 1) / 32 + 1; i-- > 0;) {
+            acc = mix32(acc, input + 16 * i, input + len - 16 * (i + 1), s + 32 * i);
+        }
+        return finish128(acc, len);
+    }
+    for (size_t i = 32; i < 160; i += 32) {
+        acc = mix32(acc, input + i - 32, input + i - 16, s + i - 32);
+    }
+    acc.low = avalanche(acc.low);
+    acc.high = avalanche(acc.high);
+    for (size_t i = 160; i <= len; i += 32) {
+        acc = mix32(acc, input + i - 32, input + i - 16, s + 3 + i - 160);
+    }
+    acc = mix32(acc, input + len - 16, input + len - 32, s + 136 - 17 - 16);
+    return finish128(acc, len);
+}
+
+// ---- Longer inputs: 64-byte stripes folded into eight accumulators ----
+
+void accumulateScalar(uint64_t* acc, const uint8_t* input, const uint8_t* secret, size_t stripes) {
+    for (size_t n = 0; n < stripes; ++n, input += kStripeLen, secret += 8) {
+        for (size_t i = 0; i < 8; ++i) {
+            const uint64_t data = readLe64(input + 8 * i);
+            const uint64_t key = data ^ readLe64(secret + 8 * i);
+            acc[i ^ 1] += data;
+            acc[i] += (key & 0xFFFFFFFFu) * (key >> 32);
+        }
+    }
+}
+
+void scrambleScalar(uint64_t* acc, const uint8_t* secret) {
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= readLe64(secret + 8 * i);
+        acc[i] = a * kPrime32_1;
+    }
+}
+
+#if INGEST_XXH3_X86
+
+/**
+ * Internal: the scalar lane arithmetic on four lanes per vector; the 32x32
+ * multiply is vpmuludq, the neighbour-lane add a 64-bit lane swap.
+ */
+__attribute__((target("avx2"))) void accumulateAvx2(uint64_t* acc, const uint8_t* input, const uint8_t* secret,
+                                                    size_t stripes) {
+    __m256i a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+    __m256i a1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + 4));
+    for (size_t n = 0; n < stripes; ++n, input += kStripeLen, secret += 8) {
+        const __m256i d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+        const __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 32));
+        const __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret)));
+        const __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + 32)));
+        const __m256i p0 = _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32));
+        const __m256i p1 = _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32));
+        a0 = _mm256_add_epi64(_mm256_add_epi64(a0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))), p0);
+        a1 = _mm256_add_epi64(_mm256_add_epi64(a1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))), p1);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc), a0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 4), a1);
+}
+
+__attribute__((target("avx2"))) void scrambleAvx2(uint64_t* acc, const uint8_t* secret) {
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+    for (size_t i = 0; i < 2; ++i) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + 4 * i));
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + 32 * i)));
+        const __m256i lo = _mm256_mul_epu32(a, prime);
+        const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc + 4 * i), _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
+
+void accumulate(Xxh3::Engine engine, uint64_t* acc, const uint8_t* input, const uint8_t* secret, size_t stripes) {
+#if INGEST_XXH3_X86
+    if (engine == Xxh3::Engine::Avx2) {
+        accumulateAvx2(acc, input, secret, stripes);
+        return;
+    }
+#else
+    (void)engine;
+#endif
+    accumulateScalar(acc, input, secret, stripes);
+}
+
+void scramble(Xxh3::Engine engine, uint64_t* acc) {
+#if INGEST_XXH3_X86
+    if (engine == Xxh3::Engine::Avx2) {
+        scrambleAvx2(acc, kSecret + kSecretLimit);
+        return;
+    }
+#else
+    (void)engine;
+#endif
+    scrambleScalar(acc, kSecret + kSecretLimit);
+}
+
+/**
+ * Internal: accumulates whole stripes, scrambling after every kStripesPerBlock;
+ * stripesSoFar carries the position within the current block across calls.
+ */
+const uint8_t* consumeStripes(Xxh3::Engine engine, uint64_t* acc, size_t& stripesSoFar, const uint8_t* input,
+                              size_t stripes) {
+    while (stripes > 0) {
+        const size_t take = min(stripes, kStripesPerBlock - stripesSoFar);
+        accumulate(engine, acc, input, kSecret + 8 * stripesSoFar, take);
+        input += take * kStripeLen;
+        stripes -= take;
+        stripesSoFar += take;
+        if (stripesSoFar == kStripesPerBlock) {
+            scramble(engine, acc);
+            stripesSoFar = 0;
+        }
+    }
+    return input;
+}
+
+uint64_t mergeAccumulators(const uint64_t* acc, const uint8_t* secret, uint64_t start) {
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; ++i) {
+        result += multiplyFold64(acc[2 * i] ^ readLe64(secret + 16 * i), acc[2 * i + 1] ^ readLe64(secret + 16 * i + 8));
+    }
+    return avalanche(result);
+}
+
+Xxh3::Engine detectBestEngine() {
+#if INGEST_XXH3_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Xxh3::Engine::Avx2;
+    }
+#endif
+    return Xxh3::Engine::Scalar;
+}
+
+} // namespace (internal)
+
+Xxh3::Engine Xxh3::bestEngine() {
+    static const Engine best = detectBestEngine();
+    return best;
+}
+
+bool Xxh3::engineSupported(Engine engine) {
+    return engine == Engine::Scalar || bestEngine() == Engine::Avx2;
+}
+
+const char* Xxh3::engineName(Engine engine) {
+    return engine == Engine::Avx2 ? "avx2" : "scalar";
+}
+
+void Xxh3::setEngine(Engine engine) {
+    if (!engineSupported(engine)) {
+        throw runtime_error(string("xxh3 engine not supported: ") + engineName(engine));
+    }
+    engine_ = engine;
+}
+
+Xxh3::Xxh3()
+    : engine_(bestEngine()),
+      acc_{kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3, kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1} {}
+
+void Xxh3::update(const uint8_t* data, size_t len) {
+    totalLen_ += len;
+    if (len <= kBufferSize - bufferedSize_) {
+        if (len > 0) {
+            memcpy(buffer_ + bufferedSize_, data, len);
+        }
+        bufferedSize_ += len;
+        return;
+    }
+    // The last stripe is accumulated with a different secret offset at the
+    // end, so input is only consumed while more follows it.
+    if (bufferedSize_ > 0) {
+        const size_t fill = kBufferSize - bufferedSize_;
+        memcpy(buffer_ + bufferedSize_, data, fill);
+        data += fill;
+        len -= fill;
+        consumeStripes(engine_, acc_, stripesSoFar_, buffer_, kBufferSize / kStripeLen);
+        bufferedSize_ = 0;
+    }
+    if (len > kBufferSize) {
+        const uint8_t* end = data + len;
+        data = consumeStripes(engine_, acc_, stripesSoFar_, data, (len - 1) / kStripeLen);
+        len = static_cast<size_t>(end - data);
+        // Kept for finishLong(), which may need bytes before the remainder.
+        memcpy(buffer_ + kBufferSize - kStripeLen, data - kStripeLen, kStripeLen);
+    }
+    memcpy(buffer_, data, len);
+    bufferedSize_ = len;
+}
+
+void Xxh3::finishLong(uint64_t acc[8]) const {
+    memcpy(acc, acc_, sizeof(acc_));
+    uint8_t lastStripe[kStripeLen];
+    const uint8_t* last;
+    if (bufferedSize_ >= kStripeLen) {
+        size_t stripesSoFar = stripesSoFar_;
+        consumeStripes(engine_, acc, stripesSoFar, buffer_, (bufferedSize_ - 1) / kStripeLen);
+        last = buffer_ + bufferedSize_ - kStripeLen;
+    } else {
+        // The final stripe reaches back into bytes consumed earlier.
+        const size_t catchUp = kStripeLen - bufferedSize_;
+        memcpy(lastStripe, buffer_ + kBufferSize - catchUp, catchUp);
+        memcpy(lastStripe + catchUp, buffer_, bufferedSize_);
+        last = lastStripe;
+    }
+    accumulate(engine_, acc, last, kSecret + kLastStripeSecret, 1);
+}
+
+uint64_t Xxh3::digest64() const {
+    if (totalLen_ <= kMidsizeMax) {
+        return hashShort64(buffer_, static_cast<size_t>(totalLen_));
+    }
+    alignas(32) uint64_t acc[8];
+    finishLong(acc);
+    return mergeAccumulators(acc, kSecret + kMergeSecret, totalLen_ * kPrime64_1);
+}
+
+Xxh128Hash Xxh3::digest128() const {
+    if (totalLen_ <= kMidsizeMax) {
+        return hashShort128(buffer_, static_cast<size_t>(totalLen_));
+    }
+    alignas(32) uint64_t acc[8];
+    finishLong(acc);
+    return Xxh128Hash{mergeAccumulators(acc, kSecret + kMergeSecret, totalLen_ * kPrime64_1),
+                      mergeAccumulators(acc, kSecret + sizeof(kSecret) - kStripeLen - kMergeSecret,
+                                        ~(totalLen_ * kPrime64_2))};
+}
+
+uint64_t xxh3_64(const uint8_t* data, size_t len) {
+    Xxh3 hasher;
+    hasher.update(data, len);
+    return hasher.digest64();
+}
+
+Xxh128Hash xxh3_128(const uint8_t* data, size_t len) {
+    Xxh3 hasher;
+    hasher.update(data, len);
+    return hasher.digest128();
+}
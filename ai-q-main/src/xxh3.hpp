@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A 128-bit XXH3 hash.
+ */
+struct Xxh128Hash {
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    bool operator==(const Xxh128Hash& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Xxh128Hash& other) const { return !(*this == other); }
+};
+
+/**
+ * Incremental XXH3 (xxHash 0.8, default secret, seed 0). Not cryptographic:
+ * meant as a cheap 64-bit key for dedup lookups, with SHA-256 compared only
+ * on candidate hits. The 64- and 128-bit variants share their streaming
+ * state, so one pass yields both. Long inputs are folded 64 bytes at a time
+ * into eight 64-bit accumulators, two AVX2 vectors when the CPU has it.
+ */
+class Xxh3 {
+public:
+    enum class Engine {
+        Scalar,
+        Avx2,
+    };
+
+    Xxh3();
+
+    void update(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Digests of the bytes fed so far; neither modifies the hasher.
+     */
+    std::uint64_t digest64() const;
+    Xxh128Hash digest128() const;
+
+    /**
+     * The widest engine this CPU supports; used by default.
+     */
+    static Engine bestEngine();
+
+    static bool engineSupported(Engine engine);
+
+    static const char* engineName(Engine engine);
+
+    /**
+     * Pins this hasher to a specific engine. Throws std::runtime_error if the CPU lacks it.
+     */
+    void setEngine(Engine engine);
+
+    static constexpr std::size_t kBufferSize = 256;
+
+private:
+    void finishLong(std::uint64_t acc[8]) const;
+
+    Engine engine_;
+    alignas(32) std::uint64_t acc_[8];
+    std::uint8_t buffer_[kBufferSize] = {};
+    std::size_t bufferedSize_ = 0;
+    std::size_t stripesSoFar_ = 0; // stripes accumulated since the last scramble
+    std::uint64_t totalLen_ = 0;
+};
+
+/**
+ * XXH3 of a buffer in one call.
+ */
+std::uint64_t xxh3_64(const std::uint8_t* data, std::size_t len);
+Xxh128Hash xxh3_128(const std::uint8_t* data, std::size_t len);
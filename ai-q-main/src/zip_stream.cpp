@@ -0,0 +1,360 @@
+#include "zip_stream.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndSignature = 0x06054b50;
+constexpr uint32_t kZip64EndSignature = 0x06064b50;
+constexpr uint32_t kZip64LocatorSignature = 0x07064b50;
+constexpr uint32_t kDigitalSignatureSignature = 0x05054b50;
+constexpr uint32_t kArchiveExtraSignature = 0x08064b50;
+constexpr uint32_t kDataDescriptorSignature = 0x08074b50;
+
+inline uint16_t le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t le64(const uint8_t* p) {
+    return static_cast<uint64_t>(le32(p)) | (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+/**
+ * Internal: reads the ZIP64 extended information field (header id 0x0001),
+ * whose 8-byte values stand in, in a fixed order, for the header fields that
+ * were saturated to all ones.
+ */
+class Zip64Field {
+public:
+    Zip64Field(const uint8_t* extra, size_t len) {
+        size_t i = 0;
+        while (i + 4 <= len) {
+            const uint16_t id = le16(extra + i);
+            const size_t size = le16(extra + i + 2);
+            if (id == 0x0001) {
+                at_ = extra + i + 4;
+                end_ = extra + min(i + 4 + size, len);
+                return;
+            }
+            i += 4 + size;
+        }
+    }
+
+    bool present() const { return at_ != nullptr; }
+
+    /**
+     * Replaces value with the next 8-byte field when it was saturated.
+     */
+    template <typename T>
+    void resolve(T saturated, uint64_t& value) {
+        if (at_ != nullptr && value == saturated && at_ + 8 <= end_) {
+            value = le64(at_);
+            at_ += 8;
+        }
+    }
+
+private:
+    const uint8_t* at_ = nullptr;
+    const uint8_t* end_ = nullptr;
+};
+
+} // namespace (internal)
+
+size_t ZipStreamWalker::fill(const uint8_t* data, size_t len, size_t want) {
+    size_t take = min(len, want - bufferLen_);
+    memcpy(buffer_ + bufferLen_, data, take);
+    bufferLen_ += take;
+    return take;
+}
+
+size_t ZipStreamWalker::descriptorLength() const {
+    const bool hasSignature = bufferLen_ >= 4 && le32(buffer_) == kDataDescriptorSignature;
+    return (hasSignature ? 4 : 0) + (entry_.zip64 ? 20 : 12);
+}
+
+bool ZipStreamWalker::beginRecord(uint32_t signature) {
+    if (signature == kLocalHeaderSignature) {
+        record_ = Record::Local;
+        recordWant_ = 30;
+        // Local entries only precede the central directory.
+        return status_ == Status::Walking;
+    }
+    if (status_ == Status::Walking) {
+        status_ = Status::CentralDirectory;
+        centralStart_ = recordStart_;
+    }
+    switch (signature) {
+    case kCentralHeaderSignature:
+        record_ = Record::Central;
+        recordWant_ = 46;
+        return true;
+    case kEndSignature:
+        record_ = Record::End;
+        recordWant_ = 22;
+        if (!zip64EndSeen_) {
+            endStart_ = recordStart_;
+        }
+        return true;
+    case kZip64EndSignature:
+        record_ = Record::Zip64End;
+        recordWant_ = 56;
+        endStart_ = recordStart_;
+        return true;
+    case kZip64LocatorSignature:
+        record_ = Record::Other;
+        recordWant_ = 20;
+        return true;
+    case kDigitalSignatureSignature:
+        record_ = Record::Other;
+        recordWant_ = 6;
+        return true;
+    case kArchiveExtraSignature:
+        record_ = Record::Other;
+        recordWant_ = 8;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ZipStreamWalker::parseRecord() {
+    nameLength_ = 0;
+    extraLength_ = 0;
+    skipLength_ = 0;
+    switch (record_) {
+    case Record::Local:
+        entry_ = ZipEntry{};
+        entry_.localHeaderOffset = recordStart_;
+        entry_.versionNeeded = le16(buffer_ + 4);
+        entry_.flags = le16(buffer_ + 6);
+        entry_.method = le16(buffer_ + 8);
+        entry_.crc32 = le32(buffer_ + 14);
+        entry_.compressedSize = le32(buffer_ + 18);
+        entry_.uncompressedSize = le32(buffer_ + 22);
+        nameLength_ = le16(buffer_ + 26);
+        extraLength_ = le16(buffer_ + 28);
+        ++entryCount_;
+        break;
+    case Record::Central:
+        central_ = ZipCentralEntry{};
+        central_.flags = le16(buffer_ + 8);
+        central_.method = le16(buffer_ + 10);
+        central_.crc32 = le32(buffer_ + 16);
+        central_.compressedSize = le32(buffer_ + 20);
+        central_.uncompressedSize = le32(buffer_ + 24);
+        nameLength_ = le16(buffer_ + 28);
+        extraLength_ = le16(buffer_ + 30);
+        skipLength_ = le16(buffer_ + 32);
+        central_.localHeaderOffset = le32(buffer_ + 42);
+        ++centralEntryCount_;
+        break;
+    case Record::Zip64End: {
+        // The size field counts everything after itself: 44 fixed bytes plus extensible data.
+        const uint64_t size = le64(buffer_ + 4);
+        skipLength_ = size > 44 ? size - 44 : 0;
+        zip64EndSeen_ = true;
+        end_.zip64 = true;
+        end_.entryCount = le64(buffer_ + 32);
+        end_.centralDirectorySize = le64(buffer_ + 40);
+        end_.centralDirectoryOffset = le64(buffer_ + 48);
+        break;
+    }
+    case Record::End: {
+        const uint16_t entries = le16(buffer_ + 10);
+        const uint32_t size = le32(buffer_ + 12);
+        const uint32_t offset = le32(buffer_ + 16);
+        if (!zip64EndSeen_ || entries != 0xFFFF) {
+            end_.entryCount = entries;
+        }
+        if (!zip64EndSeen_ || size != 0xFFFFFFFFu) {
+            end_.centralDirectorySize = size;
+        }
+        if (!zip64EndSeen_ || offset != 0xFFFFFFFFu) {
+            end_.centralDirectoryOffset = offset;
+        }
+        skipLength_ = le16(buffer_ + 20);
+        break;
+    }
+    case Record::Other:
+        if (le32(buffer_) == kDigitalSignatureSignature) {
+            skipLength_ = le16(buffer_ + 4);
+        } else if (le32(buffer_) == kArchiveExtraSignature) {
+            skipLength_ = le32(buffer_ + 4);
+        }
+        break;
+    }
+    nameLen_ = 0;
+    extraLen_ = 0;
+}
+
+void ZipStreamWalker::completeRecord(ZipEntryVisitor& visitor) {
+    state_ = State::Record;
+    switch (record_) {
+    case Record::Local: {
+        Zip64Field zip64(extra_, extraLen_);
+        entry_.zip64 = zip64.present();
+        zip64.resolve(0xFFFFFFFFu, entry_.uncompressedSize);
+        zip64.resolve(0xFFFFFFFFu, entry_.compressedSize);
+        entry_.name = string_view(name_, nameLen_);
+        entry_.nameTruncated = nameLength_ > nameLen_;
+        visitor.onEntry(entry_);
+        remaining_ = entry_.compressedSize;
+        state_ = State::Data;
+        break;
+    }
+    case Record::Central: {
+        Zip64Field zip64(extra_, extraLen_);
+        zip64.resolve(0xFFFFFFFFu, central_.uncompressedSize);
+        zip64.resolve(0xFFFFFFFFu, central_.compressedSize);
+        zip64.resolve(0xFFFFFFFFu, central_.localHeaderOffset);
+        central_.name = string_view(name_, nameLen_);
+        central_.nameTruncated = nameLength_ > nameLen_;
+        visitor.onCentralEntry(central_);
+        break;
+    }
+    case Record::End:
+        status_ = Status::Finished;
+        visitor.onEndOfCentralDirectory(end_);
+        break;
+    case Record::Zip64End:
+    case Record::Other:
+        break;
+    }
+}
+
+void ZipStreamWalker::parseDescriptor() {
+    const uint8_t* p = buffer_ + (le32(buffer_) == kDataDescriptorSignature ? 4 : 0);
+    entry_.hasDescriptor = true;
+    entry_.descriptorCrc32 = le32(p);
+    if (entry_.zip64) {
+        entry_.descriptorCompressedSize = le64(p + 4);
+        entry_.descriptorUncompressedSize = le64(p + 12);
+    } else {
+        entry_.descriptorCompressedSize = le32(p + 4);
+        entry_.descriptorUncompressedSize = le32(p + 8);
+    }
+}
+
+void ZipStreamWalker::feed(const uint8_t* data, size_t len, ZipEntryVisitor& visitor) {
+    // A finished name, extra, skip or sized data phase is closed even when no
+    // input is left, so a record ending exactly at a chunk boundary is reported promptly.
+    auto phaseDone = [&] {
+        return remaining_ == 0 && (state_ == State::Name || state_ == State::Extra || state_ == State::Skip ||
+                                   (state_ == State::Data && !entry_.sizeDeferred()));
+    };
+    while ((status_ == Status::Walking || status_ == Status::CentralDirectory) && (len > 0 || phaseDone())) {
+        size_t used = 0;
+        switch (state_) {
+        case State::Record: {
+            if (bufferLen_ == 0) {
+                recordStart_ = offset_;
+            }
+            if (bufferLen_ < 4) {
+                used = fill(data, len, 4);
+                offset_ += used;
+                if (bufferLen_ == 4 && !beginRecord(le32(buffer_))) {
+                    status_ = Status::Lost;
+                }
+                break;
+            }
+            used = fill(data, len, recordWant_);
+            offset_ += used;
+            if (bufferLen_ == recordWant_) {
+                parseRecord();
+                bufferLen_ = 0;
+                remaining_ = nameLength_;
+                state_ = State::Name;
+            }
+            break;
+        }
+        case State::Name: {
+            used = static_cast<size_t>(min<uint64_t>(len, remaining_));
+            const size_t keep = min(used, kMaxNameLength - nameLen_);
+            memcpy(name_ + nameLen_, data, keep);
+            nameLen_ += keep;
+            remaining_ -= used;
+            offset_ += used;
+            if (remaining_ == 0) {
+                remaining_ = extraLength_;
+                state_ = State::Extra;
+            }
+            break;
+        }
+        case State::Extra: {
+            used = static_cast<size_t>(min<uint64_t>(len, remaining_));
+            const size_t keep = min(used, sizeof(extra_) - extraLen_);
+            memcpy(extra_ + extraLen_, data, keep);
+            extraLen_ += keep;
+            remaining_ -= used;
+            offset_ += used;
+            if (remaining_ == 0) {
+                remaining_ = skipLength_;
+                state_ = State::Skip;
+            }
+            break;
+        }
+        case State::Skip: {
+            used = static_cast<size_t>(min<uint64_t>(len, remaining_));
+            remaining_ -= used;
+            offset_ += used;
+            if (remaining_ == 0) {
+                completeRecord(visitor);
+            }
+            break;
+        }
+        case State::Data: {
+            bool ended = false;
+            if (entry_.sizeDeferred()) {
+                // The size lives only in the descriptor after the data.
+                used = min(visitor.onDeferredEntryData(entry_, data, len, ended), len);
+                if (!ended && used < len) {
+                    status_ = Status::Lost;
+                    break;
+                }
+            } else {
+                used = static_cast<size_t>(min<uint64_t>(len, remaining_));
+                if (used > 0) {
+                    visitor.onEntryData(entry_, data, used);
+                }
+                remaining_ -= used;
+                ended = remaining_ == 0;
+            }
+            offset_ += used;
+            if (ended) {
+                if (entry_.usesDataDescriptor()) {
+                    state_ = State::Descriptor;
+                } else {
+                    visitor.onEntryEnd(entry_);
+                    state_ = State::Record;
+                }
+            }
+            break;
+        }
+        case State::Descriptor: {
+            used = fill(data, len, bufferLen_ < 4 ? 4 : descriptorLength());
+            offset_ += used;
+            if (bufferLen_ >= 4 && bufferLen_ == descriptorLength()) {
+                parseDescriptor();
+                bufferLen_ = 0;
+                visitor.onEntryEnd(entry_);
+                state_ = State::Record;
+            }
+            break;
+        }
+        }
+        data += used;
+        len -= used;
+    }
+}
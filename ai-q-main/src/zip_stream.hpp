@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * One ZIP entry as announced by its local file header (APPNOTE 4.3.7), with
+ * ZIP64 sizes resolved from the extra field. When the entry carries a data
+ * descriptor its fields are filled in once the descriptor has been read.
+ */
+struct ZipEntry {
+    std::uint64_t localHeaderOffset = 0;
+    std::uint16_t versionNeeded = 0;
+    std::uint16_t flags = 0;
+    std::uint16_t method = 0;
+    std::uint32_t crc32 = 0;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+    bool zip64 = false;
+    // Points into the walker; valid until the next feed(). At most
+    // ZipStreamWalker::kMaxNameLength bytes are kept.
+    std::string_view name;
+    bool nameTruncated = false;
+    // Set once a data descriptor (general purpose flag bit 3) has been read.
+    bool hasDescriptor = false;
+    std::uint32_t descriptorCrc32 = 0;
+    std::uint64_t descriptorCompressedSize = 0;
+    std::uint64_t descriptorUncompressedSize = 0;
+
+    bool usesDataDescriptor() const { return (flags & 0x0008) != 0; }
+
+    /**
+     * True when the sizes are only known from the data descriptor.
+     */
+    bool sizeDeferred() const { return usesDataDescriptor() && compressedSize == 0; }
+};
+
+/**
+ * One central directory file header (APPNOTE 4.3.12), ZIP64 fields resolved.
+ */
+struct ZipCentralEntry {
+    std::uint16_t flags = 0;
+    std::uint16_t method = 0;
+    std::uint32_t crc32 = 0;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+    std::uint64_t localHeaderOffset = 0;
+    // Same lifetime and truncation rules as ZipEntry::name.
+    std::string_view name;
+    bool nameTruncated = false;
+};
+
+/**
+ * The end of central directory record, with the ZIP64 end record's values
+ * substituted for saturated fields when one precedes it.
+ */
+struct ZipEndOfCentralDirectory {
+    std::uint64_t entryCount = 0;
+    std::uint64_t centralDirectorySize = 0;
+    std::uint64_t centralDirectoryOffset = 0;
+    bool zip64 = false;
+};
+
+/**
+ * Receives records as a ZipStreamWalker reaches them. Every hook has a no-op default.
+ */
+class ZipEntryVisitor {
+public:
+    virtual ~ZipEntryVisitor() = default;
+
+    /**
+     * A local header, name and extra field have been read.
+     */
+    virtual void onEntry(const ZipEntry& entry) { (void)entry; }
+
+    /**
+     * A slice of the entry's stored (possibly compressed) bytes.
+     */
+    virtual void onEntryData(const ZipEntry& entry, const std::uint8_t* data, std::size_t len) {
+        (void)entry;
+        (void)data;
+        (void)len;
+    }
+
+    /**
+     * Bytes following an entry whose size is deferred to its data descriptor.
+     * Only a decoder of the entry's method can tell where such data ends:
+     * return how many leading bytes belong to it and set ended once the end
+     * is found. Consuming less than len without ending gives up, which leaves
+     * the walker lost; the default does exactly that.
+     */
+    virtual std::size_t onDeferredEntryData(const ZipEntry& entry, const std::uint8_t* data, std::size_t len,
+                                            bool& ended) {
+        (void)entry;
+        (void)data;
+        (void)len;
+        ended = false;
+        return 0;
+    }
+
+    /**
+     * The entry's data and any data descriptor have been consumed.
+     */
+    virtual void onEntryEnd(const ZipEntry& entry) { (void)entry; }
+
+    /**
+     * A central directory header, name and extra field have been read.
+     */
+    virtual void onCentralEntry(const ZipCentralEntry& entry) { (void)entry; }
+
+    /**
+     * The end of central directory record and its comment have been read.
+     */
+    virtual void onEndOfCentralDirectory(const ZipEndOfCentralDirectory& end) { (void)end; }
+};
+
+/**
+ * Push parser over a whole ZIP archive, fed the raw archive bytes in arbitrary
+ * chunks. Entry data is skipped by its compressed size rather than buffered,
+ * so the walker holds only a record-sized window plus a bounded name. After
+ * the local entries it reads the central directory through to the end record.
+ * It is lost when an entry defers its size to a data descriptor and the
+ * visitor cannot find the end of its data, or when the bytes stop looking
+ * like a ZIP.
+ */
+class ZipStreamWalker {
+public:
+    enum class Status {
+        Walking,          // inside the local-header section
+        CentralDirectory, // past the last local entry, before the end record
+        Finished,         // end of central directory record read
+        Lost,             // cannot locate the next record
+    };
+
+    static constexpr std::size_t kMaxNameLength = 256;
+
+    void feed(const std::uint8_t* data, std::size_t len, ZipEntryVisitor& visitor);
+
+    Status status() const { return status_; }
+
+    /**
+     * Number of local headers read so far.
+     */
+    std::uint64_t entryCount() const { return entryCount_; }
+
+    /**
+     * Number of central directory headers read so far.
+     */
+    std::uint64_t centralEntryCount() const { return centralEntryCount_; }
+
+    /**
+     * Where the first record after the local entries starts, as observed in
+     * the stream; meaningful once status() is past Walking.
+     */
+    std::uint64_t centralDirectoryStart() const { return centralStart_; }
+
+    /**
+     * Where the ZIP64 end record, or else the end record, starts; meaningful
+     * once status() is Finished.
+     */
+    std::uint64_t endRecordStart() const { return endStart_; }
+
+private:
+    enum class State { Record, Name, Extra, Skip, Data, Descriptor };
+    enum class Record { Local, Central, End, Zip64End, Other };
+
+    std::size_t fill(const std::uint8_t* data, std::size_t len, std::size_t want);
+    std::size_t descriptorLength() const;
+    bool beginRecord(std::uint32_t signature);
+    void parseRecord();
+    void completeRecord(ZipEntryVisitor& visitor);
+    void parseDescriptor();
+
+    Status status_ = Status::Walking;
+    State state_ = State::Record;
+    Record record_ = Record::Local;
+    std::size_t recordWant_ = 0;
+    std::uint64_t offset_ = 0;
+    std::uint64_t recordStart_ = 0;
+    std::uint64_t entryCount_ = 0;
+    std::uint64_t centralEntryCount_ = 0;
+    std::uint64_t centralStart_ = 0;
+    std::uint64_t endStart_ = 0;
+    bool zip64EndSeen_ = false;
+    std::uint64_t remaining_ = 0;
+    std::uint16_t nameLength_ = 0;
+    std::uint16_t extraLength_ = 0;
+    std::uint64_t skipLength_ = 0;
+    ZipEntry entry_;
+    ZipCentralEntry central_;
+    ZipEndOfCentralDirectory end_;
+    // Staging for fixed-size records: the largest is the ZIP64 end record (56).
+    std::uint8_t buffer_[56] = {};
+    std::size_t bufferLen_ = 0;
+    char name_[kMaxNameLength] = {};
+    std::size_t nameLen_ = 0;
+    // The leading part of the extra field, enough to find the ZIP64 record.
+    std::uint8_t extra_[64] = {};
+    std::size_t extraLen_ = 0;
+};
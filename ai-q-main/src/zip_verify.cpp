@@ -0,0 +1,280 @@
+#include "zip_verify.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflated = 8;
+constexpr uint16_t kFlagEncrypted = 0x0001;
+
+/**
+ * Internal: whether value breaks a limit, negative limits being disabled.
+ */
+bool over(int64_t limit, uint64_t value) {
+    return limit >= 0 && value > static_cast<uint64_t>(limit);
+}
+
+uint64_t addSaturating(uint64_t a, uint64_t b) {
+    return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+}
+
+} // namespace (internal)
+
+/**
+ * Internal: CRCs and counts inflated bytes on their way past.
+ */
+class ZipIntegrityVerifier::DataOutput final : public InflateOutput {
+public:
+    explicit DataOutput(ZipIntegrityVerifier& verifier) : verifier_(verifier) {}
+
+    void write(const uint8_t* data, size_t len) override {
+        verifier_.crc_.update(data, len);
+        verifier_.outputBytes_ += len;
+        if (verifier_.deliverContent_) {
+            verifier_.contentVisitor_->onEntryContent(data, len);
+        }
+    }
+
+private:
+    ZipIntegrityVerifier& verifier_;
+};
+
+void ZipIntegrityVerifier::feed(const uint8_t* data, size_t len) {
+    if (active()) {
+        walker_.feed(data, len, *this);
+    }
+}
+
+void ZipIntegrityVerifier::finish() {
+    if (limitExceeded_) {
+        // Verification stopped on purpose; the rest of the archive was not walked.
+        return;
+    }
+    switch (walker_.status()) {
+    case ZipStreamWalker::Status::Walking:
+    case ZipStreamWalker::Status::CentralDirectory:
+        report(Issue::Truncated);
+        break;
+    case ZipStreamWalker::Status::Lost:
+        if (!gaveUp_) {
+            report(Issue::CorruptData);
+        }
+        break;
+    case ZipStreamWalker::Status::Finished:
+        break;
+    }
+}
+
+bool ZipIntegrityVerifier::active() const {
+    return !limitExceeded_ && (walker_.status() == ZipStreamWalker::Status::Walking ||
+           walker_.status() == ZipStreamWalker::Status::CentralDirectory);
+}
+
+void ZipIntegrityVerifier::exceed(Issue issue) {
+    report(issue);
+    limitExceeded_ = true;
+    decoding_ = false;
+}
+
+bool ZipIntegrityVerifier::withinLimits(uint64_t& total, uint64_t compressedSize, uint64_t uncompressedSize) {
+    total = addSaturating(total, uncompressedSize);
+    if (over(limits_.maxUncompressedSize, total)) {
+        exceed(Issue::UncompressedSizeExceeded);
+        return false;
+    }
+    if (limits_.maxCompressionRatio >= 0 && uncompressedSize >= kRatioMinSize &&
+        static_cast<double>(uncompressedSize) >
+            limits_.maxCompressionRatio * static_cast<double>(max<uint64_t>(compressedSize, 1))) {
+        exceed(Issue::CompressionRatioExceeded);
+        return false;
+    }
+    return true;
+}
+
+bool ZipIntegrityVerifier::inflate(const uint8_t* data, size_t len, size_t& consumed) {
+    DataOutput out(*this);
+    if (inflater_->feed(data, len, consumed, out) != RawInflater::Status::Error) {
+        return true;
+    }
+    decoding_ = false;
+    return false;
+}
+
+void ZipIntegrityVerifier::onEntry(const ZipEntry& entry) {
+    storedBytes_ = 0;
+    outputBytes_ = 0;
+    crc_.reset();
+    decoding_ = false;
+    deliverContent_ = false;
+    if (limitExceeded_) {
+        return;
+    }
+    if (over(limits_.maxEntries, walker_.entryCount())) {
+        exceed(Issue::TooManyEntries);
+        return;
+    }
+    // Deferred sizes are checked once the descriptor arrives; inflating them
+    // meanwhile is capped by the remaining size budget.
+    if (!entry.sizeDeferred() && !withinLimits(localTotal_, entry.compressedSize, entry.uncompressedSize)) {
+        return;
+    }
+    const bool wantContent = contentVisitor_ != nullptr && contentVisitor_->onEntryStart(entry);
+    deflated_ = entry.method == kMethodDeflated;
+    decoding_ = (entry.flags & kFlagEncrypted) == 0 && (entry.method == kMethodStored || deflated_);
+    deliverContent_ = wantContent && decoding_;
+    if (decoding_ && deflated_) {
+        if (!inflater_) {
+            inflater_ = make_unique<RawInflater>();
+        }
+        inflater_->reset();
+        // One byte past the declared size is enough to tell it was wrong.
+        const uint64_t declared = entry.uncompressedSize;
+        uint64_t cap = declared + (declared < UINT64_MAX ? 1 : 0);
+        if (entry.sizeDeferred()) {
+            cap = kMaxDeferredEntrySize;
+            if (limits_.maxUncompressedSize >= 0) {
+                const uint64_t budget = static_cast<uint64_t>(limits_.maxUncompressedSize);
+                cap = min(cap, (budget > inflatedTotal_ ? budget - inflatedTotal_ : 0) + 1);
+            }
+        }
+        inflater_->setMaxOutput(cap);
+    }
+}
+
+void ZipIntegrityVerifier::onEntryData(const ZipEntry& entry, const uint8_t* data, size_t len) {
+    (void)entry;
+    storedBytes_ += len;
+    if (!decoding_) {
+        return;
+    }
+    if (!deflated_) {
+        crc_.update(data, len);
+        outputBytes_ += len;
+        if (deliverContent_) {
+            contentVisitor_->onEntryContent(data, len);
+        }
+        return;
+    }
+    size_t consumed = 0;
+    if (!inflate(data, len, consumed)) {
+        report(inflater_->totalOut() > entry.uncompressedSize ? Issue::SizeMismatch : Issue::CorruptData);
+    } else if (consumed < len) {
+        // The deflate stream ends before the entry's data does.
+        decoding_ = false;
+        report(Issue::SizeMismatch);
+    }
+}
+
+size_t ZipIntegrityVerifier::onDeferredEntryData(const ZipEntry& entry, const uint8_t* data, size_t len,
+                                                 bool& ended) {
+    (void)entry;
+    ended = false;
+    if (!decoding_ || !deflated_) {
+        // Nothing here can find the end of this entry's data.
+        gaveUp_ = true;
+        return 0;
+    }
+    size_t consumed = 0;
+    if (!inflate(data, len, consumed)) {
+        if (over(limits_.maxUncompressedSize, addSaturating(inflatedTotal_, inflater_->totalOut()))) {
+            exceed(Issue::UncompressedSizeExceeded);
+        } else if (inflater_->totalOut() >= kMaxDeferredEntrySize) {
+            gaveUp_ = true;
+        } else {
+            report(Issue::CorruptData);
+        }
+        return 0;
+    }
+    storedBytes_ += consumed;
+    // A bomb streamed without sizes is caught by its running ratio.
+    if (limits_.maxCompressionRatio >= 0 && outputBytes_ >= kRatioMinSize &&
+        static_cast<double>(outputBytes_) > limits_.maxCompressionRatio * static_cast<double>(storedBytes_)) {
+        exceed(Issue::CompressionRatioExceeded);
+        return 0;
+    }
+    ended = inflater_->status() == RawInflater::Status::Done;
+    return consumed;
+}
+
+void ZipIntegrityVerifier::onEntryEnd(const ZipEntry& entry) {
+    if (limitExceeded_) {
+        return;
+    }
+    // The data descriptor, when present, is authoritative for CRC and sizes.
+    const uint32_t crc = entry.hasDescriptor ? entry.descriptorCrc32 : entry.crc32;
+    const uint64_t compressedSize = entry.hasDescriptor ? entry.descriptorCompressedSize : entry.compressedSize;
+    const uint64_t uncompressedSize =
+        entry.hasDescriptor ? entry.descriptorUncompressedSize : entry.uncompressedSize;
+    locals_.push_back(LocalRecord{entry.localHeaderOffset, crc, compressedSize, uncompressedSize});
+    inflatedTotal_ = addSaturating(inflatedTotal_, outputBytes_);
+    if (entry.sizeDeferred() && !withinLimits(localTotal_, compressedSize, uncompressedSize)) {
+        return;
+    }
+    if (compressedSize != storedBytes_ || (entry.method == kMethodStored && uncompressedSize != storedBytes_)) {
+        report(Issue::SizeMismatch);
+    }
+    if (decoding_ && deflated_ && inflater_->status() != RawInflater::Status::Done) {
+        // The entry's data ends inside the deflate stream.
+        report(Issue::CorruptData);
+        decoding_ = false;
+    }
+    if (!decoding_) {
+        return;
+    }
+    if (outputBytes_ != uncompressedSize) {
+        report(Issue::SizeMismatch);
+    }
+    if (crc_.value() != crc) {
+        report(Issue::CrcMismatch);
+    }
+    ++entriesVerified_;
+}
+
+void ZipIntegrityVerifier::onCentralEntry(const ZipCentralEntry& entry) {
+    if (limitExceeded_) {
+        return;
+    }
+    if (over(limits_.maxEntries, walker_.centralEntryCount())) {
+        exceed(Issue::TooManyEntries);
+        return;
+    }
+    if (!withinLimits(centralTotal_, entry.compressedSize, entry.uncompressedSize)) {
+        return;
+    }
+    // Directories list entries in archive order in practice; fall back to a search otherwise.
+    const LocalRecord* local = nullptr;
+    if (nextCentral_ < locals_.size() && locals_[nextCentral_].offset == entry.localHeaderOffset) {
+        local = &locals_[nextCentral_];
+    } else {
+        auto it = lower_bound(locals_.begin(), locals_.end(), entry.localHeaderOffset,
+                              [](const LocalRecord& record, uint64_t offset) { return record.offset < offset; });
+        if (it != locals_.end() && it->offset == entry.localHeaderOffset) {
+            local = &*it;
+        }
+    }
+    ++nextCentral_;
+    if (local == nullptr || local->crc32 != entry.crc32 || local->compressedSize != entry.compressedSize ||
+        local->uncompressedSize != entry.uncompressedSize) {
+        report(Issue::CentralDirectoryMismatch);
+    }
+}
+
+void ZipIntegrityVerifier::onEndOfCentralDirectory(const ZipEndOfCentralDirectory& end) {
+    if (limitExceeded_) {
+        return;
+    }
+    if (over(limits_.maxEntries, end.entryCount)) {
+        exceed(Issue::TooManyEntries);
+        return;
+    }
+    const uint64_t centralSize = walker_.endRecordStart() - walker_.centralDirectoryStart();
+    if (end.entryCount != walker_.centralEntryCount() || end.entryCount != walker_.entryCount() ||
+        end.centralDirectoryOffset != walker_.centralDirectoryStart() || end.centralDirectorySize != centralSize) {
+        report(Issue::CentralDirectoryMismatch);
+    }
+}
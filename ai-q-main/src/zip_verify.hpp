@@ -0,0 +1,166 @@
+#pragma once
+
+#include "crc32.hpp"
+#include "inflate.hpp"
+#include "zip_stream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Bounds on what a ZIP archive may expand to, guarding against
+ * decompression bombs. A negative value disables a limit.
+ */
+struct ZipLimits {
+    std::int64_t maxEntries = -1;
+    std::int64_t maxUncompressedSize = -1; // summed over entries
+    double maxCompressionRatio = -1;       // uncompressed / compressed, per entry
+};
+
+/**
+ * Sees entry content as a ZipIntegrityVerifier decodes it, so other checks
+ * share its single inflate pass.
+ */
+class ZipContentVisitor {
+public:
+    virtual ~ZipContentVisitor() = default;
+
+    /**
+     * A local entry was read (its name is valid only during the call). Return
+     * true to receive its content, which is delivered only for entries the
+     * verifier decodes.
+     */
+    virtual bool onEntryStart(const ZipEntry& entry) = 0;
+
+    /**
+     * A slice of the current entry's uncompressed content.
+     */
+    virtual void onEntryContent(const std::uint8_t* data, std::size_t len) = 0;
+};
+
+/**
+ * Checks a ZIP archive's integrity in one pass as its bytes stream past.
+ * Each entry's data is CRC-32'd (stored entries directly, deflated ones
+ * through a RawInflater) and measured, then compared with its local header
+ * or data descriptor; the central directory is cross-checked against the
+ * local entries it indexes, and the end record against the directory.
+ * Deflated entries with deferred sizes are walked by finding the end of their
+ * stream. Entries that cannot be decoded here (encrypted, or another
+ * compression method) are skipped; if one hides where the next header starts,
+ * verification stops without reporting a problem. Input that is not a ZIP
+ * loses the walk at its first bytes, after which feed() does nothing.
+ *
+ * ZipLimits are enforced against the sizes declared by local headers, data
+ * descriptors and the central directory alike, and against what actually
+ * inflates; no entry is inflated past the remaining size budget. The first
+ * limit exceeded ends verification.
+ */
+class ZipIntegrityVerifier : private ZipEntryVisitor {
+public:
+    enum class Issue : std::uint8_t {
+        CrcMismatch,              // entry data does not match its CRC-32
+        SizeMismatch,             // entry data does not match its declared sizes
+        CentralDirectoryMismatch, // directory or end record disagrees with the entries
+        CorruptData,              // undecodable entry data or unparseable structure
+        Truncated,                // input ended before the end record
+        TooManyEntries,           // more entries than ZipLimits::maxEntries
+        UncompressedSizeExceeded, // total uncompressed size over ZipLimits::maxUncompressedSize
+        CompressionRatioExceeded, // an entry expands more than ZipLimits::maxCompressionRatio
+    };
+
+    /**
+     * Output cap for a deflated entry whose size is deferred to its data
+     * descriptor; verification stops at an entry inflating past it.
+     */
+    static constexpr std::uint64_t kMaxDeferredEntrySize = std::uint64_t(1) << 32;
+
+    /**
+     * Entries smaller than this when uncompressed are exempt from the ratio
+     * limit: however well they compress, they cannot cost much to inflate.
+     */
+    static constexpr std::uint64_t kRatioMinSize = std::uint64_t(1) << 20;
+
+    explicit ZipIntegrityVerifier(const ZipLimits& limits = ZipLimits{}) : limits_(limits) {}
+
+    /**
+     * Forwards every entry, and the content of those it asks for, to visitor
+     * (not owned; nullptr detaches). Entries past an exceeded limit are not seen.
+     */
+    void setContentVisitor(ZipContentVisitor* visitor) { contentVisitor_ = visitor; }
+
+    void feed(const std::uint8_t* data, std::size_t len);
+
+    /**
+     * Marks the end of input: an archive still short of its end record is truncated.
+     */
+    void finish();
+
+    /**
+     * False once the walk has ended, successfully or not; feed() is then a no-op.
+     */
+    bool active() const;
+
+    bool has(Issue issue) const { return (issues_ & bit(issue)) != 0; }
+
+    bool ok() const { return issues_ == 0; }
+
+    /**
+     * Entries whose data was decoded and checked.
+     */
+    std::uint64_t entriesVerified() const { return entriesVerified_; }
+
+private:
+    /**
+     * What an entry's local header and data established, for the central directory check.
+     */
+    struct LocalRecord {
+        std::uint64_t offset;
+        std::uint32_t crc32;
+        std::uint64_t compressedSize;
+        std::uint64_t uncompressedSize;
+    };
+
+    class DataOutput;
+
+    static std::uint32_t bit(Issue issue) { return 1u << static_cast<unsigned>(issue); }
+
+    void report(Issue issue) { issues_ |= bit(issue); }
+    void exceed(Issue issue);
+    bool withinLimits(std::uint64_t& total, std::uint64_t compressedSize, std::uint64_t uncompressedSize);
+    bool inflate(const std::uint8_t* data, std::size_t len, std::size_t& consumed);
+
+    void onEntry(const ZipEntry& entry) override;
+    void onEntryData(const ZipEntry& entry, const std::uint8_t* data, std::size_t len) override;
+    std::size_t onDeferredEntryData(const ZipEntry& entry, const std::uint8_t* data, std::size_t len,
+                                    bool& ended) override;
+    void onEntryEnd(const ZipEntry& entry) override;
+    void onCentralEntry(const ZipCentralEntry& entry) override;
+    void onEndOfCentralDirectory(const ZipEndOfCentralDirectory& end) override;
+
+    ZipStreamWalker walker_;
+    ZipLimits limits_;
+    ZipContentVisitor* contentVisitor_ = nullptr;
+    std::uint32_t issues_ = 0;
+    bool gaveUp_ = false;
+    bool limitExceeded_ = false;
+    // Uncompressed totals as declared by local entries and by the central
+    // directory, and as actually inflated.
+    std::uint64_t localTotal_ = 0;
+    std::uint64_t centralTotal_ = 0;
+    std::uint64_t inflatedTotal_ = 0;
+    std::uint64_t entriesVerified_ = 0;
+
+    // The entry being walked.
+    bool decoding_ = false;
+    bool deflated_ = false;
+    bool deliverContent_ = false;
+    std::uint64_t storedBytes_ = 0;
+    std::uint64_t outputBytes_ = 0;
+    Crc32 crc_;
+    std::unique_ptr<RawInflater> inflater_; // allocated on the first deflated entry
+
+    std::vector<LocalRecord> locals_;
+    std::size_t nextCentral_ = 0;
+};
@@ -1,11 +1,39 @@
+#include "../src/active_content.hpp"
+#include "../src/aho_corasick.hpp"
+#include "../src/blake3.hpp"
+#include "../src/byte_histogram.hpp"
+#include "../src/chunk_manifest.hpp"
+#include "../src/crc32.hpp"
+#include "../src/dedup_sink.hpp"
+#include "../src/digest_set.hpp"
+#include "../src/fastcdc.hpp"
+#include "../src/hex.hpp"
+#include "../src/inflate.hpp"
 #include "../src/ingest.hpp"
+#include "../src/metrics.hpp"
+#include "../src/pdf_scan.hpp"
+#include "../src/png_verify.hpp"
+#include "../src/simd_search.hpp"
+#include "../src/tlsh.hpp"
+#include "../src/trace.hpp"
+#include "../src/utf8.hpp"
+#include "../src/xxh3.hpp"
+#include "../src/zip_stream.hpp"
+#include "../src/zip_verify.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include <cassert>
 
@@ -106,6 +134,150 @@ bool forwardedMatches(const RecordingSink& sink, size_t expectedBytes) {
            static_cast<size_t>(sink.lastResult.size) == expectedBytes;
 }
 
+/**
+ * Test-mock implementation of CompactIngestSink which records the compact result.
+ */
+class CompactRecordingSink final : public CompactIngestSink {
+public:
+    void persist(const UploadMeta&, const CompactIngestResult& result, ByteSource& data) override {
+        lastResult = result;
+        forwardedBytes = 0;
+        uint8_t buffer[4096];
+        while (size_t n = data.read(buffer, sizeof(buffer))) {
+            forwardedBytes += n;
+        }
+    }
+    CompactIngestResult lastResult;
+    size_t forwardedBytes{0};
+};
+
+const char* const kSamplePdfSha256 = "cef9af8b16c307c45852748645929070eed518c03ca98c18aa611a43ea15ec7a";
+
+void putLe16(vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void putLe32(vector<uint8_t>& out, uint32_t value) {
+    putLe16(out, value & 0xFFFF);
+    putLe16(out, value >> 16);
+}
+
+uint32_t bitwiseCrc32(const string& data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+vector<uint8_t> hexBytes(const string& hex) {
+    vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<uint8_t>(stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+/**
+ * Raw DEFLATE of '0' followed by 258 * runs more: one fixed-Huffman block of
+ * maximal matches, the shape of a decompression bomb (~160:1).
+ */
+vector<uint8_t> deflateZeroRuns(size_t runs) {
+    vector<uint8_t> out;
+    uint32_t acc = 0;
+    int count = 0;
+    auto bits = [&](uint32_t value, int n) {
+        acc |= value << count;
+        for (count += n; count >= 8; count -= 8, acc >>= 8) out.push_back(static_cast<uint8_t>(acc));
+    };
+    auto code = [&](uint32_t value, int n) { // Huffman codes go most significant bit first
+        for (int i = n - 1; i >= 0; --i) bits((value >> i) & 1u, 1);
+    };
+    bits(1, 1); // final block
+    bits(1, 2); // fixed codes
+    code(0x30 + '0', 8);
+    for (size_t i = 0; i < runs; ++i) {
+        code(0xC5, 8); // length 258
+        code(0, 5);    // distance 1
+    }
+    code(0, 7); // end of block
+    if (count > 0) out.push_back(static_cast<uint8_t>(acc));
+    return out;
+}
+
+struct ZipFixtureEntry {
+    string name;
+    string data;
+    // Raw DEFLATE of data; empty stores the entry.
+    vector<uint8_t> deflated = {};
+};
+
+/**
+ * Builds a ZIP with a central directory. With deferSizes the local headers
+ * leave CRC and sizes to a signed data descriptor, as streaming writers do.
+ */
+vector<uint8_t> buildZip(const vector<ZipFixtureEntry>& entries, bool deferSizes = false) {
+    vector<uint8_t> zip;
+    vector<uint8_t> central;
+    for (const auto& entry : entries) {
+        const uint32_t offset = static_cast<uint32_t>(zip.size());
+        const uint32_t crc = bitwiseCrc32(entry.data);
+        const uint32_t size = static_cast<uint32_t>(entry.data.size());
+        const bool deflated = !entry.deflated.empty();
+        const uint32_t stored = deflated ? static_cast<uint32_t>(entry.deflated.size()) : size;
+        const uint16_t flags = deferSizes ? 0x0008 : 0;
+        putLe32(zip, 0x04034b50);
+        putLe16(zip, 20);
+        putLe16(zip, flags);
+        putLe16(zip, deflated ? 8 : 0);
+        putLe32(zip, 0); // time, date
+        putLe32(zip, deferSizes ? 0 : crc);
+        putLe32(zip, deferSizes ? 0 : stored);
+        putLe32(zip, deferSizes ? 0 : size);
+        putLe16(zip, static_cast<uint32_t>(entry.name.size()));
+        putLe16(zip, 0);
+        zip.insert(zip.end(), entry.name.begin(), entry.name.end());
+        if (deflated) {
+            zip.insert(zip.end(), entry.deflated.begin(), entry.deflated.end());
+        } else {
+            zip.insert(zip.end(), entry.data.begin(), entry.data.end());
+        }
+        if (deferSizes) {
+            putLe32(zip, 0x08074b50);
+            putLe32(zip, crc);
+            putLe32(zip, stored);
+            putLe32(zip, size);
+        }
+        putLe32(central, 0x02014b50);
+        putLe16(central, 20);
+        putLe16(central, 20);
+        putLe16(central, flags);
+        putLe16(central, deflated ? 8 : 0);
+        putLe32(central, 0);
+        putLe32(central, crc);
+        putLe32(central, stored);
+        putLe32(central, size);
+        putLe16(central, static_cast<uint32_t>(entry.name.size()));
+        putLe32(central, 0); // extra and comment lengths
+        putLe32(central, 0); // disk number, internal attributes
+        putLe32(central, 0); // external attributes
+        putLe32(central, offset);
+        central.insert(central.end(), entry.name.begin(), entry.name.end());
+    }
+    const uint32_t centralOffset = static_cast<uint32_t>(zip.size());
+    zip.insert(zip.end(), central.begin(), central.end());
+    putLe32(zip, 0x06054b50);
+    putLe32(zip, 0);
+    putLe16(zip, static_cast<uint32_t>(entries.size()));
+    putLe16(zip, static_cast<uint32_t>(entries.size()));
+    putLe32(zip, static_cast<uint32_t>(central.size()));
+    putLe32(zip, centralOffset);
+    putLe16(zip, 0);
+    return zip;
+}
+
 // ======================== Happy Paths ========================
 
 void testPdfHappy() {
@@ -119,10 +291,37 @@ void testPdfHappy() {
     assert(sink.lastResult.ok);
     assert(sink.lastResult.errors.empty());
     assert(sink.lastResult.detectedMime == "application/pdf");
+    assert(sink.lastResult.sha256 == kSamplePdfSha256);
     assert(forwardedMatches(sink, data.size()));
     assert(sink.lastResult.size <= cfg.maxContentLength);
 }
 
+void testCompactResult() {
+    auto data = loadFile("test/resources/sample.pdf");
+    MemoryByteSource src(data);
+    UploadMeta meta{"sample.pdf", "image/png", true, static_cast<int64_t>(data.size()) + 1};
+    IngestConfig cfg{static_cast<int64_t>(data.size() + 1024), {"application/pdf"}};
+    CompactRecordingSink sink;
+    ingest(meta, cfg, src, sink);
+
+    const CompactIngestResult& result = sink.lastResult;
+    assert(result.detectedMime == MimeType::Pdf);
+    assert(result.size == static_cast<int64_t>(data.size()));
+    assert(sink.forwardedBytes == data.size());
+    char hex[64];
+    result.sha256.toHex(hex);
+    assert(string(hex, sizeof(hex)) == kSamplePdfSha256);
+    assert(!result.ok);
+    assert(result.errors.has(IngestError::ContentLengthMismatch));
+    assert(result.errors.has(IngestError::ClaimedMimeMismatch));
+    assert(!result.errors.has(IngestError::MimeNotAccepted));
+
+    IngestResult expanded = expandResult(result);
+    assert(expanded.detectedMime == "application/pdf");
+    assert(expanded.sha256 == kSamplePdfSha256);
+    assert((expanded.errors == vector<string>{"contentLength mismatch", "claimedMime does not match detectedMime"}));
+}
+
 // ======================== Negative Paths ========================
 
 void testClaimedMimeMismatch() {
@@ -165,6 +364,58 @@ void testMimeNotAccepted() {
     assert(forwardedMatches(sink, data.size()));
 }
 
+void testIngestPolicy() {
+    IngestPolicy policy(IngestConfig{1 << 23, {" Application/PDF ; q=1", "text/x-unknown", "IMAGE/png"}});
+    assert(policy.accepts(MimeType::Pdf));
+    assert(policy.accepts(MimeType::Png));
+    assert(!policy.accepts(MimeType::Docx));
+    assert(!policy.accepts(MimeType::OctetStream));
+    assert(IngestPolicy(IngestConfig{1 << 20, {}}).accepts(MimeType::Docx));
+
+    // One compiled policy serves many requests; claimed types compare by essence.
+    auto data = loadFile("test/resources/sample.pdf");
+    for (const char* claimed : {"application/pdf", "APPLICATION/Pdf; charset=binary", "  application/pdf  "}) {
+        MemoryByteSource src(data);
+        UploadMeta meta{"sample.pdf", claimed, true, static_cast<int64_t>(data.size())};
+        RecordingSink sink;
+        ingest(meta, policy, src, sink);
+        assert(sink.lastResult.ok);
+        assert(forwardedMatches(sink, data.size()));
+    }
+    MemoryByteSource src(data);
+    UploadMeta meta{"sample.pdf", "application/pdfx", true, static_cast<int64_t>(data.size())};
+    RecordingSink sink;
+    ingest(meta, policy, src, sink);
+    assert(containsError(sink.lastResult, "claimedMime does not match detectedMime"));
+
+    // text/plain, in the allowlist or as a claim, covers the text subtypes the
+    // sniffer tells apart; text/xml is an alias of application/xml.
+    MimeType alias;
+    assert(lookupMimeType("Text/XML; charset=utf-8", alias) && alias == MimeType::Xml);
+    IngestPolicy textPolicy(IngestConfig{1 << 20, {"text/plain"}});
+    for (MimeType text : {MimeType::PlainText, MimeType::Csv, MimeType::Json, MimeType::Xml}) {
+        assert(textPolicy.accepts(text));
+    }
+    assert(!textPolicy.accepts(MimeType::Pdf));
+    IngestPolicy xmlPolicy(IngestConfig{1 << 20, {"text/xml"}});
+    assert(xmlPolicy.accepts(MimeType::Xml) && !xmlPolicy.accepts(MimeType::PlainText));
+    auto claimText = [&](const string& text, const char* claimed) {
+        vector<uint8_t> bytes(text.begin(), text.end());
+        MemoryByteSource textSrc(bytes);
+        UploadMeta textMeta{"upload.txt", claimed, false, 0};
+        RecordingSink textSink;
+        ingest(textMeta, textPolicy, textSrc, textSink);
+        return textSink.lastResult;
+    };
+    const string csv = "id,name,amount\n1,Ann,2\n";
+    IngestResult claimedText = claimText(csv, "text/plain");
+    assert(claimedText.detectedMime == "text/csv" && claimedText.ok);
+    claimedText = claimText("<?xml version=\"1.0\"?><a/>", "text/xml");
+    assert(claimedText.detectedMime == "application/xml" && claimedText.ok);
+    claimedText = claimText("plain words only", "text/csv");
+    assert(containsError(claimedText, "claimedMime does not match detectedMime"));
+}
+
 void testContentLengthMismatchMinusOne() {
     auto data = loadFile("test/resources/sample.docx");
     MemoryByteSource src(data);
@@ -223,17 +474,1653 @@ void testTinyInput() {
     assert(sink.lastResult.size == 0);
 }
 
+void testStreamingSnifferChunkBoundaries() {
+    auto docx = loadFile("test/resources/sample.docx");
+    auto pdf = loadFile("test/resources/sample.pdf");
+
+    // Feeding one byte at a time must reach the same decisions as whole buffers.
+    for (const auto* data : {&docx, &pdf}) {
+        MimeSniffer sniffer;
+        for (size_t i = 0; i < data->size() && !sniffer.decided(); ++i) {
+            sniffer.feed(data->data() + i, 1);
+        }
+        assert(sniffer.finish() == sniffMime(data->data(), data->size()));
+    }
+    assert(sniffMime(docx.data(), docx.size()) == MimeType::Docx);
+
+    // A marker split across chunks is still found (this truncated archive
+    // cannot be walked, so the markers decide at end of input).
+    vector<uint8_t> zip = {'P', 'K', 0x03, 0x04, 'x', 'x', 'w', 'o', 'r', 'd', '/'};
+    MimeSniffer split;
+    split.feed(zip.data(), 8);
+    assert(!split.decided());
+    split.feed(zip.data() + 8, zip.size() - 8);
+    assert(split.finish() == MimeType::Docx);
+
+    // Decisions come as soon as the magic is conclusive, and markers beyond the
+    // window leave a plain ZIP.
+    MimeSniffer early;
+    early.feed(pdf.data(), 4);
+    assert(early.decided());
+    vector<uint8_t> late(zip.begin(), zip.begin() + 4);
+    late.resize(MimeSniffer::kZipMarkerWindow, 'x');
+    for (char ch : string("word/")) late.push_back(static_cast<uint8_t>(ch));
+    assert(sniffMime(late.data(), late.size()) == MimeType::Zip);
+}
+
+void testSignatureTable() {
+    struct Case {
+        string bytes;
+        MimeType expected;
+    };
+    const vector<Case> cases = {
+        {string("\xFF\xD8\xFF\xE0\x00\x10JFIF", 10), MimeType::Jpeg},
+        {"GIF89a\x01\x00", MimeType::Gif},
+        {string("II*\0\x08\0\0\0", 8), MimeType::Tiff},
+        {string("MM\0*\0\0\0\x08", 8), MimeType::Tiff},
+        {string("RIFF\x24\0\0\0WEBPVP8 ", 16), MimeType::Webp},
+        {string("RIFF\x24\0\0\0WAVEfmt ", 16), MimeType::OctetStream},
+        {string("\0\0\0\x18" "ftypheic\0\0\0\0", 16), MimeType::Heic},
+        {string("\0\0\0\x20" "ftypisom\0\0\x02\0", 16), MimeType::Mp4},
+        {string("\0\0\0\x18" "ftypmp42\0\0\0\0" "mp42isom", 24), MimeType::Mp4},
+        // Other ISO BMFF brands are not MP4 video or HEIC.
+        {string("\0\0\0\x14" "ftypqt  \0\0\x02\0" "qt  ", 20), MimeType::OctetStream},
+        {string("\0\0\0\x1C" "ftypM4A \0\0\0\0" "M4A mp42isom", 28), MimeType::OctetStream},
+        {string("\0\0\0\x14" "ftyp3gp4\0\0\x02\0" "3gp4", 20), MimeType::OctetStream},
+        {string("\0\0\0\x1C" "ftypavif\0\0\0\0" "avifmif1miaf", 28), MimeType::OctetStream},
+        // Generic HEIF brands are HEIC only with a heic or heix compatible brand.
+        {string("\0\0\0\x1C" "ftypmif1\0\0\0\0" "mif1miafheic", 28), MimeType::Heic},
+        {string("\0\0\0\x18" "ftypmsf1\0\0\0\0" "msf1heix", 24), MimeType::Heic},
+        {string("\0\0\0\x1C" "ftypmif1\0\0\0\0" "mif1miafavif", 28), MimeType::OctetStream},
+        {string("\0\0\0\x18" "ftypmif1\0\0\0\0" "mif1", 20), MimeType::OctetStream}, // box cut short
+        {string("\0\0\0\x14" "ftypmif1\0\0\0\0" "mif1heic", 24), MimeType::OctetStream}, // heic past the box
+        {"{\\rtf1\\ansi", MimeType::Rtf},
+        {string("7z\xBC\xAF\x27\x1C\0\x04", 8), MimeType::SevenZip},
+        {string("\x1F\x8B\x08\0\0\0\0\0", 8), MimeType::Gzip},
+        {string("PK\x05\x06\0\0\0\0", 8), MimeType::Zip},
+        {"Exhibit A: signed statement\r\n", MimeType::PlainText},
+        {"%P", MimeType::PlainText},
+        {string("text\0with NUL", 13), MimeType::OctetStream},
+        {"", MimeType::OctetStream},
+        {"<?xml version=\"1.0\"?><claim/>", MimeType::Xml},
+        {"{\"claim\": [1, -2.5e3, true, null], \"note\": \"a \\\"b\\\"\"}\n", MimeType::Json},
+        {"[Exhibit A] signed statement", MimeType::PlainText},
+        {"{\"unclosed\": 1", MimeType::PlainText},
+        {"id,amount\r\n1,\"2,50\"\r\n2,3\r\n", MimeType::Csv},
+        {"id;amount\n1;2\n3;4", MimeType::Csv},
+        {"id,name,amount\n1,Ann,2\n", MimeType::Csv},
+        {"Hello, world.\nGoodbye, world.\n", MimeType::PlainText},
+        {"Dear Sir, thank you.\nBest regards, John\n", MimeType::PlainText},
+        {"id,amount\n1,2,3\n", MimeType::PlainText},
+        {string("\xFF\xFE{\0}\0", 6), MimeType::Json},
+        {string("\0a\0,\0b\0,\0c\0\n\0" "1\0,\0" "2\0,\0" "3\0\n", 24), MimeType::Csv},
+    };
+    for (const auto& c : cases) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(c.bytes.data());
+        assert(sniffMime(bytes, c.bytes.size()) == c.expected);
+        MimeSniffer sniffer;
+        for (size_t i = 0; i < c.bytes.size(); ++i) {
+            sniffer.feed(bytes + i, 1);
+        }
+        assert(sniffer.finish() == c.expected);
+    }
+
+    // The "png" fixture is really a JPEG; content wins over the name.
+    auto data = loadFile("test/resources/sample.png");
+    assert(sniffMime(data.data(), data.size()) == MimeType::Jpeg);
+}
+
+// ======================== Format Verification ========================
+
+void testMultiNeedleSearch() {
+    MultiNeedleSearch search{"word/", "xl/", "ppt/", "[Content_Types].xml", "mimetype"};
+    assert(search.maxNeedleLength() == 19);
+
+    // Every engine this CPU supports agrees with a naive search, at every
+    // alignment and across the vector/tail boundary.
+    mt19937 rng(33);
+    const string alphabet = "wordxlpt/[]CT_.ymie";
+    for (int round = 0; round < 2000; ++round) {
+        vector<uint8_t> haystack(rng() % 130);
+        for (auto& byte : haystack) byte = static_cast<uint8_t>(alphabet[rng() % alphabet.size()]);
+        const string needle = search.needle(rng() % search.size());
+        if (haystack.size() >= needle.size() && rng() % 2 == 0) {
+            memcpy(haystack.data() + rng() % (haystack.size() - needle.size() + 1), needle.data(), needle.size());
+        }
+        uint32_t expected = 0;
+        string text(haystack.begin(), haystack.end());
+        for (size_t n = 0; n < search.size(); ++n) {
+            if (text.find(search.needle(n)) != string::npos) expected |= 1u << n;
+        }
+        for (auto engine : {MultiNeedleSearch::Engine::Scalar, MultiNeedleSearch::Engine::Sse2,
+                            MultiNeedleSearch::Engine::Avx2}) {
+            if (!MultiNeedleSearch::engineSupported(engine)) continue;
+            search.setEngine(engine);
+            assert(search.findAll(haystack.data(), haystack.size()) == expected);
+        }
+    }
+
+    // Matches come in offset order and the callback can stop the scan.
+    const string text = "..xl/....ppt/..xl/";
+    const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+    vector<size_t> offsets;
+    search.forEachMatch(bytes, text.size(), [&](size_t needle, size_t offset) {
+        assert(needle == (offset == 9 ? 2u : 1u));
+        offsets.push_back(offset);
+        return true;
+    });
+    assert((offsets == vector<size_t>{2, 9, 15}));
+    offsets.clear();
+    search.forEachMatch(bytes, text.size(), [&](size_t, size_t offset) {
+        offsets.push_back(offset);
+        return false;
+    });
+    assert(offsets.size() == 1);
+
+    // Part directories name the OOXML package; the sniffer reports every marker seen.
+    auto zipWith = [](const string& names) {
+        vector<uint8_t> zip = {'P', 'K', 0x03, 0x04};
+        zip.insert(zip.end(), names.begin(), names.end());
+        return zip;
+    };
+    auto xlsx = zipWith("[Content_Types].xml....xl/workbook.xml");
+    auto pptx = zipWith("[Content_Types].xml....ppt/presentation.xml");
+    auto odt = zipWith("mimetypeapplication/vnd.oasis.opendocument.text");
+    assert(sniffMime(xlsx.data(), xlsx.size()) == MimeType::Xlsx);
+    assert(sniffMime(pptx.data(), pptx.size()) == MimeType::Pptx);
+    assert(sniffMime(odt.data(), odt.size()) == MimeType::Zip);
+    MimeSniffer sniffer;
+    sniffer.feed(odt.data(), odt.size());
+    sniffer.finish();
+    assert(MimeSniffer::hasZipMarker(sniffer.zipMarkers(), MimeSniffer::ZipMarker::OdfMimetype));
+    assert(!MimeSniffer::hasZipMarker(sniffer.zipMarkers(), MimeSniffer::ZipMarker::ContentTypes));
+}
+
+void testZipWalker() {
+    // Entries are walked header by header, their data skipped by size.
+    const string filler(20000, 'x');
+    auto xlsx = buildZip({{"[Content_Types].xml", filler}, {"_rels/.rels", "<r/>"}, {"xl/workbook.xml", "<w/>"}});
+    struct NameRecorder : ZipEntryVisitor {
+        void onEntry(const ZipEntry& entry) override {
+            names.emplace_back(entry.name);
+            offsets.push_back(entry.localHeaderOffset);
+        }
+        void onEntryData(const ZipEntry&, const uint8_t*, size_t len) override { dataBytes += len; }
+        void onEntryEnd(const ZipEntry& entry) override { descriptors += entry.hasDescriptor; }
+        vector<string> names;
+        vector<uint64_t> offsets;
+        size_t dataBytes = 0;
+        int descriptors = 0;
+    };
+    for (bool deferSizes : {false, true}) {
+        auto zip = buildZip({{"a.txt", filler}, {"b/c.txt", "hello"}}, deferSizes);
+        ZipStreamWalker walker;
+        NameRecorder recorder;
+        for (size_t i = 0; i < zip.size(); i += 1000) {
+            walker.feed(zip.data() + i, min<size_t>(1000, zip.size() - i), recorder);
+        }
+        if (deferSizes) {
+            // Nothing tells where the stored data ends.
+            assert(walker.status() == ZipStreamWalker::Status::Lost);
+            assert((recorder.names == vector<string>{"a.txt"}));
+            continue;
+        }
+        assert(walker.status() == ZipStreamWalker::Status::Finished);
+        assert(walker.entryCount() == 2);
+        assert(walker.centralEntryCount() == 2);
+        assert(walker.centralDirectoryStart() == 30 + 5 + filler.size() + 30 + 7 + 5);
+        assert((recorder.names == vector<string>{"a.txt", "b/c.txt"}));
+        assert((recorder.offsets == vector<uint64_t>{0, 30 + 5 + filler.size()}));
+        assert(recorder.dataBytes == filler.size() + 5);
+        assert(recorder.descriptors == 0);
+    }
+
+    // Subtypes come from entry names and the ODF mimetype entry, wherever they sit.
+    struct Case {
+        vector<uint8_t> zip;
+        MimeType expected;
+    };
+    const vector<Case> cases = {
+        {xlsx, MimeType::Xlsx},
+        {buildZip({{"[Content_Types].xml", filler}, {"word/document.xml", "<d/>"}}), MimeType::Docx},
+        {buildZip({{"[Content_Types].xml", "<t/>"}, {"ppt/presentation.xml", "<p/>"}}), MimeType::Pptx},
+        {buildZip({{"mimetype", "application/vnd.oasis.opendocument.text"}, {"content.xml", "<c/>"}}), MimeType::Odt},
+        {buildZip({{"mimetype", "application/vnd.oasis.opendocument.spreadsheet"}}), MimeType::Zip},
+        {buildZip({{"mimetype", "application/epub+zip"}, {"META-INF/container.xml", "<c/>"}}), MimeType::Epub},
+        {buildZip({{"META-INF/", ""}, {"META-INF/MANIFEST.MF", "Manifest-Version: 1.0\n"}}), MimeType::Jar},
+        {buildZip({{"notes.txt", "word/ xl/ [Content_Types].xml"}}), MimeType::Zip},
+        // Streamed writers defer sizes; the walk stops and the markers decide.
+        {buildZip({{"[Content_Types].xml", "<t/>"}, {"xl/workbook.xml", "<w/>"}}, true), MimeType::Xlsx},
+    };
+    for (const auto& c : cases) {
+        assert(sniffMime(c.zip.data(), c.zip.size()) == c.expected);
+        MimeSniffer sniffer;
+        for (size_t i = 0; i < c.zip.size() && !sniffer.decided(); ++i) {
+            sniffer.feed(c.zip.data() + i, 1);
+        }
+        assert(sniffer.finish() == c.expected);
+    }
+
+    // The verdict arrives with the deciding entry, before the rest of the archive.
+    MimeSniffer early;
+    const size_t deciding = 30 + 19 + filler.size() + 30 + 11 + 4 + 30 + 15;
+    early.feed(xlsx.data(), deciding);
+    assert(early.decided());
+    assert(deciding < xlsx.size());
+}
+
+// 13 "<row ...>" lines, compressed by zlib into a single dynamic-Huffman block.
+const char* const kRowsDeflateHex =
+    "65d0490a80300c05d0bda728bd809d5ba1f62e822e044110d4ebebc21f21d9e691e9d763bfd53a8fdae8764ddbb92853fbb7d6ba0ab1"
+    "10cbc54102170f19b8049a963845908b9c12c88bae4c47885d0594c48103a888af2c45e10551164e4cb47f1af9b307";
+
+string rowsText() {
+    string text;
+    for (int i = 0; i < 13; ++i) {
+        text += "<row id=\"" + to_string(i) + "\">value " + to_string(i * i % 97) + "</row>\n";
+    }
+    return text;
+}
+
+struct StringOutput : InflateOutput {
+    void write(const uint8_t* data, size_t len) override { text.append(reinterpret_cast<const char*>(data), len); }
+    string text;
+};
+
+void testCrc32AndInflate() {
+    // Every engine matches a bitwise reference, across the folding threshold and in pieces.
+    mt19937 rng(35);
+    for (size_t len = 0; len < 600; len += 1 + len / 8) {
+        string data(len, '\0');
+        for (auto& c : data) c = static_cast<char>(rng());
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+        for (auto engine : {Crc32::Engine::SliceBy8, Crc32::Engine::Pclmul}) {
+            if (!Crc32::engineSupported(engine)) continue;
+            Crc32 whole;
+            whole.setEngine(engine);
+            whole.update(bytes, len);
+            assert(whole.value() == bitwiseCrc32(data));
+            Crc32 split;
+            split.setEngine(engine);
+            const size_t cut = len == 0 ? 0 : rng() % len;
+            split.update(bytes, cut);
+            split.update(bytes + cut, len - cut);
+            assert(split.value() == whole.value());
+        }
+    }
+    assert(crc32(reinterpret_cast<const uint8_t*>("123456789"), 9) == 0xCBF43926u);
+
+    // A dynamic-Huffman stream decodes whole or a byte at a time, and the
+    // inflater stops exactly at its end.
+    auto stream = hexBytes(kRowsDeflateHex);
+    stream.push_back(0xAB); // not part of the stream
+    for (size_t step : {stream.size(), size_t(1), size_t(7)}) {
+        RawInflater inflater;
+        StringOutput out;
+        size_t total = 0;
+        for (size_t i = 0; i < stream.size() && inflater.status() == RawInflater::Status::NeedInput; i += step) {
+            size_t consumed = 0;
+            inflater.feed(stream.data() + i, min(step, stream.size() - i), consumed, out);
+            total += consumed;
+        }
+        assert(inflater.status() == RawInflater::Status::Done);
+        assert(total == stream.size() - 1);
+        assert(out.text == rowsText());
+    }
+
+    // Fixed-Huffman and stored blocks; an invalid block type and the output cap are errors.
+    const vector<uint8_t> hello = hexBytes("cb48cdc9c90700");
+    const vector<uint8_t> storedHello = {0x01, 0x05, 0x00, 0xFA, 0xFF, 'h', 'e', 'l', 'l', 'o'};
+    for (const auto& input : {hello, storedHello}) {
+        RawInflater inflater;
+        StringOutput out;
+        size_t consumed = 0;
+        assert(inflater.feed(input.data(), input.size(), consumed, out) == RawInflater::Status::Done);
+        assert(out.text == "hello" && consumed == input.size());
+        RawInflater capped(4);
+        assert(capped.feed(input.data(), input.size(), consumed, out) == RawInflater::Status::Error);
+    }
+    const uint8_t badType = 0x07;
+    RawInflater invalid;
+    StringOutput out;
+    size_t consumed = 0;
+    assert(invalid.feed(&badType, 1, consumed, out) == RawInflater::Status::Error);
+    assert(string(invalid.error()) == "invalid block type");
+}
+
+void testZipIntegrity() {
+    const string rows = rowsText();
+    const auto rowsDeflated = hexBytes(kRowsDeflateHex);
+    const vector<ZipFixtureEntry> entries = {
+        {"[Content_Types].xml", "<Types/>"}, {"word/document.xml", rows, rowsDeflated}, {"word/empty.xml", ""}};
+    const vector<ZipFixtureEntry> deflatedEntries = {{"[Content_Types].xml", "<Types/>", hexBytes("b309a92c482dd6b70300")},
+                                                     {"word/document.xml", rows, rowsDeflated},
+                                                     {"word/empty.xml", "", hexBytes("0300")}};
+    auto verify = [](const vector<uint8_t>& zip, size_t step) {
+        ZipIntegrityVerifier verifier;
+        for (size_t i = 0; i < zip.size(); i += step) {
+            verifier.feed(zip.data() + i, min(step, zip.size() - i));
+        }
+        verifier.finish();
+        return verifier;
+    };
+
+    // Stored and deflated entries check out whether sizes come first or in
+    // descriptors; deflated data with deferred sizes is walked by inflating it.
+    for (const auto& zip : {buildZip(entries), buildZip(deflatedEntries), buildZip(deflatedEntries, true)}) {
+        for (size_t step : {zip.size(), size_t(1), size_t(13)}) {
+            auto verifier = verify(zip, step);
+            assert(verifier.ok());
+            assert(verifier.entriesVerified() == 3);
+        }
+    }
+    // Nothing marks the end of stored data with deferred sizes: verification
+    // stops there without blaming the archive.
+    auto streamedStored = verify(buildZip(entries, true), 100);
+    assert(streamedStored.ok() && streamedStored.entriesVerified() == 0);
+
+    // Each kind of damage is named.
+    auto zip = buildZip(entries);
+    const size_t rowsData = 30 + 19 + 8 + 30 + 17;
+    auto flipped = zip;
+    flipped[30 + 19 + 2] ^= 0x20; // stored "<Types/>" -> "<tYpes/>"
+    assert(verify(flipped, 100).has(ZipIntegrityVerifier::Issue::CrcMismatch));
+    auto garbled = zip;
+    garbled[rowsData] = 0x07; // invalid block type
+    assert(verify(garbled, 100).has(ZipIntegrityVerifier::Issue::CorruptData));
+    auto oversized = zip;
+    oversized[rowsData - 17 - 30 + 22] += 1; // declared uncompressed size
+    assert(verify(oversized, 100).has(ZipIntegrityVerifier::Issue::SizeMismatch));
+    auto directory = zip;
+    directory[directory.size() - 22 - (46 + 14) + 16] ^= 1; // last central header's CRC
+    auto directoryCheck = verify(directory, 100);
+    assert(directoryCheck.has(ZipIntegrityVerifier::Issue::CentralDirectoryMismatch));
+    assert(!directoryCheck.has(ZipIntegrityVerifier::Issue::CrcMismatch));
+    auto truncated = zip;
+    truncated.resize(zip.size() - 10);
+    assert(verify(truncated, 100).has(ZipIntegrityVerifier::Issue::Truncated));
+
+    // Ingest reports corruption for ZIP containers only.
+    auto docx = buildZip(entries);
+    docx[30 + 19 + 3] ^= 0x20;
+    MemoryByteSource src(docx);
+    UploadMeta meta{"broken.docx", "", false, 0};
+    IngestConfig cfg{-1, {}};
+    RecordingSink sink;
+    ingest(meta, cfg, src, sink);
+    assert(sink.lastResult.detectedMime == "application/vnd.openxmlformats-officedocument.wordprocessingml.document");
+    assert(!sink.lastResult.ok);
+    assert((sink.lastResult.errors == vector<string>{"zip entry CRC-32 mismatch"}));
+
+    auto sample = loadFile("test/resources/sample.docx");
+    ZipIntegrityVerifier sampleVerifier;
+    sampleVerifier.feed(sample.data(), sample.size());
+    sampleVerifier.finish();
+    assert(sampleVerifier.ok() && sampleVerifier.entriesVerified() > 0);
+}
+
+void testZipLimits() {
+    // A 2 MiB entry deflated ~160:1 passes verification unless the ratio is limited.
+    const size_t runs = 8128;
+    const vector<ZipFixtureEntry> bomb = {{"word/document.xml", string(1 + 258 * runs, '0'), deflateZeroRuns(runs)}};
+    auto verify = [](const vector<uint8_t>& zip, const ZipLimits& limits) {
+        ZipIntegrityVerifier verifier(limits);
+        for (size_t i = 0; i < zip.size(); i += 4096) {
+            verifier.feed(zip.data() + i, min<size_t>(4096, zip.size() - i));
+        }
+        verifier.finish();
+        return verifier;
+    };
+    ZipLimits ratio;
+    ratio.maxCompressionRatio = 100;
+    for (bool deferSizes : {false, true}) {
+        auto zip = buildZip(bomb, deferSizes);
+        auto unlimited = verify(zip, ZipLimits{});
+        assert(unlimited.ok() && unlimited.entriesVerified() == 1);
+        // Declared sizes give it away up front; streamed ones by the running ratio.
+        auto limited = verify(zip, ratio);
+        assert(limited.has(ZipIntegrityVerifier::Issue::CompressionRatioExceeded));
+        assert(limited.entriesVerified() == 0 && !limited.active());
+    }
+
+    // Entry count and total size, from local headers and the central directory alike.
+    auto rows = buildZip({{"a", "1"}, {"b", "2"}, {"c", "3"}, {"d", rowsText()}});
+    ZipLimits entries;
+    entries.maxEntries = 3;
+    assert(verify(rows, entries).has(ZipIntegrityVerifier::Issue::TooManyEntries));
+    ZipLimits size;
+    size.maxUncompressedSize = 300;
+    assert(verify(rows, size).has(ZipIntegrityVerifier::Issue::UncompressedSizeExceeded));
+    size.maxUncompressedSize = 1 << 20;
+    assert(verify(rows, size).ok());
+    auto lyingDirectory = rows;
+    const size_t lastCentral = rows.size() - 22 - (46 + 1);
+    lyingDirectory[lastCentral + 24 + 3] = 0x40; // uncompressed size ~1 GiB
+    auto lying = verify(lyingDirectory, size);
+    assert(lying.has(ZipIntegrityVerifier::Issue::UncompressedSizeExceeded));
+    assert(!lying.has(ZipIntegrityVerifier::Issue::CentralDirectoryMismatch));
+
+    // Ingest applies the configured limits.
+    MemoryByteSource src(buildZip(bomb, true));
+    UploadMeta meta{"bomb.docx", "", false, 0};
+    IngestConfig cfg{-1, {}};
+    RecordingSink sink;
+    ingest(meta, cfg, src, sink);
+    assert((sink.lastResult.errors == vector<string>{"zip compression ratio exceeds maxZipCompressionRatio"}));
+    cfg.maxZipCompressionRatio = -1;
+    MemoryByteSource again(buildZip(bomb, true));
+    ingest(meta, cfg, again, sink);
+    assert(sink.lastResult.ok);
+}
+
+void putBe32(vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+void putPngChunk(vector<uint8_t>& png, const string& type, const string& data) {
+    putBe32(png, static_cast<uint32_t>(data.size()));
+    png.insert(png.end(), type.begin(), type.end());
+    png.insert(png.end(), data.begin(), data.end());
+    putBe32(png, bitwiseCrc32(type + data));
+}
+
+/**
+ * A PNG with the given IHDR and placeholder image data (never decompressed by ingest).
+ */
+vector<uint8_t> buildPng(uint32_t width, uint32_t height, uint8_t bitDepth = 8, uint8_t colorType = 2) {
+    vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    vector<uint8_t> ihdr;
+    putBe32(ihdr, width);
+    putBe32(ihdr, height);
+    ihdr.insert(ihdr.end(), {bitDepth, colorType, 0, 0, 0});
+    putPngChunk(png, "IHDR", string(ihdr.begin(), ihdr.end()));
+    putPngChunk(png, "IDAT", string(300, '\x5a'));
+    putPngChunk(png, "IEND", "");
+    return png;
+}
+
+void testPngVerifier() {
+    auto verify = [](const vector<uint8_t>& png, size_t step, int64_t maxPixels = -1) {
+        PngVerifier verifier(maxPixels);
+        for (size_t i = 0; i < png.size(); i += step) {
+            verifier.feed(png.data() + i, min(step, png.size() - i));
+        }
+        verifier.finish();
+        return verifier;
+    };
+    auto png = buildPng(640, 480, 16, 6);
+    for (size_t step : {png.size(), size_t(1), size_t(5)}) {
+        auto verifier = verify(png, step);
+        assert(verifier.ok() && verifier.isPng() && !verifier.active());
+        assert(verifier.hasHeader() && verifier.chunkCount() == 3);
+        assert(verifier.header().width == 640 && verifier.header().height == 480);
+        assert(verifier.header().bitDepth == 16 && verifier.header().colorType == 6);
+    }
+
+    auto damaged = png;
+    damaged[8 + 25 + 8 + 100] ^= 1; // inside IDAT
+    assert(verify(damaged, 64).has(PngVerifier::Issue::CrcMismatch));
+    auto truncated = png;
+    truncated.resize(png.size() - 12); // no IEND
+    assert(verify(truncated, 64).has(PngVerifier::Issue::MissingEnd));
+    assert(verify(buildPng(50000, 50000), 64, 100000000).has(PngVerifier::Issue::PixelLimitExceeded));
+    assert(verify(buildPng(50000, 50000), 64).ok());
+    assert(verify(buildPng(16, 16, 4, 2), 64).has(PngVerifier::Issue::InvalidHeader));
+    assert(verify(buildPng(0, 16), 64).has(PngVerifier::Issue::InvalidHeader));
+    vector<uint8_t> headless(png.begin(), png.begin() + 8);
+    putPngChunk(headless, "IEND", "");
+    assert(verify(headless, 64).has(PngVerifier::Issue::InvalidHeader));
+    auto badType = png;
+    badType[8 + 25 + 4] = '1';
+    assert(verify(badType, 64).has(PngVerifier::Issue::Corrupt));
+
+    // Other formats are ignored from their first byte.
+    auto jpeg = loadFile("test/resources/sample.png");
+    PngVerifier other;
+    other.feed(jpeg.data(), 1);
+    assert(!other.active() && !other.isPng());
+
+    // Ingest enforces maxImagePixels and reports damage for PNG uploads.
+    UploadMeta meta{"huge.png", "image/png", false, 0};
+    IngestConfig cfg{-1, {}};
+    RecordingSink sink;
+    MemoryByteSource huge(buildPng(50000, 50000));
+    ingest(meta, cfg, huge, sink);
+    assert((sink.lastResult.errors == vector<string>{"png pixel count exceeds maxImagePixels"}));
+    MemoryByteSource small(png);
+    ingest(meta, cfg, small, sink);
+    assert(sink.lastResult.ok && sink.lastResult.detectedMime == "image/png");
+    MemoryByteSource broken(truncated);
+    ingest(meta, cfg, broken, sink);
+    assert((sink.lastResult.errors == vector<string>{"png IEND chunk is missing"}));
+}
+
+/**
+ * A minimal PDF: one object, a classic xref table and trailer, then one
+ * incremental update per entry in updates, each with its own startxref.
+ */
+string buildPdf(const string& firstObject, int updates) {
+    string pdf = "%PDF-1.7\n" + firstObject + "\n";
+    for (int revision = 0; revision <= updates; ++revision) {
+        const size_t xref = pdf.size();
+        pdf += "xref\n0 1\n0000000000 65535 f \ntrailer\n<< /Size 1 >>\nstartxref\n" + to_string(xref) + "\n%%EOF\n";
+        if (revision < updates) {
+            pdf += to_string(revision + 2) + " 0 obj\n<< >>\nendobj\n";
+        }
+    }
+    return pdf;
+}
+
+void testPdfStructureScan() {
+    auto scan = [](const string& pdf, size_t step) {
+        PdfStructureScanner scanner;
+        const auto* bytes = reinterpret_cast<const uint8_t*>(pdf.data());
+        for (size_t i = 0; i < pdf.size(); i += step) {
+            scanner.feed(bytes + i, min(step, pdf.size() - i));
+        }
+        return scanner.finish();
+    };
+
+    // Keywords and startxref values are found however the bytes are split.
+    const string updated = buildPdf("1 0 obj\n<< /Type /Catalog >>\nendobj", 2);
+    for (size_t step : {updated.size(), size_t(1), size_t(3), size_t(10)}) {
+        PdfInfo info = scan(updated, step);
+        assert(info.scanned && info.versionMajor == 1 && info.versionMinor == 7);
+        assert(info.eofMarkers == 3 && info.incrementalUpdates == 2);
+        assert(info.startxref == static_cast<int64_t>(updated.rfind("xref\n0 1")));
+        assert(!info.truncated && !info.invalidStartxref && !info.linearized);
+    }
+    PdfInfo linearized = scan(buildPdf("1 0 obj\n<< /Linearized 1 >>\nendobj", 1), 7);
+    assert(linearized.linearized && linearized.incrementalUpdates == 0);
+
+    // Cut before its final marker, the file is truncated; the marker may be
+    // followed by at most kEofWindow bytes.
+    assert(scan(updated.substr(0, updated.size() - 3), 5).truncated);
+    const string single = buildPdf("1 0 obj\n<< >>\nendobj", 0);
+    assert(scan(single.substr(0, single.rfind("%%EOF")), 5).truncated);
+    string padded = updated + string(PdfStructureScanner::kEofWindow - 1, '\n'); // after "%%EOF\n"
+    assert(!scan(padded, 64).truncated);
+    assert(scan(padded + "x", 64).truncated);
+    string dangling = updated;
+    dangling.replace(dangling.rfind("startxref\n") + 10, 2, "99");
+    assert(scan(dangling, 64).invalidStartxref);
+    assert(!scan("GIF89a", 2).scanned);
+
+    // The sample is a single-revision PDF 1.3; truncated uploads fail validation.
+    auto data = loadFile("test/resources/sample.pdf");
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    IngestConfig cfg{-1, {}};
+    RecordingSink sink;
+    MemoryByteSource whole(data);
+    ingest(meta, cfg, whole, sink);
+    const PdfInfo& info = sink.lastResult.pdf;
+    assert(sink.lastResult.ok && info.scanned);
+    assert(info.versionMajor == 1 && info.versionMinor == 3 && info.eofMarkers == 1);
+    assert(info.incrementalUpdates == 0 && info.startxref == 4539916);
+    data.resize(data.size() / 2);
+    MemoryByteSource half(data);
+    ingest(meta, cfg, half, sink);
+    assert((sink.lastResult.errors == vector<string>{"pdf is truncated"}));
+}
+
+void testUtf8() {
+    // Whole-code-point pieces, some invalid, cut and spliced at random; both
+    // engines must agree with a plain decode at every split.
+    auto decodes = [](const vector<uint8_t>& s) {
+        for (size_t i = 0; i < s.size();) {
+            const uint8_t b = s[i];
+            const size_t n = b < 0x80 ? 1 : (b & 0xE0) == 0xC0 ? 2 : (b & 0xF0) == 0xE0 ? 3 : (b & 0xF8) == 0xF0 ? 4 : 0;
+            if (n == 0 || i + n > s.size()) return false;
+            uint32_t cp = n == 1 ? b : b & (0x7F >> n);
+            for (size_t k = 1; k < n; ++k) {
+                if ((s[i + k] & 0xC0) != 0x80) return false;
+                cp = (cp << 6) | (s[i + k] & 0x3F);
+            }
+            const uint32_t least[] = {0, 0, 0x80, 0x800, 0x10000};
+            if (cp < least[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return false;
+            i += n;
+        }
+        return true;
+    };
+    const vector<string> pieces = {"a", "plain ascii text ", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+                                   "\xF4\x8F\xBF\xBF", "\xED\x9F\xBF", "\xC0\xAF", "\xED\xA0\x80",
+                                   "\xF4\x90\x80\x80", "\xE0\x9F\xBF", "\xF8"};
+    mt19937 rng(50);
+    for (int trial = 0; trial < 3000; ++trial) {
+        vector<uint8_t> s;
+        const size_t target = rng() % 300;
+        while (s.size() < target) {
+            const string& piece = pieces[rng() % (trial % 2 ? pieces.size() : 7)];
+            s.insert(s.end(), piece.begin(), piece.end());
+        }
+        if (!s.empty() && rng() % 4 == 0) s.resize(rng() % s.size());
+        const bool expected = decodes(s);
+        for (auto engine : {Utf8Validator::Engine::Scalar, Utf8Validator::Engine::Avx2}) {
+            if (!Utf8Validator::engineSupported(engine)) continue;
+            Utf8Validator whole;
+            whole.setEngine(engine);
+            whole.update(s.data(), s.size());
+            assert(whole.valid() == expected);
+            Utf8Validator split;
+            split.setEngine(engine);
+            for (size_t i = 0; i < s.size();) {
+                const size_t step = min<size_t>(s.size() - i, rng() % 70 + 1);
+                split.update(s.data() + i, step);
+                i += step;
+            }
+            assert(split.valid() == expected);
+        }
+    }
+    Utf8Validator truncated;
+    truncated.update(reinterpret_cast<const uint8_t*>("\xE2\x82"), 2);
+    assert(!truncated.failed() && !truncated.valid());
+
+    // Ingest reports the charset of text, validated over the whole upload.
+    auto ingestText = [](const string& text) {
+        vector<uint8_t> bytes(text.begin(), text.end());
+        IngestConfig cfg{-1, {}};
+        UploadMeta meta{"upload.txt", "", false, 0};
+        RecordingSink sink;
+        MemoryByteSource src(bytes);
+        ingest(meta, cfg, src, sink);
+        return sink.lastResult;
+    };
+    string csv = "name,city\n";
+    while (csv.size() < 200000) csv += "Zo\xC3\xAB,K\xC3\xB8" "benhavn\n";
+    IngestResult result = ingestText(csv);
+    assert(result.detectedMime == "text/csv" && result.charset == "utf-8");
+    result = ingestText(csv + "Ren\xE9,Paris\n"); // Latin-1 far past the sniffing window
+    assert(result.detectedMime == "text/csv" && result.charset.empty());
+    result = ingestText(string("\xFE\xFF\0<\0?\0x\0m\0l", 12));
+    assert(result.detectedMime == "application/xml" && result.charset == "utf-16be");
+    auto pdf = loadFile("test/resources/sample.pdf");
+    result = ingestText(string(pdf.begin(), pdf.end()));
+    assert(result.detectedMime == "application/pdf" && result.charset.empty());
+    const string json = "{\"k\": 1}";
+    assert(detectMime(vector<uint8_t>(json.begin(), json.end())) == "application/json; charset=utf-8");
+    for (const string prose : {"Hello, world.\nGoodbye, world.\n", "Dear Sir, thank you.\nBest regards, John\n"}) {
+        assert(detectMime(vector<uint8_t>(prose.begin(), prose.end())) == "text/plain; charset=utf-8");
+    }
+}
+
+// ======================== Content Scanning ========================
+
+void testContentPatterns() {
+    // Every engine agrees with a naive search for overlapping patterns, however
+    // the input is split; start bytes span more than eight high nibbles so the
+    // SIMD prefilter runs in its superset mode too.
+    const vector<string> patterns = {"he", "she", "hers", "his", "/JavaScript", "\x01\xff", "~~", "0z"};
+    AhoCorasick matcher(patterns);
+    assert(matcher.size() == patterns.size() && matcher.allPatterns() == 0xFF);
+    mt19937 rng(39);
+    const string alphabet = "hersi/JavScrpt\x01\xff~0z.";
+    for (int round = 0; round < 2000; ++round) {
+        string text(rng() % 200, '\0');
+        for (auto& c : text) c = alphabet[rng() % alphabet.size()];
+        const string& planted = patterns[rng() % patterns.size()];
+        if (text.size() >= planted.size() && rng() % 2 == 0) {
+            text.replace(rng() % (text.size() - planted.size() + 1), planted.size(), planted);
+        }
+        uint64_t expected = 0;
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            if (text.find(patterns[p]) != string::npos) expected |= uint64_t(1) << p;
+        }
+        const size_t step = 1 + rng() % 40;
+        for (auto engine : {AhoCorasick::Engine::Scalar, AhoCorasick::Engine::Ssse3, AhoCorasick::Engine::Avx2}) {
+            if (!AhoCorasick::engineSupported(engine)) continue;
+            matcher.setEngine(engine);
+            PatternScanner scanner(matcher);
+            const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+            for (size_t i = 0; i < text.size(); i += step) {
+                scanner.feed(bytes + i, min(step, text.size() - i));
+            }
+            assert(scanner.hits() == expected);
+        }
+    }
+
+    // Nothing to look for means nothing to do; bad pattern sets are rejected.
+    AhoCorasick none({});
+    assert(!PatternScanner(none).active());
+    auto rejects = [](const vector<string>& bad) {
+        try {
+            AhoCorasick matcher(bad);
+        } catch (const runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects({"ok", ""}));
+    assert(rejects(vector<string>(AhoCorasick::kMaxPatterns + 1, "x")));
+    assert(rejects({string(AhoCorasick::kMaxTotalLength + 1, 'x')}));
+
+    // Hits are reported, in config order, without failing validation.
+    auto data = loadFile("test/resources/sample.pdf");
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    IngestConfig cfg{-1, {}};
+    cfg.contentPatterns = {"/JavaScript", "/Type", "/Launch", "%PDF-"};
+    IngestPolicy policy(cfg);
+    RecordingSink sink;
+    MemoryByteSource src(data);
+    ingest(meta, policy, src, sink);
+    assert(sink.lastResult.ok);
+    assert((sink.lastResult.contentHits == vector<string>{"/Type", "%PDF-"}));
+    CompactRecordingSink compact;
+    MemoryByteSource again(data);
+    ingest(meta, policy, again, compact);
+    assert(compact.lastResult.contentHits == 0b1010 && compact.forwardedBytes == data.size());
+}
+
+void testActiveContent() {
+    // PDF keys are flagged however the bytes are split; an ordinary PDF has none.
+    const string scripted = buildPdf(
+        "1 0 obj\n<< /Type /Catalog /OpenAction 2 0 R /Names << /JavaScript 3 0 R /EmbeddedFiles 4 0 R >> >>\nendobj",
+        1);
+    for (size_t step : {scripted.size(), size_t(1), size_t(7)}) {
+        PdfStructureScanner scanner;
+        const auto* bytes = reinterpret_cast<const uint8_t*>(scripted.data());
+        for (size_t i = 0; i < scripted.size(); i += step) {
+            scanner.feed(bytes + i, min(step, scripted.size() - i));
+        }
+        const ActiveContent& active = scanner.activeContent();
+        assert(active.javaScript && active.openAction && active.embeddedFiles && !active.encrypted);
+        assert(!active.macros && !active.externalRelationships);
+    }
+    PdfStructureScanner encrypted;
+    const string locked = buildPdf("1 0 obj\n<< /Encrypt 5 0 R >>\nendobj", 0);
+    encrypted.feed(reinterpret_cast<const uint8_t*>(locked.data()), locked.size());
+    assert(encrypted.activeContent().encrypted && !encrypted.activeContent().javaScript);
+
+    // Names spelled with #xx escapes are decoded before matching, across chunks
+    // too; escapes that spell nothing we look for, or are malformed, do not count.
+    const string escaped = buildPdf("1 0 obj\n<< /Type /Catalog /#4Fpen#41ction 2 0 R >>\nendobj\n"
+                                    "2 0 obj\n<< /S/J#61vaScript/JS(app.alert(1)) /Em#62edd#65dFil#65s 3 0 R >>\nendobj",
+                                    0);
+    const string inert = buildPdf("1 0 obj\n<< /Type /Catalog /Font#20A /J#61v /Jav#zzaScript /#4A#61vaScrip >>\nendobj", 0);
+    for (size_t step : {escaped.size(), size_t(1), size_t(7)}) {
+        auto scanPdf = [step](const string& pdf) {
+            PdfStructureScanner scanner;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(pdf.data());
+            for (size_t i = 0; i < pdf.size(); i += step) {
+                scanner.feed(bytes + i, min(step, pdf.size() - i));
+            }
+            scanner.finish();
+            return scanner.activeContent();
+        };
+        const ActiveContent decoded = scanPdf(escaped);
+        assert(decoded.javaScript && decoded.openAction && decoded.embeddedFiles && !decoded.encrypted);
+        assert(!scanPdf(inert).any());
+    }
+
+    // OOXML macros are found by part name or by reference from the content
+    // types; external relationships by reading the inflated .rels parts.
+    const string rels = "<Relationships><Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/"
+                        "officeDocument/2006/relationships/attachedTemplate\" Target=\"http://attacker.test/t.dotm\" "
+                        "TargetMode = 'External'/></Relationships>";
+    const auto relsDeflated = hexBytes(
+        "558f3b0ec2301044af62a549970d1414284905450a1a940baceccd47c45e6bbd48e1f65848a050bed17c34cd9d56d485439a9798ba668f"
+        "a6776d21bd3b146678456a8b59359e01929dc963aa3852d8fc3ab278d48c32018fe362e9c2f6e929281cebfa04b25f0054c59c7703f998"
+        "75cadd2813e9affd637890544a49412bc7eabfa61b3b32ad29af9b92045c4be81af87ff006");
+    auto scan = [](const vector<uint8_t>& zip, size_t step) {
+        ZipIntegrityVerifier verifier;
+        OoxmlActiveContentScanner scanner;
+        verifier.setContentVisitor(&scanner);
+        for (size_t i = 0; i < zip.size(); i += step) {
+            verifier.feed(zip.data() + i, min(step, zip.size() - i));
+        }
+        verifier.finish();
+        assert(verifier.ok());
+        return scanner.activeContent();
+    };
+    const auto linked = buildZip({{"[Content_Types].xml", "<Types/>"},
+                                  {"word/document.xml", "<d/>"},
+                                  {"word/_rels/document.xml.rels", rels, relsDeflated}});
+    for (size_t step : {linked.size(), size_t(1), size_t(11)}) {
+        ActiveContent active = scan(linked, step);
+        assert(active.externalRelationships && !active.macros);
+    }
+    assert(scan(buildZip({{"[Content_Types].xml", "<Types/>"}, {"word/vbaProject.bin", "VBA"}}), 64).macros);
+    const string renamed = "<Types><Override PartName=\"/word/x.bin\" "
+                           "ContentType=\"application/vnd.ms-office.vbaProject\"/></Types>";
+    assert(scan(buildZip({{"[Content_Types].xml", renamed}, {"word/x.bin", "VBA"}}), 64).macros);
+    assert(!scan(buildZip({{"notes/a.rels.txt", rels}}), 64).any());
+
+    // Relationships are judged by type, with attributes in any order or quoting;
+    // external hyperlinks, and markup inside comments, are not flagged.
+    auto relsFlagged = [&](const string& part) {
+        return scan(buildZip({{"word/_rels/document.xml.rels", part}}), 5).externalRelationships;
+    };
+    const string relsType = "http://schemas.openxmlformats.org/officeDocument/2006/relationships/";
+    assert(relsFlagged("<Relationships><Relationship TargetMode=\"External\"\n Target=\"http://x.test/o\" Id=\"r\" Type = \"" +
+                       relsType + "oleObject\" /></Relationships>"));
+    assert(relsFlagged("<Relationship Type='" + relsType + "frame' TargetMode\t=\t\" External \"/>"));
+    assert(!relsFlagged("<Relationships><Relationship Type=\"" + relsType +
+                        "hyperlink\" Target=\"https://example.test/\" TargetMode=\"External\"/></Relationships>"));
+    assert(!relsFlagged("<Relationship Type=\"" + relsType + "attachedTemplate\" Target=\"t.dotm\"/>"));
+    assert(!relsFlagged("<!-- <Relationship Type=\"" + relsType +
+                        "oleObject\" TargetMode=\"External\"/> --><Relationships/>"));
+
+    // Ingest reports the flags without failing validation.
+    auto docx = buildZip({{"[Content_Types].xml", "<Types/>"},
+                          {"word/document.xml", "<d/>"},
+                          {"word/vbaProject.bin", "VBA"},
+                          {"word/_rels/document.xml.rels", rels, relsDeflated}});
+    UploadMeta meta{"macro.docm", "", false, 0};
+    IngestConfig cfg{-1, {}};
+    RecordingSink sink;
+    MemoryByteSource src(docx);
+    ingest(meta, cfg, src, sink);
+    assert(sink.lastResult.ok && sink.lastResult.activeContent.macros);
+    assert(sink.lastResult.activeContent.externalRelationships && !sink.lastResult.activeContent.javaScript);
+    for (const char* sample : {"test/resources/sample.docx", "test/resources/sample.pdf"}) {
+        MemoryByteSource clean(loadFile(sample));
+        ingest(meta, cfg, clean, sink);
+        assert(sink.lastResult.ok && !sink.lastResult.activeContent.any());
+    }
+}
+
+// ======================== Digests and Fingerprints ========================
+
+void testDigests() {
+    // Known answers around each algorithm's padding boundaries, fed whole and
+    // in odd-sized pieces (bytes are i * 7 mod 256).
+    struct Vector {
+        size_t length;
+        const char* md5;
+        const char* sha1;
+        const char* sha512;
+    };
+    const Vector vectors[] = {
+        {0, "d41d8cd98f00b204", "da39a3ee5e6b4b0d", "cf83e1357eefb8bd"},
+        {55, "8d24280288a69655", "aecd1643c9903b9b", "1fa86069db165162"},
+        {56, "ef2c72b7254c9245", "f5d65c621c02cc8e", "7b6d8a5b05452e1c"},
+        {64, "a2fcb39a253b9b78", "1e17ae1fc093e5da", "9f59bad22a6a8bda"},
+        {111, "d33e91d921631eea", "df2f6197f2b13b38", "d2026b9857418e96"},
+        {112, "ac43942f2f342010", "fe6021ce28099e49", "4dc754b8985c03b8"},
+        {128, "fe942895e9aae953", "516846cd40bd1fe4", "6e7f10bc87eacc3e"},
+        {1000, "de809ff794e91b68", "38f3aa587f4aa049", "5c3d2be85b82f8ac"},
+    };
+    DigestSelection all;
+    all.add(DigestAlgorithm::Md5);
+    all.add(DigestAlgorithm::Sha1);
+    all.add(DigestAlgorithm::Sha512);
+    for (const auto& v : vectors) {
+        vector<uint8_t> data(v.length);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7);
+        for (size_t step : {max<size_t>(data.size(), 1), size_t(1), size_t(13), size_t(100)}) {
+            MultiDigest digest(all);
+            for (size_t i = 0; i < data.size(); i += step) {
+                digest.update(data.data() + i, min(step, data.size() - i));
+            }
+            DigestValues values = digest.finish();
+            assert(values[DigestAlgorithm::Md5].hex().substr(0, 16) == v.md5);
+            assert(values[DigestAlgorithm::Sha1].hex().substr(0, 16) == v.sha1);
+            assert(values[DigestAlgorithm::Sha512].hex().substr(0, 16) == v.sha512);
+            assert(values[DigestAlgorithm::Crc32c].size == 0);
+        }
+    }
+
+    // CRC-32C check value, and every engine agrees at every length and alignment.
+    const string check = "123456789";
+    assert(crc32c(reinterpret_cast<const uint8_t*>(check.data()), check.size()) == 0xE3069283u);
+    auto data = loadFile("test/resources/sample.pdf");
+    for (size_t len = 0; len < 40; ++len) {
+        uint32_t expected = 0;
+        for (auto engine : {Crc32c::Engine::SliceBy8, Crc32c::Engine::Sse42}) {
+            if (!Crc32c::engineSupported(engine)) continue;
+            Crc32c crc;
+            crc.setEngine(engine);
+            crc.update(data.data() + len, 3 * len);
+            if (engine == Crc32c::Engine::SliceBy8) expected = crc.value();
+            assert(crc.value() == expected);
+        }
+    }
+
+    DigestAlgorithm algorithm;
+    assert(lookupDigestAlgorithm("SHA-512", algorithm) && algorithm == DigestAlgorithm::Sha512);
+    assert(lookupDigestAlgorithm("crc32c", algorithm) && algorithm == DigestAlgorithm::Crc32c);
+    assert(!lookupDigestAlgorithm("sha3", algorithm) && !lookupDigestAlgorithm("md", algorithm));
+
+    // Ingest returns the configured digests by name; unknown names are rejected.
+    IngestConfig cfg{-1, {}};
+    cfg.digests = {"MD5", "sha-1", "sha512", "crc32", "crc32c"};
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    RecordingSink sink;
+    MemoryByteSource src(data);
+    ingest(meta, cfg, src, sink);
+    const map<string, string> expected = {
+        {"md5", "6bfe7a929d5552587cbdcb7482e8dbaf"},
+        {"sha1", "e92ec75915049529532cd800bde98d0b39b0d6ae"},
+        {"sha512",
+         "f643bbb27db59f48a18c1e1c51105848178cfb6305ca956370d5b8b21dcc5eadab33c20c4b80b7e964fb47a0c5c54f195cc87b31d3d"
+         "7770bd9eb0412ffcc33c2"},
+        {"crc32", "c0109656"},
+        {"crc32c", "74344a01"}};
+    assert(sink.lastResult.ok && sink.lastResult.digests == expected);
+    assert(sink.lastResult.sha256 == kSamplePdfSha256);
+    cfg.digests = {"sha3-256"};
+    bool threw = false;
+    try {
+        IngestPolicy policy(cfg);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void testBlake3() {
+    // Official-style vectors (bytes are i mod 251) straddling block, chunk and
+    // tree boundaries, fed whole and in pieces on every engine.
+    struct Vector {
+        size_t length;
+        const char* hex;
+    };
+    const Vector vectors[] = {
+        {0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262"},
+        {1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213"},
+        {64, "4eed7141ea4a5cd4b788606bd23f46e212af9cacebacdc7d1f4c6dc7f2511b98"},
+        {65, "de1e5fa0be70df6d2be8fffd0e99ceaa8eb6e8c93a63f2d8d1c30ecb6b263dee"},
+        {1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11"},
+        {1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7"},
+        {1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"},
+        {2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a"},
+        {3072, "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2"},
+        {8192, "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63"},
+        {8193, "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b"},
+        {9216, "e5ef79624045ef3e98fd23342e61d7eb965997b32928f9de591cd0d465a223fb"},
+        {31745, "5c80ce0c3bbe9a6f432a1c6c2ccbde45923d23249386988a30f512d23919eb98"},
+        {102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085"},
+        {(3 << 20) + 5, "a7bb55bed0c04f58879d1fc1cafb27e14e931f4411fe63baf5b2d5a60357bffb"},
+    };
+    auto hexOf = [](const array<uint8_t, 32>& digest) {
+        DigestValue value;
+        value.assign(digest.data(), digest.size());
+        return value.hex();
+    };
+    mt19937 rng(42);
+    for (const auto& v : vectors) {
+        vector<uint8_t> data(v.length);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i % 251);
+        for (auto engine : {Blake3::Engine::Portable, Blake3::Engine::Avx2}) {
+            if (!Blake3::engineSupported(engine)) continue;
+            Blake3 whole;
+            whole.setEngine(engine);
+            whole.update(data.data(), data.size());
+            assert(hexOf(whole.finish()) == v.hex);
+            Blake3 pieces;
+            pieces.setEngine(engine);
+            for (size_t i = 0; i < data.size();) {
+                const size_t step = min<size_t>(data.size() - i, rng() % 3000 + 1);
+                pieces.update(data.data() + i, step);
+                i += step;
+            }
+            assert(hexOf(pieces.finish()) == v.hex);
+            // Subtrees over kMinParallelBytes go to separate threads.
+            for (unsigned threads : {2u, 4u, 0u}) {
+                assert(hexOf(Blake3::hash(data.data(), data.size(), threads, engine)) == v.hex);
+            }
+        }
+    }
+
+    // Ingest reports BLAKE3 alongside the streamed digests.
+    auto pdf = loadFile("test/resources/sample.pdf");
+    IngestConfig cfg{-1, {}};
+    cfg.digests = {"blake3", "crc32"};
+    cfg.hashThreads = 2;
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    RecordingSink sink;
+    MemoryByteSource src(pdf);
+    ingest(meta, cfg, src, sink);
+    const map<string, string> expected = {
+        {"blake3", "ff3de0138a4e3755409d348b966881e66b051f1d679ea19f3f0025e62adac1a7"}, {"crc32", "c0109656"}};
+    assert(sink.lastResult.ok && sink.lastResult.digests == expected);
+}
+
+void testXxh3() {
+    // Reference xxHash 0.8 outputs (bytes are i mod 251) across the 0, 1-3,
+    // 4-8, 9-16, 17-128, 129-240 and streamed size classes.
+    struct Vector {
+        size_t length;
+        uint64_t hash64;
+        const char* hex128;
+    };
+    const Vector vectors[] = {
+        {0, 0x2d06800538d394c2ull, "99aa06d3014798d86001c324468d497f"},
+        {1, 0xc44bdff4074eecdbull, "a6cd5e9392000f6ac44bdff4074eecdb"},
+        {3, 0x5f4299fc161c9cbbull, "e3b55f57945a17cf5f4299fc161c9cbb"},
+        {4, 0x60dab036a58211f2ull, "eb70bf5fc779e9e6a6111d53e80a3db5"},
+        {8, 0x3a1c2d7c85af88f8ull, "e1e4432a62217fe4cfd50c61c8bb98c1"},
+        {9, 0xe9612598145bb9dcull, "16c769d83e4aebce907931979dca3746"},
+        {16, 0x8355e3a6f61770dbull, "72950631827607e2842812cc870dcae2"},
+        {17, 0x9ef341a99de37328ull, "685bc458b37d057fc06e233df7729217"},
+        {128, 0x85c6174c7ff4c46bull, "14792fc3af88dc6c05321a0b64d67b41"},
+        {129, 0xec7642b431ba3e5aull, "dd5e74ac6b45f54ebc30b63382b09a3b"},
+        {240, 0x375a384d957fe865ull, "65b5be86da5540e7c92b68e16f83bbb6"},
+        {241, 0x02e8cd95421c6d02ull, "1da1cb61bcb8a2a102e8cd95421c6d02"},
+        {256, 0x44f5d90dacde463aull, "96c36c85d00e5bc544f5d90dacde463a"},
+        {1024, 0xe5d78bafa45b2aa5ull, "d0ac1f7b93bf57b9e5d78bafa45b2aa5"},
+        {1025, 0xe95c42288f28186eull, "2882ebca04ec915ce95c42288f28186e"},
+        {100000, 0x42c23aeead96750dull, "54182c58bbb1337c42c23aeead96750d"},
+    };
+    auto hexOf = [](const Xxh128Hash& hash) {
+        uint8_t bytes[16];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<uint8_t>(hash.high >> (56 - 8 * i));
+            bytes[8 + i] = static_cast<uint8_t>(hash.low >> (56 - 8 * i));
+        }
+        return hexString(bytes, sizeof(bytes));
+    };
+    mt19937 rng(45);
+    for (const auto& v : vectors) {
+        vector<uint8_t> data(v.length);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i % 251);
+        assert(xxh3_64(data.data(), data.size()) == v.hash64);
+        assert(hexOf(xxh3_128(data.data(), data.size())) == v.hex128);
+        for (auto engine : {Xxh3::Engine::Scalar, Xxh3::Engine::Avx2}) {
+            if (!Xxh3::engineSupported(engine)) continue;
+            Xxh3 pieces;
+            pieces.setEngine(engine);
+            for (size_t i = 0; i < data.size();) {
+                const size_t step = min<size_t>(data.size() - i, rng() % 700 + 1);
+                pieces.update(data.data() + i, step);
+                i += step;
+            }
+            assert(pieces.digest64() == v.hash64);
+            assert(hexOf(pieces.digest128()) == v.hex128);
+        }
+    }
+
+    // Ingest always reports both as dedup keys.
+    auto pdf = loadFile("test/resources/sample.pdf");
+    IngestConfig cfg{-1, {}};
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    RecordingSink sink;
+    MemoryByteSource src(pdf);
+    ingest(meta, cfg, src, sink);
+    assert(sink.lastResult.xxh3 == "4fb021b579551d73");
+    assert(sink.lastResult.xxh128 == "c93d04d9c25cc7d54fb021b579551d73");
+}
+
+void testContentAddressedSink() {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / ("ingest-cas-test-" + to_string(random_device()()));
+    auto pdf = loadFile("test/resources/sample.pdf");
+    IngestConfig cfg{-1, {}};
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    {
+        ContentAddressedSink sink(root.string());
+        const string path = sink.objectPath(kSamplePdfSha256);
+        assert(path == (root / "ce" / "f9" / kSamplePdfSha256).string());
+        assert(!sink.contains(kSamplePdfSha256));
+
+        // The first upload is written; a resubmission, through either sink
+        // interface, is recognized by digest and not written again.
+        MemoryByteSource first(pdf);
+        ingest(meta, cfg, first, static_cast<IngestSink&>(sink));
+        assert(sink.contains(kSamplePdfSha256) && loadFile(path) == pdf);
+        MemoryByteSource again(pdf);
+        ingest(meta, cfg, again, static_cast<CompactIngestSink&>(sink));
+        assert(sink.objectsWritten() == 1 && sink.duplicatesSkipped() == 1);
+
+        // Both uploads are recorded: one blob, two references to it.
+        size_t blobs = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(root)) {
+            const auto parent = entry.path().parent_path().filename();
+            blobs += entry.is_regular_file() && parent != "tmp" && parent != "refs";
+        }
+        vector<string> refs;
+        for (const auto& entry : fs::directory_iterator(sink.referenceDirectory())) {
+            auto bytes = loadFile(entry.path().string());
+            refs.emplace_back(bytes.begin(), bytes.end());
+        }
+        assert(blobs == 1 && refs.size() == 2 && sink.referencesWritten() == 2);
+        for (const auto& ref : refs) {
+            assert(ref == string("sha256 ") + kSamplePdfSha256 + "\nsize " + to_string(pdf.size()) +
+                              "\nfilename sample.pdf\nclaimedMime application/pdf\ncontentLength \n");
+        }
+
+        // Client-supplied values cannot break the line format.
+        UploadMeta odd{"a\nb%.pdf", "application/pdf", true, static_cast<int64_t>(pdf.size())};
+        MemoryByteSource third(pdf);
+        ingest(odd, cfg, third, static_cast<IngestSink&>(sink));
+        bool escaped = false;
+        for (const auto& entry : fs::directory_iterator(sink.referenceDirectory())) {
+            auto bytes = loadFile(entry.path().string());
+            const string ref(bytes.begin(), bytes.end());
+            escaped |= ref.find("filename a%0Ab%25.pdf\n") != string::npos &&
+                       ref.find("contentLength " + to_string(pdf.size()) + "\n") != string::npos;
+        }
+        assert(escaped && sink.objectsWritten() == 1 && sink.duplicatesSkipped() == 2);
+
+        // Other bytes get their own object.
+        vector<uint8_t> other(pdf.begin(), pdf.end() - 1);
+        MemoryByteSource changed(other);
+        ingest(meta, cfg, changed, static_cast<IngestSink&>(sink));
+        assert(sink.objectsWritten() == 2);
+
+        // A truncated object is replaced rather than counted as a duplicate.
+        fs::resize_file(path, 10);
+        MemoryByteSource repair(pdf);
+        ingest(meta, cfg, repair, static_cast<IngestSink&>(sink));
+        assert(sink.objectsWritten() == 3 && loadFile(path) == pdf);
+        assert(fs::is_empty(root / "tmp"));
+
+        bool threw = false;
+        try {
+            sink.objectPath("../etc/passwd");
+        } catch (const runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    fs::remove_all(root);
+}
+
+void testFastCdc() {
+    mt19937 rng(47);
+    vector<uint8_t> data(1 << 20);
+    for (auto& b : data) b = static_cast<uint8_t>(rng());
+    auto chunkAll = [](const vector<uint8_t>& bytes, mt19937* split) {
+        FastCdcChunker chunker(4096);
+        vector<CdcChunk> chunks;
+        for (size_t i = 0; i < bytes.size();) {
+            const size_t step = split ? min<size_t>(bytes.size() - i, (*split)() % 20000 + 1) : bytes.size();
+            chunker.update(bytes.data() + i, step, chunks);
+            i += step;
+        }
+        chunker.finish(chunks);
+        return chunks;
+    };
+
+    // Chunks tile the input within the size bounds, whatever the read sizes.
+    const vector<CdcChunk> chunks = chunkAll(data, nullptr);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        assert(chunks[i].offset == offset);
+        assert(chunks[i].length <= 4096 * 8 && (chunks[i].length >= 1024 || i + 1 == chunks.size()));
+        Sha256 hasher;
+        hasher.update(data.data() + offset, chunks[i].length);
+        assert(hasher.finish() == chunks[i].digest);
+        offset += chunks[i].length;
+    }
+    assert(offset == data.size());
+    assert(chunks.size() > data.size() / (4096 * 2) && chunks.size() < data.size() / (4096 / 2));
+    const vector<CdcChunk> pieces = chunkAll(data, &rng);
+    assert(pieces.size() == chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        assert(pieces[i].length == chunks[i].length && pieces[i].digest == chunks[i].digest);
+    }
+
+    // An insertion only disturbs the chunks around it.
+    vector<uint8_t> edited = data;
+    edited.insert(edited.begin() + 300000, 100, 'x');
+    size_t shared = 0;
+    for (const auto& chunk : chunkAll(edited, nullptr)) {
+        for (const auto& original : chunks) {
+            if (original.digest == chunk.digest) {
+                ++shared;
+                break;
+            }
+        }
+    }
+    assert(shared + 3 >= chunks.size());
+
+    bool threw = false;
+    try {
+        FastCdcChunker chunker(5000);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Ingest chunks when configured; the chunk store writes only unseen chunks.
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / ("ingest-chunks-test-" + to_string(random_device()()));
+    auto docx = loadFile("test/resources/sample.docx");
+    IngestConfig cfg{-1, {}};
+    cfg.cdcAverageChunkSize = 1024;
+    UploadMeta meta{"sample.docx", "", false, 0};
+    {
+        ChunkStoreSink store(root.string());
+        MemoryByteSource first(docx);
+        ingest(meta, cfg, first, static_cast<IngestSink&>(store));
+        const uint64_t firstChunks = store.chunksWritten();
+        assert(firstChunks > 1 && store.bytesWritten() == docx.size() && store.chunksSkipped() == 0);
+
+        vector<uint8_t> revised = docx;
+        revised.insert(revised.begin() + 10000, {'e', 'd', 'i', 't'});
+        MemoryByteSource second(revised);
+        ingest(meta, cfg, second, static_cast<CompactIngestSink&>(store));
+        assert(store.bytesWritten() - docx.size() < revised.size() / 2);
+        assert(store.chunksSkipped() > 0);
+        assert(store.restore(sha256Hex(docx)) == docx && store.restore(sha256Hex(revised)) == revised);
+
+        // A resubmission is skipped without reading it.
+        const uint64_t written = store.bytesWritten();
+        MemoryByteSource again(docx);
+        ingest(meta, cfg, again, static_cast<IngestSink&>(store));
+        assert(store.bytesWritten() == written);
+
+        // Without chunking configured the store refuses the upload.
+        cfg.cdcAverageChunkSize = 0;
+        threw = false;
+        try {
+            vector<uint8_t> other = revised;
+            other.push_back(0);
+            MemoryByteSource src(other);
+            ingest(meta, cfg, src, static_cast<IngestSink&>(store));
+        } catch (const runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    fs::remove_all(root);
+
+    cfg.cdcAverageChunkSize = 3000;
+    threw = false;
+    try {
+        IngestPolicy policy(cfg);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void testTlsh() {
+    const char* const kSamplePdfTlsh = "T1A2263340D8ECAD5EFEDBC20682377D9E8F4CB516A9CB5401596C0529A08B162E4E73FF";
+    auto pdf = loadFile("test/resources/sample.pdf");
+    auto digestOf = [](const vector<uint8_t>& bytes) {
+        Tlsh hasher;
+        hasher.update(bytes.data(), bytes.size());
+        return hasher.finish();
+    };
+    const TlshDigest whole = digestOf(pdf);
+    assert(whole.valid && whole.hex() == kSamplePdfTlsh);
+    mt19937 rng(48);
+    Tlsh pieces;
+    for (size_t i = 0; i < pdf.size();) {
+        const size_t step = min<size_t>(pdf.size() - i, rng() % 5 == 0 ? rng() % 4 + 1 : rng() % 70000 + 1);
+        pieces.update(pdf.data() + i, step);
+        i += step;
+    }
+    assert(pieces.finish() == whole);
+
+    // Too short or too uniform inputs have no digest.
+    assert(!digestOf(vector<uint8_t>(pdf.begin(), pdf.begin() + 49)).valid);
+    assert(!digestOf(vector<uint8_t>(4096, 0)).valid && digestOf(vector<uint8_t>(4096, 0)).hex().empty());
+
+    // Scattered edits stay close; unrelated bytes do not.
+    vector<uint8_t> edited = pdf;
+    for (int i = 0; i < 2000; ++i) edited[rng() % edited.size()] ^= 0xFF;
+    vector<uint8_t> noise(pdf.size());
+    for (auto& b : noise) b = static_cast<uint8_t>(rng());
+    assert(tlshDistance(whole, whole) == 0);
+    assert(tlshDistance(whole, digestOf(edited)) < 30);
+    assert(tlshDistance(whole, digestOf(noise)) > 100);
+
+    TlshDigest parsed;
+    assert(TlshDigest::fromHex(kSamplePdfTlsh, parsed) && parsed == whole);
+    assert(TlshDigest::fromHex(string(kSamplePdfTlsh + 2), parsed) && parsed == whole);
+    assert(!TlshDigest::fromHex("T1A226", parsed));
+    assert(!TlshDigest::fromHex(string(kSamplePdfTlsh).replace(10, 1, "G"), parsed));
+
+    // Ingest computes it only when configured.
+    IngestConfig cfg{-1, {}};
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    RecordingSink sink;
+    MemoryByteSource plain(pdf);
+    ingest(meta, cfg, plain, sink);
+    assert(sink.lastResult.tlsh.empty());
+    cfg.fuzzyHash = true;
+    MemoryByteSource fuzzy(pdf);
+    ingest(meta, cfg, fuzzy, sink);
+    assert(sink.lastResult.tlsh == kSamplePdfTlsh);
+}
+
+void testByteEntropy() {
+    auto entropyOf = [](const vector<uint8_t>& bytes) {
+        ByteHistogram histogram;
+        histogram.update(bytes.data(), bytes.size());
+        return histogram.entropy();
+    };
+    auto near = [](double a, double b) { return fabs(a - b) < 1e-9; };
+    vector<uint8_t> uniform(256 * 40);
+    for (size_t i = 0; i < uniform.size(); ++i) uniform[i] = static_cast<uint8_t>(i);
+    assert(near(entropyOf(uniform), 8));
+    assert(near(entropyOf(vector<uint8_t>(1000, 'a')), 0) && near(entropyOf({}), 0));
+    assert(near(entropyOf({'a', 'b', 'a', 'b', 'b', 'a', 'a', 'b', 'a'}), 0.99107605983822));
+
+    // Counts match a plain loop whatever the alignment and split.
+    mt19937 rng(49);
+    vector<uint8_t> data(100003);
+    for (auto& b : data) b = static_cast<uint8_t>(rng() % 7 == 0 ? rng() : 'x');
+    array<uint64_t, 256> expected{};
+    for (uint8_t b : data) ++expected[b];
+    ByteHistogram pieces;
+    for (size_t i = 0; i < data.size();) {
+        const size_t step = min<size_t>(data.size() - i, rng() % 100 + 1);
+        pieces.update(data.data() + i, step);
+        i += step;
+    }
+    assert(pieces.counts() == expected && pieces.total() == data.size());
+    assert(near(pieces.entropy(), ByteHistogram::entropy(expected)));
+
+    // Ingest reports the whole upload and its head and tail windows.
+    vector<uint8_t> upload(100000, ' ');
+    for (size_t i = 0; i < 4096; ++i) upload[i] = static_cast<uint8_t>(i);
+    IngestConfig cfg{-1, {}};
+    UploadMeta meta{"blob.bin", "", false, 0};
+    RecordingSink sink;
+    MemoryByteSource plain(upload);
+    ingest(meta, cfg, plain, sink);
+    assert(!sink.lastResult.entropy.computed);
+    cfg.entropy = true;
+    MemoryByteSource src(upload);
+    ingest(meta, cfg, src, sink);
+    const ByteEntropy& entropy = sink.lastResult.entropy;
+    assert(entropy.computed && near(entropy.head, 8) && near(entropy.tail, 0));
+    assert(entropy.overall > 0 && entropy.overall < 1);
+    auto png = loadFile("test/resources/sample.png");
+    MemoryByteSource image(png);
+    ingest(meta, cfg, image, sink);
+    assert(sink.lastResult.entropy.overall > 7.5);
+}
+
+void testChunkManifest() {
+    auto sha = [](const vector<uint8_t>& bytes) {
+        Sha256 hasher;
+        hasher.update(bytes.data(), bytes.size());
+        return hasher.finish();
+    };
+    auto prefixed = [&](uint8_t prefix, const Sha256Digest& a, const Sha256Digest* b) {
+        vector<uint8_t> bytes{prefix};
+        bytes.insert(bytes.end(), a.bytes.begin(), a.bytes.end());
+        if (b) bytes.insert(bytes.end(), b->bytes.begin(), b->bytes.end());
+        return sha(bytes);
+    };
+
+    // RFC 6962 shape: three leaves hash as ((0, 1), 2); no leaves as SHA-256("").
+    vector<uint8_t> data(2500);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 31);
+    ChunkManifest small = buildChunkManifest(data.data(), data.size(), 1000);
+    assert(small.chunks.size() == 3 && small.chunkCount() == 3);
+    assert(small.chunks[2] == sha(vector<uint8_t>(data.begin() + 2000, data.end())));
+    const Sha256Digest leaf0 = prefixed(0, small.chunks[0], nullptr);
+    const Sha256Digest leaf1 = prefixed(0, small.chunks[1], nullptr);
+    const Sha256Digest leaf2 = prefixed(0, small.chunks[2], nullptr);
+    const Sha256Digest left = prefixed(1, leaf0, &leaf1);
+    assert(small.root == prefixed(1, left, &leaf2));
+    assert(buildChunkManifest(data.data(), 0, 1000).root.hex() ==
+           "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    // Ranges map to chunks, and chunks verify on their own.
+    uint64_t first = 0;
+    uint64_t last = 0;
+    small.chunksCovering(999, 2, first, last);
+    assert(first == 0 && last == 1);
+    small.chunksCovering(2000, 500, first, last);
+    assert(first == 2 && last == 2);
+    assert(small.verifyChunk(1, data.data() + 1000, 1000));
+    assert(!small.verifyChunk(2, data.data() + 2000, 499));
+    assert(!small.verifyChunk(3, data.data(), 0));
+    bool threw = false;
+    try {
+        small.chunksCovering(2000, 501, first, last);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Ingest builds the same manifest whatever the thread count; it survives
+    // an encode/decode round trip and tampering is caught.
+    auto pdf = loadFile("test/resources/sample.pdf");
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    IngestConfig cfg{-1, {}};
+    cfg.manifestChunkSize = 1 << 20;
+    cfg.hashThreads = 1;
+    RecordingSink sink;
+    MemoryByteSource src(pdf);
+    ingest(meta, cfg, src, sink);
+    const ChunkManifest serial = sink.lastResult.manifest;
+    assert(serial.chunks.size() == 5 && serial.totalSize == pdf.size() && serial.verifyRoot());
+    assert(serial.verifyChunk(4, pdf.data() + (4 << 20), pdf.size() - (4 << 20)));
+    cfg.hashThreads = 3;
+    MemoryByteSource src2(pdf);
+    ingest(meta, cfg, src2, sink);
+    assert(sink.lastResult.manifest.chunks == serial.chunks && sink.lastResult.manifest.root == serial.root);
+
+    vector<uint8_t> encoded = serial.encode();
+    assert(encoded.size() == 21 + 32 * 6);
+    ChunkManifest decoded = ChunkManifest::decode(encoded.data(), encoded.size());
+    assert(decoded.chunks == serial.chunks && decoded.root == serial.root && decoded.chunkSize == (1u << 20));
+    encoded.back() ^= 1;
+    threw = false;
+    try {
+        ChunkManifest::decode(encoded.data(), encoded.size());
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    cfg.manifestChunkSize = 0;
+    MemoryByteSource src3(pdf);
+    ingest(meta, cfg, src3, sink);
+    assert(sink.lastResult.manifest.empty() && sink.lastResult.manifest.chunks.empty());
+}
+
+void testExpectedDigests() {
+    uint8_t bytes[4];
+    assert(hexDecode("74344A01", bytes, 4) && bytes[0] == 0x74 && bytes[3] == 0x01);
+    assert(!hexDecode("74344a0", bytes, 4) && !hexDecode("74344a0g", bytes, 4));
+    assert(base64Decode("dDRKAQ==", bytes, 4) && bytes[1] == 0x34 && bytes[2] == 0x4A);
+    assert(base64Decode("dDRKAQ", bytes, 4));
+    assert(!base64Decode("dDRKAR==", bytes, 4) && !base64Decode("dDRK", bytes, 4) && !base64Decode("dD*KAQ==", bytes, 4));
+
+    // Unknown algorithms are skipped; RFC 9530 colons are stripped.
+    auto parsed = parseDigestHeader(
+        "SHA-256=zvmvixbDB8RYUnSGRZKQcO7VGMA8qYwYqmEaQ+oV7Ho=, unixsum=30637,sha=:6S7HWRUElSlTLNgAvemNCzmw1q4=:");
+    assert(parsed.size() == 2 && parsed[0].algorithm == "SHA-256" && parsed[1].algorithm == "sha");
+    assert(parsed[1].value == "6S7HWRUElSlTLNgAvemNCzmw1q4=");
+
+    // Matching digests in base64 and hex pass, and algorithms outside
+    // IngestConfig::digests are computed for the upload.
+    auto pdf = loadFile("test/resources/sample.pdf");
+    IngestConfig cfg{-1, {}};
+    cfg.digests = {"crc32c"};
+    UploadMeta meta{"sample.pdf", "application/pdf", false, 0};
+    meta.expectedDigests = parsed;
+    meta.expectedDigests.push_back({"md5", "6BFE7A929D5552587CBDCB7482E8DBAF"});
+    meta.expectedDigests.push_back({"crc32c", "dDRKAQ=="});
+    // CRC-32 in base64 is exactly as long as in hex; both forms are read.
+    meta.expectedDigests.push_back({"crc32", "wBCWVg=="});
+    meta.expectedDigests.push_back({"CRC-32", "C0109656"});
+    RecordingSink sink;
+    MemoryByteSource src(pdf);
+    ingest(meta, cfg, src, sink);
+    assert(sink.lastResult.ok);
+    assert(sink.lastResult.digests.size() == 4 && sink.lastResult.digests.at("md5") == "6bfe7a929d5552587cbdcb7482e8dbaf");
+    assert(sink.lastResult.digests.at("crc32") == "c0109656");
+    meta.expectedDigests = {{"crc32", "wBCWVw=="}};
+    MemoryByteSource wrongCrc(pdf);
+    ingest(meta, cfg, wrongCrc, sink);
+    assert((sink.lastResult.errors == vector<string>{"expected digest mismatch"}));
+
+    // A wrong value is a mismatch; an undecodable value or unknown algorithm is invalid.
+    meta.expectedDigests = {{"md5", "HUXZLQLMuI/KZ5KDcJPcOA=="}};
+    MemoryByteSource src2(pdf);
+    ingest(meta, cfg, src2, sink);
+    assert(!sink.lastResult.ok && containsError(sink.lastResult, "expected digest mismatch"));
+    assert(sink.lastResult.errors.size() == 1);
+    meta.expectedDigests = {{"sha-256", "not base64"}, {"whirlpool", "AAAA"}};
+    MemoryByteSource src3(pdf);
+    ingest(meta, cfg, src3, sink);
+    assert(containsError(sink.lastResult, "expected digest is invalid or unsupported"));
+    assert(!containsError(sink.lastResult, "expected digest mismatch"));
+}
+
+// ======================== Telemetry ========================
+
+void testMetricsSnapshot() {
+    metricsReset();
+    auto data = loadFile("test/resources/sample.pdf");
+    MemoryByteSource src(data);
+    UploadMeta meta{"sample.pdf", "application/pdf", true, static_cast<int64_t>(data.size()) + 1};
+    IngestConfig cfg{static_cast<int64_t>(data.size() + 1024), {"application/pdf"}};
+    RecordingSink sink;
+    ingest(meta, cfg, src, sink);
+
+    string snapshot = metricsSnapshot();
+    assert(snapshot.find("ingest_bytes_total " + to_string(data.size()) + "\n") != string::npos);
+    assert(snapshot.find("ingest_uploads_total{mime=\"application/pdf\"} 1\n") != string::npos);
+    assert(snapshot.find("ingest_validation_errors_total{error=\"contentLength mismatch\"} 1\n") != string::npos);
+    assert(snapshot.find("ingest_sink_duration_seconds_count 1\n") != string::npos);
+
+    // A sink that throws is still timed.
+    class FailingSink final : public IngestSink {
+    public:
+        void persist(const UploadMeta&, const IngestResult&, ByteSource&) override {
+            throw runtime_error("sink unavailable");
+        }
+    } failing;
+    MemoryByteSource again(data);
+    bool threw = false;
+    try {
+        ingest(meta, cfg, again, failing);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    snapshot = metricsSnapshot();
+    assert(snapshot.find("ingest_uploads_total{mime=\"application/pdf\"} 2\n") != string::npos);
+    assert(snapshot.find("ingest_sink_duration_seconds_count 2\n") != string::npos);
+
+    // A long-running process keeps sub-second resolution in the sum.
+    metricsReset();
+    metricsRecordSinkDuration(1234567.25);
+    metricsRecordSinkDuration(0.5);
+    snapshot = metricsSnapshot();
+    assert(snapshot.find("ingest_sink_duration_seconds_sum 1234567.750000000\n") != string::npos);
+}
+
+void testKernelCounterMetrics() {
+    metricsReset();
+    PerfSample sample;
+    sample.valid = true;
+    sample.cycles = 3000;
+    sample.instructions = 6000;
+    metricsRecordKernelSample(MetricsKernel::Sha256, 1000, sample);
+    metricsRecordKernelSample(MetricsKernel::Sha256, 1000, PerfSample{});
+    sample.cycles = 3 * 1048576 + 1;
+    metricsRecordKernelSample(MetricsKernel::Xxh3, 1048576, sample);
+
+    string snapshot = metricsSnapshot();
+    assert(snapshot.find("ingest_kernel_samples_total{kernel=\"sha256\"} 1\n") != string::npos);
+    assert(snapshot.find("ingest_kernel_cycles_total{kernel=\"sha256\"} 3000\n") != string::npos);
+    assert(snapshot.find("ingest_kernel_cycles_per_byte{kernel=\"sha256\"} 3\n") != string::npos);
+    assert(snapshot.find("ingest_kernel_cycles_per_byte{kernel=\"xxh3\"} 3.0000009536743164\n") != string::npos);
+
+    // Sampling must never change results, whether or not the host exposes counters.
+    setPerfSamplingEnabled(true);
+    auto data = loadFile("test/resources/sample.docx");
+    MemoryByteSource src(data);
+    UploadMeta meta{"sample.docx", "", true, static_cast<int64_t>(data.size())};
+    IngestConfig cfg{static_cast<int64_t>(data.size()), {}};
+    RecordingSink sink;
+    ingest(meta, cfg, src, sink);
+    setPerfSamplingEnabled(false);
+    assert(sink.lastResult.ok);
+    assert(forwardedMatches(sink, data.size()));
+}
+
+void testChromeTraceExport() {
+    traceReset();
+    setTracingEnabled(true);
+    auto data = loadFile("test/resources/sample.docx");
+    MemoryByteSource src(data);
+    UploadMeta meta{"sample.docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document", false, 0};
+    IngestConfig cfg{static_cast<int64_t>(data.size() + 1024), {}};
+    RecordingSink sink;
+    ingest(meta, cfg, src, sink);
+    setTracingEnabled(false);
+
+    ostringstream out;
+    dumpChromeTrace(out);
+    string json = out.str();
+    assert(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+    for (const char* stage : {"ingest", "read", "sniff", "hash", "validate", "persist"}) {
+        assert(json.find("\"name\":\"" + string(stage) + "\",\"cat\":\"ingest\",\"ph\":\"B\"") != string::npos);
+        assert(json.find("\"name\":\"" + string(stage) + "\",\"cat\":\"ingest\",\"ph\":\"E\"") != string::npos);
+    }
+    assert(json.find("\"size\":" + to_string(data.size())) != string::npos);
+    assert(json.find("\"mime\":\"application/vnd.openxmlformats-officedocument.wordprocessingml.document\"") != string::npos);
+
+    traceReset();
+    ostringstream empty;
+    dumpChromeTrace(empty);
+    assert(empty.str() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}\n");
+
+    // Dumps racing a writer that laps its ring emit only whole events: every
+    // "lap" event carries its upload id as its size too.
+    setTracingEnabled(true);
+    atomic<bool> stop{false};
+    thread writer([&] {
+        for (uint64_t id = 1; !stop.load(memory_order_relaxed); ++id) {
+            TraceScope scope("lap", id, static_cast<int64_t>(id));
+        }
+    });
+    for (int dump = 0; dump < 20; ++dump) {
+        ostringstream racing;
+        dumpChromeTrace(racing);
+        const string events = racing.str();
+        for (size_t at = events.find("\"name\":\"lap\""); at != string::npos;
+             at = events.find("\"name\":\"lap\"", at + 1)) {
+            const size_t upload = events.find("\"upload\":", at) + 9;
+            const size_t size = events.find("\"size\":", at) + 7;
+            assert(stoull(events.substr(upload, 20)) == stoull(events.substr(size, 20)));
+        }
+    }
+    stop = true;
+    writer.join();
+    setTracingEnabled(false);
+    traceReset();
+}
+
 } // end namespace
 
 int main() {
     testPdfHappy();
+    testCompactResult();
     testClaimedMimeMismatch();
     testContentLengthMismatchPlusOne();
     testContentLengthMismatchMinusOne();
     testExceedsMaxContentLength();
     testNoContentLengthMaxEnforced();
     testMimeNotAccepted();
+    testIngestPolicy();
     testTinyInput();
+    testStreamingSnifferChunkBoundaries();
+    testSignatureTable();
+    testMultiNeedleSearch();
+    testZipWalker();
+    testCrc32AndInflate();
+    testZipIntegrity();
+    testZipLimits();
+    testPngVerifier();
+    testPdfStructureScan();
+    testUtf8();
+    testContentPatterns();
+    testActiveContent();
+    testDigests();
+    testBlake3();
+    testXxh3();
+    testContentAddressedSink();
+    testFastCdc();
+    testTlsh();
+    testByteEntropy();
+    testChunkManifest();
+    testExpectedDigests();
+    testMetricsSnapshot();
+    testKernelCounterMetrics();
+    testChromeTraceExport();
     cout << "All ingest tests passed\n";
     return 0;
 }